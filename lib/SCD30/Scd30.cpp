@@ -45,6 +45,10 @@ bool Scd30::getDataReady(bool& dataReady) {
 }
 
 bool Scd30::getMeasurement(float& co2Concentration, float& temperature, float& humidity) {
+  return notifyTransfer(Register::Measurement, readMeasurement(co2Concentration, temperature, humidity));
+}
+
+bool Scd30::readMeasurement(float& co2Concentration, float& temperature, float& humidity) {
   _wire.beginTransmission(i2CAddress);
   _wire.write(static_cast<uint16_t>(Register::Measurement) >> 8);
   _wire.write(static_cast<uint16_t>(Register::Measurement));
@@ -149,6 +153,18 @@ bool Scd30::reset() {
 }
 
 bool Scd30::readRegister(Register reg, uint16_t& value) {
+  return notifyTransfer(reg, transferReadRegister(reg, value));
+}
+
+bool Scd30::writeRegister(Register reg, uint16_t value) {
+  return notifyTransfer(reg, transferWriteRegister(reg, value));
+}
+
+bool Scd30::writeRegister(Register reg) {
+  return notifyTransfer(reg, transferWriteRegister(reg));
+}
+
+bool Scd30::transferReadRegister(Register reg, uint16_t& value) {
   _wire.beginTransmission(i2CAddress);
   _wire.write(static_cast<uint16_t>(reg) >> 8);
   _wire.write(static_cast<uint16_t>(reg));
@@ -168,7 +184,7 @@ bool Scd30::readRegister(Register reg, uint16_t& value) {
   return calculateCrc8(value) == crc;
 }
 
-bool Scd30::writeRegister(Register reg, uint16_t value) {
+bool Scd30::transferWriteRegister(Register reg, uint16_t value) {
   _wire.beginTransmission(i2CAddress);
   _wire.write(static_cast<uint16_t>(reg) >> 8);
   _wire.write(static_cast<uint16_t>(reg));
@@ -182,7 +198,7 @@ bool Scd30::writeRegister(Register reg, uint16_t value) {
   return true;
 }
 
-bool Scd30::writeRegister(Register reg) {
+bool Scd30::transferWriteRegister(Register reg) {
   _wire.beginTransmission(i2CAddress);
   _wire.write(static_cast<uint16_t>(reg) >> 8);
   _wire.write(static_cast<uint16_t>(reg));
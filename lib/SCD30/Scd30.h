@@ -6,6 +6,7 @@
 #define SCD30_H
 
 #include <cstdint>
+#include <functional>
 #include <Wire.h>
 
 class Scd30
@@ -28,8 +29,18 @@ public:
 
   static constexpr uint8_t i2CAddress = 0x61u;
 
+  /// Called after every register transfer with its result, e.g. to collect statistics
+  using TransferCallback = std::function<void(Register reg, bool success)>;
+
   Scd30(TwoWire &wire = Wire) : _wire{wire} {}
 
+  /**
+   * @brief Sets the transfer callback
+   *
+   * @param[in] transferCallback callback or nullptr to disable
+   */
+  void setTransferCallback(const TransferCallback& transferCallback) { _transferCallback = transferCallback; }
+
   /**
    * @brief Starts the continuous measurement
    *
@@ -225,6 +236,46 @@ protected:
    */
   bool writeRegister(Register reg);
 
+  /**
+   * @brief Reads the measurement from the sensor without notifying the transfer callback
+   *
+   * @param[out] co2Concentration Co2 concentration in ppm
+   * @param[out] temperature temperature in °C
+   * @param[out] humidity humidity in %RH
+   * @retval true read-out successful
+   * @retval false read-out failed
+   */
+  bool readMeasurement(float& co2Concentration, float& temperature, float& humidity);
+
+  /**
+   * @brief Reads a register from the sensor without notifying the transfer callback
+   *
+   * @param[in] reg register to read
+   * @param[out] value value read from register
+   * @retval true read-out successful
+   * @retval false read-out failed
+   */
+  bool transferReadRegister(Register reg, uint16_t& value);
+
+  /**
+   * @brief Writes a register with an uint16_t value to the sensor without notifying the transfer callback
+   *
+   * @param[in] reg register to write
+   * @param[in] value value write to register
+   * @retval true write successful
+   * @retval false write failed
+   */
+  bool transferWriteRegister(Register reg, uint16_t value);
+
+  /**
+   * @brief Writes a register without value to the sensor without notifying the transfer callback
+   *
+   * @param[in] reg register to write
+   * @retval true write successful
+   * @retval false write failed
+   */
+  bool transferWriteRegister(Register reg);
+
   /**
    * @brief Calculates the CRC8 of a value
    *
@@ -233,8 +284,23 @@ protected:
    */
   static uint8_t calculateCrc8(uint16_t value);
 
+  /**
+   * @brief Reports the result of a transfer to the transfer callback
+   *
+   * @param[in] reg register transferred
+   * @param[in] success transfer result
+   * @return success
+   */
+  bool notifyTransfer(Register reg, bool success) {
+    if (_transferCallback) {
+      _transferCallback(reg, success);
+    }
+    return success;
+  }
+
 private:
   TwoWire& _wire;
+  TransferCallback _transferCallback{};
 
 };
 
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cmath>
+
+#include "adaptive_interval.hpp"
+
+namespace {
+
+struct Step {
+  float rateOfChange; // ppm/min
+  uint16_t interval; // s
+};
+
+// Interval used while CO2 changes at least with the given rate
+constexpr Step fastSteps[] = {
+  {30.0f, 2u},
+  {10.0f, 10u},
+  {3.0f, 30u},
+};
+
+}
+
+void AdaptiveInterval::reset(uint16_t interval) {
+  _interval = std::clamp(interval, minimumInterval, maximumInterval);
+  _rateOfChange = 0.0f;
+  _initialized = false;
+}
+
+uint16_t AdaptiveInterval::update(time_t time, float co2) {
+  if (std::isnan(co2)) {
+    return _interval;
+  }
+
+  if ((not _initialized) or (time <= _lastTime)) {
+    _initialized = true;
+    _baseline = co2;
+    _lastCo2 = co2;
+    _lastTime = time;
+    return _interval;
+  }
+
+  // Samples are irregularly spaced, so weights are based on the time passed
+  const float dt = time - _lastTime;
+  const float rateOfChange = (co2 - _lastCo2) / dt * 60.0f;
+  _rateOfChange += (rateOfChange - _rateOfChange) * (1.0f - std::exp(-dt / rateTimeConstant));
+
+  // Baseline follows falling CO2 immediately and rising CO2 only slowly
+  if (co2 < _baseline) {
+    _baseline = co2;
+  } else {
+    _baseline += (co2 - _baseline) * (1.0f - std::exp(-dt / baselineTimeConstant));
+  }
+
+  _lastCo2 = co2;
+  _lastTime = time;
+
+  for (const auto& step : fastSteps) {
+    if (std::fabs(_rateOfChange) >= step.rateOfChange) {
+      _interval = step.interval;
+      return _interval;
+    }
+  }
+
+  uint16_t maximum = maximumIntervalDay;
+  if (isOccupied()) {
+    maximum = maximumIntervalOccupied;
+  } else if (isNight(time)) {
+    maximum = maximumInterval;
+  }
+
+  _interval = std::clamp<uint16_t>(std::min<uint32_t>(_interval * 2u, maximum), minimumInterval, maximumInterval);
+  return _interval;
+}
+
+bool AdaptiveInterval::isOccupied() const {
+  return ((_lastCo2 - _baseline) >= occupiedCo2) or (_rateOfChange >= occupiedRateOfChange);
+}
+
+bool AdaptiveInterval::isNight(time_t time) {
+  struct tm timeinfo;
+  localtime_r(&time, &timeinfo);
+
+  // Without a configured time the hour is meaningless
+  if (timeinfo.tm_year <= (2020 - 1900)) {
+    return false;
+  }
+
+  return (timeinfo.tm_hour >= 22) or (timeinfo.tm_hour < 6);
+}
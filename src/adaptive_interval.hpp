@@ -0,0 +1,65 @@
+#ifndef ADAPTIVE_INTERVAL_HPP
+#define ADAPTIVE_INTERVAL_HPP
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * Chooses the SCD30 measurement interval from the recent CO2 dynamics.
+ *
+ * While CO2 changes quickly, e.g. during ventilation, the interval drops immediately to a short value. While CO2 is
+ * stable, the interval is doubled with every sample up to a maximum, which is longest at night in an unoccupied room.
+ */
+class AdaptiveInterval {
+public:
+  static constexpr uint16_t minimumInterval = 2u; // s
+  static constexpr uint16_t maximumInterval = 1800u; // s
+
+  /**
+   * @brief Resets the controller
+   *
+   * @param[in] interval current measurement interval in s
+   */
+  void reset(uint16_t interval);
+
+  /**
+   * @brief Updates the controller with a new sample
+   *
+   * @param[in] time time of sample
+   * @param[in] co2 CO2 concentration in ppm
+   * @return desired measurement interval in s
+   */
+  uint16_t update(time_t time, float co2);
+
+  /// Smoothed rate of change of CO2 in ppm/min
+  float getRateOfChange() const { return _rateOfChange; }
+
+  /// Whether the room seems occupied, i.e. CO2 is clearly above its baseline or rising
+  bool isOccupied() const;
+
+  uint16_t getInterval() const { return _interval; }
+
+private:
+  /// Time constant of the rate of change smoothing
+  static constexpr float rateTimeConstant = 30.0f; // s
+  /// Time constant of the baseline following rising CO2
+  static constexpr float baselineTimeConstant = 24.0f * 60.0f * 60.0f; // s
+  /// CO2 above baseline considered as occupied
+  static constexpr float occupiedCo2 = 150.0f; // ppm
+  /// Rate of change considered as occupied
+  static constexpr float occupiedRateOfChange = 5.0f; // ppm/min
+
+  static constexpr uint16_t maximumIntervalOccupied = 60u; // s
+  static constexpr uint16_t maximumIntervalDay = 300u; // s
+
+  static bool isNight(time_t time);
+
+  uint16_t _interval{minimumInterval};
+  float _rateOfChange{0.0f};
+  float _baseline{0.0f};
+  float _lastCo2{0.0f};
+  time_t _lastTime{0};
+  bool _initialized{false};
+};
+
+#endif
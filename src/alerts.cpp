@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cmath>
+
+#include "alerts.hpp"
+
+namespace {
+
+constexpr LedStrip::Color levelColors[] = {
+  {0u, 0u, 0u}, // Unknown
+  {0u, 255u, 0u}, // Ok
+  {255u, 160u, 0u}, // Warning
+  {255u, 0u, 0u}, // Alarm
+};
+
+}
+
+void Alerts::setup(const Measurements* measurements) {
+  _measurements = measurements;
+  _debounce = std::clamp(_config.getValueAsInt("alertDebounce").value_or(2), 1, 255);
+  _brightness = std::clamp(_config.getValueAsInt("ledBrightness").value_or(8), 0, 31);
+
+  const float co2Hysteresis = _config.getValueAsInt("co2Hysteresis").value_or(50);
+  const float humidityHysteresis = _config.getValueAsInt("humidityHysteresis").value_or(3);
+
+  _rules = {
+    Rule{Channel::Co2, Level::Warning, Quantity::Scd30Co2, true, static_cast<float>(_config.getValueAsInt("co2WarningLevel").value_or(1000)), co2Hysteresis, 0, false},
+    Rule{Channel::Co2, Level::Alarm, Quantity::Scd30Co2, true, static_cast<float>(_config.getValueAsInt("co2AlarmLevel").value_or(1400)), co2Hysteresis, 0, false},
+    Rule{Channel::Humidity, Level::Warning, Quantity::FusedHumidity, false, static_cast<float>(_config.getValueAsInt("humidityLowLevel").value_or(30)), humidityHysteresis, 0, false},
+    Rule{Channel::Humidity, Level::Warning, Quantity::FusedHumidity, true, static_cast<float>(_config.getValueAsInt("humidityHighLevel").value_or(60)), humidityHysteresis, 0, false},
+  };
+
+  const auto numberOfLeds = std::clamp<int>(_config.getValueAsInt("ledsPerStrip").value_or(1), 0, LedStrip::maxNumberOfLeds);
+  for (auto& ledStrip : _ledStrips) {
+    ledStrip.setup(numberOfLeds);
+  }
+
+  updateLeds();
+}
+
+void Alerts::loop() {
+  const auto measurementCounter = _measurements->getMeasurementCounter();
+  if (measurementCounter != _measurementCounter) {
+    _measurementCounter = measurementCounter;
+    evaluate(_measurements->dataLast().getMeasurement(0));
+    updateLeds();
+  }
+
+  for (auto& ledStrip : _ledStrips) {
+    ledStrip.loop();
+  }
+}
+
+void Alerts::evaluate(const Measurement& measurement) {
+  std::array<bool, static_cast<size_t>(Channel::NumberOfChannels)> valid{};
+  _levels.fill(Level::Unknown);
+
+  for (auto& rule : _rules) {
+    const auto value = measurement.data[static_cast<std::underlying_type_t<Quantity>>(rule.quantity)];
+    const auto channel = static_cast<std::underlying_type_t<Channel>>(rule.channel);
+
+    // Missing values keep the rule state
+    if (not std::isnan(value)) {
+      valid[channel] = true;
+
+      // Sign flips the comparison for rules triggering below the threshold
+      const float sign = rule.above ? 1.0f : -1.0f;
+      const bool exceeded = rule.active ? ((value - rule.threshold) * sign > -rule.hysteresis) : ((value - rule.threshold) * sign > 0.0f);
+
+      if (exceeded == rule.active) {
+        rule.count = 0;
+      } else if (++rule.count >= _debounce) {
+        rule.active = exceeded;
+        rule.count = 0;
+      }
+    }
+
+    if (rule.active) {
+      _levels[channel] = std::max(_levels[channel], rule.level);
+    }
+  }
+
+  for (std::size_t channel = 0; channel < _levels.size(); ++channel) {
+    if (valid[channel] or (_levels[channel] != Level::Unknown)) {
+      _levels[channel] = std::max(_levels[channel], Level::Ok);
+    }
+  }
+}
+
+void Alerts::updateLeds() {
+  for (std::size_t channel = 0; channel < _ledStrips.size(); ++channel) {
+    _ledStrips[channel].setColor(levelColors[static_cast<std::underlying_type_t<Level>>(_levels[channel])], _brightness);
+  }
+}
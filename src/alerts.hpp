@@ -0,0 +1,69 @@
+#ifndef ALERTS_HPP
+#define ALERTS_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "config.hpp"
+#include "led_strip.hpp"
+#include "measurements.hpp"
+#include "pins.hpp"
+
+/**
+ * Evaluates threshold rules on every new measurement and shows the result on the LED outputs.
+ *
+ * A rule becomes active once its threshold is exceeded for alertDebounce consecutive samples and inactive once the
+ * value is back beyond threshold and hysteresis for as many samples. LED1 shows the CO2 level, LED2 the humidity.
+ */
+class Alerts {
+public:
+  enum class Level : uint8_t {
+    Unknown,
+    Ok,
+    Warning,
+    Alarm
+  };
+
+  enum class Channel : uint8_t {
+    Co2,
+    Humidity,
+    NumberOfChannels
+  };
+
+  Alerts(const Config& config) : _config{config} {};
+
+  void setup(const Measurements* measurements);
+  void loop();
+
+  Level getLevel(Channel channel) const { return _levels[static_cast<std::underlying_type_t<Channel>>(channel)]; }
+
+private:
+  struct Rule {
+    Channel channel;
+    Level level;
+    Quantity quantity;
+    bool above;
+    float threshold;
+    float hysteresis;
+    uint8_t count;
+    bool active;
+  };
+
+  void evaluate(const Measurement& measurement);
+  void updateLeds();
+
+  const Config& _config;
+  const Measurements* _measurements{};
+  uint32_t _measurementCounter{0};
+  uint8_t _debounce{1};
+  uint8_t _brightness{0};
+
+  std::array<Rule, 4> _rules{};
+  std::array<Level, static_cast<size_t>(Channel::NumberOfChannels)> _levels{};
+  std::array<LedStrip, static_cast<size_t>(Channel::NumberOfChannels)> _ledStrips{
+    LedStrip{HSPI_HOST, 1, pins::Led1Data, pins::Led1Clk},
+    LedStrip{VSPI_HOST, 2, pins::Led2Data, pins::Led2Clk},
+  };
+};
+
+#endif
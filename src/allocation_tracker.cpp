@@ -0,0 +1,254 @@
+#ifdef ALLOCATION_TRACKING
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <array>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_tracker.hpp"
+#include "text_writer.hpp"
+
+struct _reent;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+void __real_free(void* pointer);
+void* __real__malloc_r(struct _reent* reent, size_t size);
+void* __real__calloc_r(struct _reent* reent, size_t count, size_t size);
+void* __real__realloc_r(struct _reent* reent, void* pointer, size_t size);
+void __real__free_r(struct _reent* reent, void* pointer);
+}
+
+namespace allocationTracker {
+
+namespace {
+
+constexpr unsigned long sampleInterval = 10000; // ms
+
+struct Site {
+  uintptr_t address;
+  uint32_t allocations;
+  uint32_t bytes;
+  uint32_t steadyStateAllocations;
+};
+
+struct HeapSample {
+  uint32_t time; // s
+  uint32_t free;
+  uint32_t largestFreeBlock;
+};
+
+/// Open addressing hash table, filled from any task, so it never allocates itself
+std::array<Site, maxNumberOfSites> sites{};
+uint32_t droppedSites = 0;
+uint32_t allocations = 0;
+uint32_t frees = 0;
+uint32_t steadyStateAllocations = 0;
+uint32_t steadyStateBytes = 0;
+TaskHandle_t steadyStateTask = nullptr;
+portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+std::array<HeapSample, numberOfSamples> samples{};
+std::size_t numberOfStoredSamples = 0;
+std::size_t nextSample = 0;
+unsigned long lastSampleMillis = 0;
+
+void record(const void* caller, size_t size) {
+  const auto address = reinterpret_cast<uintptr_t>(caller);
+  const bool steadyState = (steadyStateTask != nullptr) and (xTaskGetCurrentTaskHandle() == steadyStateTask);
+
+  portENTER_CRITICAL(&mux);
+  allocations++;
+  if (steadyState) {
+    steadyStateAllocations++;
+    steadyStateBytes += size;
+  }
+
+  std::size_t index = (address >> 2) % maxNumberOfSites;
+  for (std::size_t i = 0; i < maxNumberOfSites; ++i) {
+    auto& site = sites[index];
+    if ((site.address == address) or (site.address == 0)) {
+      site.address = address;
+      site.allocations++;
+      site.bytes += size;
+      if (steadyState) {
+        site.steadyStateAllocations++;
+      }
+      portEXIT_CRITICAL(&mux);
+      return;
+    }
+    index = (index + 1) % maxNumberOfSites;
+  }
+  droppedSites++;
+  portEXIT_CRITICAL(&mux);
+}
+
+void recordFree(void* pointer) {
+  if (pointer != nullptr) {
+    portENTER_CRITICAL(&mux);
+    frees++;
+    portEXIT_CRITICAL(&mux);
+  }
+}
+
+void sample() {
+  auto& sample = samples[nextSample];
+  sample.time = millis() / 1000;
+  sample.free = ESP.getFreeHeap();
+  sample.largestFreeBlock = ESP.getMaxAllocHeap();
+
+  nextSample = (nextSample + 1) % numberOfSamples;
+  if (numberOfStoredSamples < numberOfSamples) {
+    numberOfStoredSamples++;
+  }
+}
+
+/// Share of free memory not usable for the largest allocation
+float fragmentation(uint32_t free, uint32_t largestFreeBlock) {
+  return (free > 0) ? (1.0f - static_cast<float>(largestFreeBlock) / free) : 0.0f;
+}
+
+}
+
+void markSteadyState() {
+  steadyStateTask = xTaskGetCurrentTaskHandle();
+  sample();
+  lastSampleMillis = millis();
+}
+
+void loop() {
+  if ((millis() - lastSampleMillis) >= sampleInterval) {
+    lastSampleMillis = millis();
+    sample();
+  }
+}
+
+uint32_t getSteadyStateAllocations() {
+  return steadyStateAllocations;
+}
+
+std::size_t renderJson(char* buffer, std::size_t size) {
+  TextWriter writer{buffer, size};
+
+  const auto heapSize = ESP.getHeapSize();
+  const auto free = ESP.getFreeHeap();
+  const auto largestFreeBlock = ESP.getMaxAllocHeap();
+
+  writer.append("{\"version\":\"%s\",\"uptime\":%lu,\"heap\":{\"size\":%u,\"free\":%u,\"peakUsed\":%u,\"largestFreeBlock\":%u,\"fragmentation\":%.3f}",
+    GIT_DESCRIBE, millis(), heapSize, free, heapSize - ESP.getMinFreeHeap(), largestFreeBlock, fragmentation(free, largestFreeBlock));
+
+  writer.append(",\"allocations\":%u,\"frees\":%u,\"steadyState\":{\"allocations\":%u,\"bytes\":%u},\"droppedSites\":%u,\"history\":[",
+    allocations, frees, steadyStateAllocations, steadyStateBytes, droppedSites);
+
+  for (std::size_t i = 0; i < numberOfStoredSamples; ++i) {
+    const auto& sample = samples[(nextSample + numberOfSamples - numberOfStoredSamples + i) % numberOfSamples];
+    writer.append("%s{\"time\":%u,\"free\":%u,\"largestFreeBlock\":%u,\"fragmentation\":%.3f}", (i > 0) ? "," : "",
+      sample.time, sample.free, sample.largestFreeBlock, fragmentation(sample.free, sample.largestFreeBlock));
+  }
+
+  writer.append("],\"sites\":[");
+  bool first = true;
+  for (const auto& site : sites) {
+    if (site.address == 0) {
+      continue;
+    }
+    writer.append("%s{\"address\":\"0x%08x\",\"allocations\":%u,\"bytes\":%u,\"steadyStateAllocations\":%u}", first ? "" : ",",
+      static_cast<unsigned>(site.address), site.allocations, site.bytes, site.steadyStateAllocations);
+    first = false;
+  }
+  writer.append("]}");
+
+  return writer.overflowed() ? 0 : writer.length();
+}
+
+}
+
+extern "C" {
+
+void* __wrap_malloc(size_t size) {
+  allocationTracker::record(__builtin_return_address(0), size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  allocationTracker::record(__builtin_return_address(0), count * size);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+  allocationTracker::record(__builtin_return_address(0), size);
+  return __real_realloc(pointer, size);
+}
+
+void __wrap_free(void* pointer) {
+  allocationTracker::recordFree(pointer);
+  __real_free(pointer);
+}
+
+void* __wrap__malloc_r(struct _reent* reent, size_t size) {
+  allocationTracker::record(__builtin_return_address(0), size);
+  return __real__malloc_r(reent, size);
+}
+
+void* __wrap__calloc_r(struct _reent* reent, size_t count, size_t size) {
+  allocationTracker::record(__builtin_return_address(0), count * size);
+  return __real__calloc_r(reent, count, size);
+}
+
+void* __wrap__realloc_r(struct _reent* reent, void* pointer, size_t size) {
+  allocationTracker::record(__builtin_return_address(0), size);
+  return __real__realloc_r(reent, pointer, size);
+}
+
+void __wrap__free_r(struct _reent* reent, void* pointer) {
+  allocationTracker::recordFree(pointer);
+  __real__free_r(reent, pointer);
+}
+
+}
+
+// Replaced so that allocations are counted for the caller of new instead of the library
+void* operator new(size_t size) {
+  allocationTracker::record(__builtin_return_address(0), size);
+  void* pointer = __real_malloc(size);
+  if (pointer == nullptr) {
+    abort();
+  }
+  return pointer;
+}
+
+void* operator new[](size_t size) {
+  allocationTracker::record(__builtin_return_address(0), size);
+  void* pointer = __real_malloc(size);
+  if (pointer == nullptr) {
+    abort();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+  allocationTracker::recordFree(pointer);
+  __real_free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  allocationTracker::recordFree(pointer);
+  __real_free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  allocationTracker::recordFree(pointer);
+  __real_free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  allocationTracker::recordFree(pointer);
+  __real_free(pointer);
+}
+
+#endif
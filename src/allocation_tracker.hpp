@@ -0,0 +1,57 @@
+#ifndef ALLOCATION_TRACKER_HPP
+#define ALLOCATION_TRACKER_HPP
+
+/**
+ * Heap allocation tracking for finding allocations in the steady state.
+ *
+ * Only available if built with ALLOCATION_TRACKING defined (see env:esp32dev_allocations). That build wraps malloc,
+ * calloc, realloc, free and their reentrant variants used by newlib (e.g. asprintf) at link time and replaces operator
+ * new and delete. Every allocation is counted for the address it was called from. Addresses can be resolved with
+ * xtensa-esp32-elf-addr2line -e .pio/build/esp32dev_allocations/firmware.elf <address>.
+ *
+ * Once markSteadyState() is called at the end of setup(), allocations of the loop task are counted separately. Heap
+ * size, largest free block and fragmentation are sampled periodically.
+ */
+
+#ifdef ALLOCATION_TRACKING
+
+#include <cstddef>
+#include <cstdint>
+
+namespace allocationTracker {
+
+/// Allocations of more call sites than this are only counted in total
+constexpr std::size_t maxNumberOfSites = 64u;
+/// Heap samples kept in the history
+constexpr std::size_t numberOfSamples = 60u;
+
+constexpr std::size_t maxNumberLength = 10u;
+
+/// Upper bound of the renderJson() output with all sites used and all counters at their maximum
+constexpr std::size_t maxJsonLength = 256u + sizeof(GIT_DESCRIBE) + 10u * maxNumberLength
+  + numberOfSamples * (64u + 3u * maxNumberLength)
+  + maxNumberOfSites * (80u + 3u * maxNumberLength);
+
+/// Starts counting allocations of the calling task as steady state allocations
+void markSteadyState();
+
+/// Samples heap statistics every sampleInterval, call from loop()
+void loop();
+
+/// Number of allocations of the loop task since markSteadyState()
+uint32_t getSteadyStateAllocations();
+
+/**
+ * @brief Renders all statistics as JSON
+ *
+ * @param[out] buffer buffer to render into, maxJsonLength + 1 characters are always sufficient
+ * @param[in] size size of buffer
+ * @return number of characters written, 0 if buffer is too small
+ */
+std::size_t renderJson(char* buffer, std::size_t size);
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#include <cstring>
+
+#include "arena.hpp"
+
+void* Arena::allocate(std::size_t size) {
+  const std::size_t start = (_used + alignment - 1) & ~(alignment - 1);
+  if ((start > _size) or (size > (_size - start))) {
+    _numberOfFailures++;
+    return nullptr;
+  }
+
+  _last = start;
+  _used = start + size;
+  if (_used > _peak) {
+    _peak = _used;
+  }
+
+  return &_buffer[start];
+}
+
+void* Arena::reallocate(void* pointer, std::size_t size) {
+  if (pointer == nullptr) {
+    return allocate(size);
+  }
+
+  if ((_last >= _size) or (pointer != &_buffer[_last]) or (size > (_size - _last))) {
+    _numberOfFailures++;
+    return nullptr;
+  }
+
+  _used = _last + size;
+  if (_used > _peak) {
+    _peak = _used;
+  }
+
+  return pointer;
+}
+
+const char* Arena::copy(const char* string) {
+  const std::size_t length = strlen(string) + 1;
+  auto* copy = static_cast<char*>(allocate(length));
+  if (copy != nullptr) {
+    memcpy(copy, string, length);
+  }
+  return copy;
+}
+
+void Arena::release(std::size_t marker) {
+  if (marker < _used) {
+    _used = marker;
+  }
+  // Released memory may be handed out again, so nothing before it can be resized anymore
+  _last = SIZE_MAX;
+}
+
+namespace arena {
+
+Arena& startup() {
+  static StaticArena<startupSize> arena;
+  return arena;
+}
+
+Arena& request() {
+  static StaticArena<requestSize> arena;
+  return arena;
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ArduinoJson.h>
+
+/**
+ * Bump allocator over a fixed buffer.
+ *
+ * Allocations are never freed individually, only the most recent one can be resized in place. reset() releases all
+ * allocations at once. Running out of space returns nullptr instead of falling back to the heap.
+ */
+class Arena {
+public:
+  Arena(uint8_t* buffer, std::size_t size) : _buffer{buffer}, _size{size} {};
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /**
+   * @brief Allocates memory aligned for any type
+   *
+   * @param[in] size number of bytes
+   * @return allocated memory, nullptr if the arena is exhausted
+   */
+  void* allocate(std::size_t size);
+
+  /**
+   * @brief Resizes the most recent allocation in place
+   *
+   * @param[in] pointer memory returned by the most recent allocate()
+   * @param[in] size new number of bytes
+   * @return pointer, nullptr if it is not the most recent allocation or the arena is exhausted
+   */
+  void* reallocate(void* pointer, std::size_t size);
+
+  /// Copies a null terminated string, nullptr if the arena is exhausted
+  const char* copy(const char* string);
+
+  /// Position to release allocations back to, see release()
+  std::size_t mark() const { return _used; }
+
+  /// Releases all allocations made after mark() returned marker
+  void release(std::size_t marker);
+
+  /// Releases all allocations
+  void reset() { release(0); }
+
+  std::size_t getSize() const { return _size; }
+  std::size_t getUsed() const { return _used; }
+  std::size_t getPeak() const { return _peak; }
+  uint32_t getNumberOfFailures() const { return _numberOfFailures; }
+
+private:
+  static constexpr std::size_t alignment = alignof(std::max_align_t);
+
+  uint8_t* _buffer;
+  std::size_t _size;
+  std::size_t _used{0};
+  std::size_t _last{SIZE_MAX};
+  std::size_t _peak{0};
+  uint32_t _numberOfFailures{0};
+};
+
+template <std::size_t N>
+class StaticArena : public Arena {
+public:
+  StaticArena() : Arena{_storage, N} {};
+
+private:
+  alignas(std::max_align_t) uint8_t _storage[N];
+};
+
+/**
+ * Arenas replacing the heap after setup().
+ *
+ * The startup arena holds objects living until restart, e.g. configuration strings copied during setup(). The request
+ * arena holds buffers of a single HTTP request or file operation and is released by RequestScope when it is finished.
+ */
+namespace arena {
+
+constexpr std::size_t startupSize = 1024u;
+constexpr std::size_t requestSize = 12288u;
+
+Arena& startup();
+Arena& request();
+
+/// Releases everything allocated from the request arena during its lifetime, scopes may be nested
+class RequestScope {
+public:
+  RequestScope() : _marker{request().mark()} {};
+  ~RequestScope() { request().release(_marker); }
+
+  RequestScope(const RequestScope&) = delete;
+  RequestScope& operator=(const RequestScope&) = delete;
+
+private:
+  std::size_t _marker;
+};
+
+/// ArduinoJson allocator taking memory from the request arena
+struct RequestAllocator {
+  void* allocate(std::size_t size) { return request().allocate(size); }
+  void deallocate(void*) {}
+  void* reallocate(void* pointer, std::size_t size) { return request().reallocate(pointer, size); }
+};
+
+using RequestJsonDocument = BasicJsonDocument<RequestAllocator>;
+
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "captive_portal.hpp"
+
+namespace {
+
+constexpr std::size_t dnsHeaderSize = 12u;
+constexpr std::size_t maxDnsPacketSize = 512u;
+constexpr uint16_t dnsTypeA = 1u;
+constexpr uint16_t dnsTypeAny = 255u;
+constexpr uint16_t dnsClassIn = 1u;
+
+uint16_t readUint16(const uint8_t* buffer) {
+  return (buffer[0] << 8) | buffer[1];
+}
+
+void writeUint16(uint8_t* buffer, uint16_t value) {
+  buffer[0] = value >> 8;
+  buffer[1] = value;
+}
+
+/**
+ * @brief Turns a query into its response in place
+ *
+ * Only the question is kept, additional records like EDNS options are dropped.
+ *
+ * @param[in,out] buffer query, response on return, must hold maxDnsPacketSize bytes
+ * @param[in] size size of query
+ * @param[in] address address to answer A queries with, in network byte order as stored by IPAddress
+ * @return size of response, 0 if the query is invalid and is not answered
+ */
+std::size_t buildDnsResponse(uint8_t* buffer, std::size_t size, uint32_t address) {
+  // Only standard queries with a single question
+  if ((size < dnsHeaderSize) or ((buffer[2] & 0xF8u) != 0) or (readUint16(&buffer[4]) != 1)) {
+    return 0;
+  }
+
+  std::size_t position = dnsHeaderSize;
+  while ((position < size) and (buffer[position] != 0)) {
+    // Compression is not allowed in a question
+    if ((buffer[position] & 0xC0u) != 0) {
+      return 0;
+    }
+    position += buffer[position] + 1;
+  }
+  position++;
+  if ((position + 4) > size) {
+    return 0;
+  }
+
+  const uint16_t type = readUint16(&buffer[position]);
+  const uint16_t dnsClass = readUint16(&buffer[position + 2]);
+  position += 4;
+
+  const bool answer = ((type == dnsTypeA) or (type == dnsTypeAny)) and (dnsClass == dnsClassIn);
+
+  // Response, authoritative, recursion desired copied from query, no error
+  buffer[2] = 0x84u | (buffer[2] & 0x01u);
+  buffer[3] = 0x00u;
+  writeUint16(&buffer[6], answer ? 1 : 0);
+  writeUint16(&buffer[8], 0);
+  writeUint16(&buffer[10], 0);
+
+  if (answer) {
+    const uint8_t record[] = {
+      0xC0u, dnsHeaderSize, // Pointer to name of question
+      0x00u, dnsTypeA,
+      0x00u, dnsClassIn,
+      0x00u, 0x00u, 0x00u, 0x00u, // TTL of 0, so clients do not cache the portal address after configuration
+      0x00u, 0x04u,
+      static_cast<uint8_t>(address), static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address >> 16), static_cast<uint8_t>(address >> 24),
+    };
+    std::memcpy(&buffer[position], record, sizeof(record));
+    position += sizeof(record);
+  }
+
+  return position;
+}
+
+}
+
+void CaptivePortal::start(const IPAddress& address) {
+  _address = address;
+  _clients.fill(Client{});
+  _started = _udp.begin(dnsPort);
+  if (not _started) {
+    Serial.printf("DNS server start failed.\r\n");
+  }
+}
+
+void CaptivePortal::stop() {
+  if (_started) {
+    _udp.stop();
+    _started = false;
+  }
+}
+
+void CaptivePortal::loop() {
+  if (not _started) {
+    return;
+  }
+
+  for (std::size_t i = 0; i < maxDnsRequestsPerLoop; ++i) {
+    const int size = _udp.parsePacket();
+    if (size <= 0) {
+      return;
+    }
+
+    _numberOfDnsRequests++;
+
+    // Oversized queries are not expected from stub resolvers, they are dropped without reading
+    uint8_t buffer[maxDnsPacketSize];
+    if ((static_cast<std::size_t>(size) > (sizeof(buffer) - 16)) or (not allowRequest(_udp.remoteIP()))) {
+      _numberOfDroppedRequests++;
+      continue;
+    }
+
+    const int received = _udp.read(buffer, size);
+    const auto length = (received > 0) ? buildDnsResponse(buffer, received, _address) : 0;
+    if (length == 0) {
+      continue;
+    }
+
+    _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+    _udp.write(buffer, length);
+    _udp.endPacket();
+  }
+}
+
+bool CaptivePortal::allowHttpRequest(const IPAddress& client) {
+  if (allowRequest(client)) {
+    return true;
+  }
+
+  _numberOfDroppedRequests++;
+  return false;
+}
+
+bool CaptivePortal::allowRequest(uint32_t address) {
+  const auto now = millis();
+
+  // Clients are few, so a linear search is fine. Without a free entry the least recently active client is replaced.
+  auto client = std::find_if(_clients.begin(), _clients.end(), [address](const Client& client) { return client.address == address; });
+  if (client == _clients.end()) {
+    client = std::min_element(_clients.begin(), _clients.end(), [now](const Client& a, const Client& b) {
+      return (now - a.lastRequestMillis) > (now - b.lastRequestMillis);
+    });
+    *client = Client{address, burst, now, now};
+  }
+
+  const unsigned long elapsed = now - client->lastRefillMillis;
+  if (elapsed >= (burst * 1000 / rate)) {
+    client->tokens = burst;
+    client->lastRefillMillis = now;
+  } else if (elapsed >= (1000 / rate)) {
+    const uint32_t refill = elapsed * rate / 1000;
+    client->tokens = std::min(client->tokens + refill, burst);
+    client->lastRefillMillis += refill * 1000 / rate;
+  }
+  client->lastRequestMillis = now;
+
+  if (client->tokens == 0) {
+    return false;
+  }
+
+  client->tokens--;
+  return true;
+}
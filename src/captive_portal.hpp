@@ -0,0 +1,79 @@
+#ifndef CAPTIVE_PORTAL_HPP
+#define CAPTIVE_PORTAL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <IPAddress.h>
+#include <WiFiUdp.h>
+
+/**
+ * DNS responder and request rate limiting for the captive portal of the configuration mode.
+ *
+ * Every DNS query for an A record is answered with the address of the access point, so that the operating system of a
+ * connecting client probes the portal and shows the configuration page. Phones send bursts of these queries and probe
+ * requests when they join, so each loop answers at most maxDnsRequestsPerLoop queries and every client is limited by
+ * a token bucket. Queries above the limit are dropped, HTTP requests above the limit get a short error response.
+ */
+class CaptivePortal {
+public:
+  /// URLs requested by operating systems to detect a captive portal, answered with a redirect to the portal
+  static constexpr std::array<const char*, 9> probePaths{
+    "/generate_204", // Android
+    "/gen_204", // Android
+    "/hotspot-detect.html", // Apple
+    "/library/test/success.html", // Apple
+    "/connecttest.txt", // Windows
+    "/ncsi.txt", // Windows
+    "/redirect", // Windows
+    "/canonical.html", // Firefox
+    "/success.txt", // Firefox
+  };
+
+  void start(const IPAddress& address);
+  void stop();
+
+  /// Answers pending DNS queries, at most maxDnsRequestsPerLoop
+  void loop();
+
+  /**
+   * @brief Checks the rate limit of a HTTP client and counts the request
+   *
+   * @param[in] client address of client
+   * @retval true request allowed
+   * @retval false client exceeded its rate limit
+   */
+  bool allowHttpRequest(const IPAddress& client);
+
+  uint32_t getNumberOfDnsRequests() const { return _numberOfDnsRequests; }
+  uint32_t getNumberOfDroppedRequests() const { return _numberOfDroppedRequests; }
+
+private:
+  static constexpr uint16_t dnsPort{53};
+  static constexpr std::size_t maxDnsRequestsPerLoop{4};
+
+  /// Token bucket per client, a client may send burst requests at once and rate requests per second after that
+  static constexpr std::size_t maxNumberOfClients{8};
+  static constexpr uint32_t burst{20};
+  static constexpr uint32_t rate{10}; // 1/s
+
+  struct Client {
+    uint32_t address;
+    uint32_t tokens;
+    unsigned long lastRefillMillis;
+    unsigned long lastRequestMillis;
+  };
+
+  bool allowRequest(uint32_t address);
+
+  bool _started{false};
+  uint32_t _address{0};
+  WiFiUDP _udp{};
+  std::array<Client, maxNumberOfClients> _clients{};
+
+  uint32_t _numberOfDnsRequests{0};
+  uint32_t _numberOfDroppedRequests{0};
+};
+
+#endif
@@ -1,7 +1,69 @@
 #include "config.hpp"
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 
 #include <SPIFFS.h>
 
+namespace {
+
+const char* typeName(const ConfigEntry::ValueType& value) {
+  if (std::holds_alternative<std::string>(value)) {
+    return "string";
+  } else if (std::holds_alternative<int>(value)) {
+    return "int";
+  } else {
+    return "bool";
+  }
+}
+
+/// Destination is a JSON variant or member, members are only created when set
+template <typename Destination>
+void setJson(Destination&& destination, const ConfigEntry::ValueType& value) {
+  std::visit([&destination](const auto& v) { destination.set(v); }, value);
+}
+
+/**
+ * @brief Converts a JSON value to the type of an entry and checks its range
+ *
+ * @param[in] entry entry to convert for
+ * @param[in] json JSON value
+ * @param[out] value converted value
+ * @return reason if invalid, nullptr if valid
+ */
+const char* convert(const ConfigEntry& entry, JsonVariantConst json, ConfigEntry::ValueType& value) {
+  if (std::holds_alternative<std::string>(entry._value)) {
+    if (not json.is<const char*>()) {
+      return "expected string";
+    }
+    const char* string = json.as<const char*>();
+    if (strlen(string) > Config::maxStringLength) {
+      return "too long";
+    }
+    value = std::string{string};
+  } else if (std::holds_alternative<int>(entry._value)) {
+    if (not json.is<int>()) {
+      return "expected integer";
+    }
+    const int integer = json.as<int>();
+    if ((integer < entry._minimum) or (integer > entry._maximum)) {
+      return "out of range";
+    }
+    value = integer;
+  } else {
+    if (not json.is<bool>()) {
+      return "expected boolean";
+    }
+    value = json.as<bool>();
+  }
+
+  return nullptr;
+}
+
+}
+
 void Config::setup() {
   readFromFile();
 }
@@ -11,17 +73,13 @@ void Config::finish() {
 }
 
 void Config::readFromFile() {
-  auto resultAndJson = readJsonFromFile(configFileName);
+  const arena::RequestScope scope{};
+  arena::RequestJsonDocument json(jsonBufferSize);
 
-  if (not std::get<0>(resultAndJson)) {
-    auto resultAndJson = readJsonFromFile(backupConfigFileName);
-  }
-  if (not std::get<0>(resultAndJson)) {
+  if ((not readJsonFromFile(configFileName, json)) and (not readJsonFromFile(backupConfigFileName, json))) {
     return;
   }
 
-  auto& json = std::get<1>(resultAndJson);
-
   for (auto& entry : _entries) {
     auto jsonEntry = json[entry._name];
 
@@ -39,13 +97,11 @@ void Config::readFromFile() {
   }
 }
 
-std::tuple<bool, DynamicJsonDocument> Config::readJsonFromFile(const char* filename) {
-  DynamicJsonDocument json(jsonBufferSize);
-
+bool Config::readJsonFromFile(const char* filename, JsonDocument& json) {
   auto f = SPIFFS.open(filename, "r");
   if (!f) {
     Serial.printf("Failed to read %s.\r\n", filename);
-    return std::make_tuple(false, json);
+    return false;
   }
 
   DeserializationError err = deserializeJson(json, f);
@@ -53,29 +109,16 @@ std::tuple<bool, DynamicJsonDocument> Config::readJsonFromFile(const char* filen
 
   if (err != DeserializationError::Ok) {
     Serial.printf("Failed to parse JSON of %s: %s.\r\n", filename, err.c_str());
-    return std::make_tuple(false, json);
+    return false;
   }
 
-  return std::make_tuple(true, json);
+  return true;
 }
 
 void Config::writeToFile() {
-  DynamicJsonDocument json(jsonBufferSize);
-
-  for (auto& entry : _entries) {
-    auto jsonEntry = json[entry._name];
-
-    if (auto* value = std::get_if<std::string>(&entry._value)) {
-      jsonEntry.set(*value);
-    } else if (auto* value = std::get_if<int>(&entry._value)) {
-      jsonEntry.set(*value);
-    } else if (auto* value = std::get_if<bool>(&entry._value)) {
-      jsonEntry.set(*value);
-    } else {
-      assert(false);
-    }
-
-  }
+  const arena::RequestScope scope{};
+  arena::RequestJsonDocument json(jsonBufferSize);
+  toJson(json.to<JsonObject>());
 
   SPIFFS.remove(backupConfigFileName);
   SPIFFS.rename(configFileName, backupConfigFileName);
@@ -87,6 +130,70 @@ void Config::writeToFile() {
   }
 }
 
+void Config::toJson(JsonObject object) const {
+  for (const auto& entry : _entries) {
+    setJson(object[entry._name], entry._value);
+  }
+}
+
+void Config::schemaToJson(JsonObject object) const {
+  for (const auto& entry : _entries) {
+    auto schema = object.createNestedObject(entry._name);
+    schema["type"] = typeName(entry._value);
+    setJson(schema["default"], entry._default);
+    if (std::holds_alternative<int>(entry._value)) {
+      schema["minimum"] = entry._minimum;
+      schema["maximum"] = entry._maximum;
+    } else if (std::holds_alternative<std::string>(entry._value)) {
+      schema["maxLength"] = maxStringLength;
+    }
+  }
+}
+
+bool Config::patch(JsonObjectConst changes, JsonObject diff, JsonObject errors) {
+  // Everything is validated before anything is applied, so a bad request leaves the configuration unchanged
+  std::array<std::optional<ValueType>, std::tuple_size<decltype(_entries)>::value> values{};
+  bool valid = true;
+
+  for (const auto change : changes) {
+    const auto name = change.key().c_str();
+    auto entry = std::find_if(_entries.begin(), _entries.end(), [name](const auto& v) { return strcmp(v._name, name) == 0; });
+    if (entry == _entries.end()) {
+      errors[name] = "unknown";
+      valid = false;
+      continue;
+    }
+
+    ValueType value;
+    if (const char* error = convert(*entry, change.value(), value)) {
+      errors[name] = error;
+      valid = false;
+      continue;
+    }
+
+    if (value != entry->_value) {
+      values[std::distance(_entries.begin(), entry)] = std::move(value);
+    }
+  }
+
+  if (not valid) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < _entries.size(); ++i) {
+    if (not values[i]) {
+      continue;
+    }
+
+    auto change = diff.createNestedObject(_entries[i]._name);
+    setJson(change["old"], _entries[i]._value);
+    setJson(change["new"], *values[i]);
+    _entries[i]._value = std::move(*values[i]);
+  }
+
+  return true;
+}
+
 std::optional<Config::ValueType> Config::getValue(const char* name) const
 {
   const auto& entry = getEntry(name);
@@ -111,6 +218,19 @@ std::optional<std::string> Config::getValueAsString(const char* name) const
 }
 
 
+std::optional<const char*> Config::getValueAsCString(const char* name) const
+{
+  const auto& entry = getEntry(name);
+
+  if (entry) {
+    if (auto* value = std::get_if<std::string>(&entry.value().get()._value)) {
+      return value->c_str();
+    }
+  }
+
+  return std::nullopt;
+}
+
 std::optional<int> Config::getValueAsInt(const char* name) const
 {
   auto valueVariant = getValue(name);
@@ -2,6 +2,7 @@
 #define CONFIG_HPP
 
 #include <cstddef>
+#include <climits>
 #include <array>
 #include <variant>
 #include <type_traits>
@@ -10,16 +11,23 @@
 #include <optional>
 
 #include <ArduinoJson.h>
-#include <tuple>
 
 class ConfigEntry {
 public:
   using ValueType = std::variant<std::string, int, bool>;
 
-  ConfigEntry(const char* name, const ValueType& value) : _name{name}, _value{value} {};
+  ConfigEntry(const char* name, const ValueType& value) : _name{name}, _value{value}, _default{value} {};
+  ConfigEntry(const char* name, int value, int minimum, int maximum) : _name{name}, _value{value}, _default{value}, _minimum{minimum}, _maximum{maximum} {};
 
   const char* _name;
   ValueType _value;
+
+  /// Value before the configuration file is read
+  ValueType _default;
+
+  /// Valid range of integer values
+  int _minimum{INT_MIN};
+  int _maximum{INT_MAX};
 };
 
 class Config {
@@ -33,14 +41,40 @@ public:
   void setValue(const char* name, const ValueType& value);
 
   std::optional<std::string> getValueAsString(const char* name) const;
+
+  /// Points into the configuration without copying, valid until the entry is changed
+  std::optional<const char*> getValueAsCString(const char* name) const;
   std::optional<int> getValueAsInt(const char* name) const;
   std::optional<bool> getValueAsBool(const char* name) const;
 
   auto begin() { return _entries.begin(); }
   auto end() { return _entries.end(); }
 
+  /// Writes all values
+  void toJson(JsonObject object) const;
+
+  /// Writes type, default and valid range of all entries
+  void schemaToJson(JsonObject object) const;
+
+  /**
+   * @brief Validates and applies a partial configuration
+   *
+   * Either all values are applied or none. Values equal to the current ones are ignored.
+   *
+   * @param[in] changes names and new values
+   * @param[out] diff old and new value of each changed entry
+   * @param[out] errors reason for each rejected entry
+   * @retval true all values valid and applied
+   * @retval false at least one value invalid, nothing applied
+   */
+  bool patch(JsonObjectConst changes, JsonObject diff, JsonObject errors);
+
+  static constexpr std::size_t jsonBufferSize = 2500;
+
+  /// Longest accepted string value
+  static constexpr std::size_t maxStringLength = 128;
+
 private:
-  static constexpr std::size_t jsonBufferSize = 1000;
   static constexpr const char* configFileName = "/config.json";
   static constexpr const char* backupConfigFileName = "/config.json.backup";
 
@@ -48,20 +82,51 @@ private:
   std::optional<std::reference_wrapper<const ConfigEntry>> getEntry(const char* name) const;
 
   void readFromFile();
-  std::tuple<bool, DynamicJsonDocument> readJsonFromFile(const char* filename);
+  bool readJsonFromFile(const char* filename, JsonDocument& json);
 
   void writeToFile();
 
-  std::array<ConfigEntry, 9> _entries = {
+  std::array<ConfigEntry, 40> _entries = {
     ConfigEntry{"wifiSsid", std::string{""}},
     ConfigEntry{"wifiPassword", std::string{""}},
     ConfigEntry("hostname", std::string{"Co2-Sensor"}),
-    ConfigEntry{"sleepTimeout", int{60}},
+    ConfigEntry{"staticIp", std::string{""}},
+    ConfigEntry{"staticGateway", std::string{""}},
+    ConfigEntry{"staticSubnet", std::string{""}},
+    ConfigEntry{"staticDns", std::string{""}},
+    ConfigEntry{"sleepTimeout", int{60}, 0, 3600},
     ConfigEntry{"ntpServer", std::string{"de.pool.ntp.org"}},
     ConfigEntry{"tzInfo", std::string{"CET-1CEST,M3.5.0,M10.5.0/3"}},
     ConfigEntry{"webUserName", std::string{"admin"}},
     ConfigEntry{"webPassword", std::string{"password"}},
     ConfigEntry{"webAuthentification", bool{false}},
+    ConfigEntry{"mqttBroker", std::string{""}},
+    ConfigEntry{"mqttPort", int{1883}, 1, 65535},
+    ConfigEntry{"mqttTopic", std::string{"co2-sensor"}},
+    ConfigEntry{"mqttQos", int{0}, 0, 2},
+    ConfigEntry{"telemetryGroup", std::string{""}},
+    ConfigEntry{"telemetryPort", int{4321}, 1, 65535},
+    ConfigEntry{"powerSave", bool{false}},
+    ConfigEntry{"adaptiveInterval", bool{false}},
+    ConfigEntry{"scd30TemperatureOffset", int{100}, 0, 2000},
+    ConfigEntry{"pressureDeadband", int{2}, 0, 100},
+    ConfigEntry{"pressureUpdateInterval", int{600}, 0, 86400},
+    ConfigEntry{"filter", std::string{"hampel"}},
+    ConfigEntry{"filterThreshold", int{3}, 1, 20},
+    ConfigEntry{"traceMode", std::string{"off"}},
+    ConfigEntry{"traceSpeedup", int{1000}, 1, 100000},
+    ConfigEntry{"co2Threshold1", int{800}, 400, 10000},
+    ConfigEntry{"co2Threshold2", int{1000}, 400, 10000},
+    ConfigEntry{"co2Threshold3", int{1400}, 400, 10000},
+    ConfigEntry{"co2WarningLevel", int{1000}, 400, 10000},
+    ConfigEntry{"co2AlarmLevel", int{1400}, 400, 10000},
+    ConfigEntry{"co2Hysteresis", int{50}, 0, 1000},
+    ConfigEntry{"humidityLowLevel", int{30}, 0, 100},
+    ConfigEntry{"humidityHighLevel", int{60}, 0, 100},
+    ConfigEntry{"humidityHysteresis", int{3}, 0, 50},
+    ConfigEntry{"alertDebounce", int{2}, 0, 100},
+    ConfigEntry{"ledsPerStrip", int{1}, 0, 16},
+    ConfigEntry{"ledBrightness", int{8}, 0, 31},
   };
 
 };
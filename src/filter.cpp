@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+
+#include "filter.hpp"
+
+namespace {
+
+struct QuantityLimits {
+  float minimum;
+  float maximum;
+  float minimumDeviation;
+};
+
+// Only values read from the sensors are filtered, the fused quantities are derived from the filtered values afterwards
+constexpr std::size_t numberOfSensorQuantities = static_cast<size_t>(Quantity::FusedTemperature);
+static_assert(static_cast<size_t>(Quantity::FusedHumidity) == (static_cast<size_t>(Quantity::NumberOfQuantities) - 1), "Fused quantities have to be last");
+
+// Measurement ranges from the data sheets, minimum deviation about the accuracy of the sensor
+constexpr std::array<QuantityLimits, numberOfSensorQuantities> quantityLimits{{
+  {0.0f, 40000.0f, 30.0f}, // Scd30Co2
+  {-40.0f, 70.0f, 0.4f}, // Scd30Temperature
+  {0.0f, 100.0f, 3.0f}, // Scd30Humidity
+  {300.0f, 1100.0f, 1.0f}, // Bmp280Pressure
+  {-40.0f, 85.0f, 1.0f}, // Bmp280Temperature
+}};
+
+// Scales the MAD to the standard deviation of normally distributed values
+constexpr float madScale = 1.4826f;
+
+}
+
+float HampelFilter::median(std::array<float, windowSize> values, std::size_t size) {
+  // Insertion sort, at most 10 comparisons for the window of 5
+  for (std::size_t i = 1; i < size; ++i) {
+    const float value = values[i];
+    std::size_t j = i;
+    for (; (j > 0) and (values[j - 1] > value); --j) {
+      values[j] = values[j - 1];
+    }
+    values[j] = value;
+  }
+
+  return (size % 2) ? values[size / 2] : (values[size / 2 - 1] + values[size / 2]) / 2.0f;
+}
+
+float HampelFilter::filter(float value, Mode mode, float threshold, float minimumDeviation) {
+  if (std::isnan(value)) {
+    return value;
+  }
+
+  _values[_next] = value;
+  _next = (_next + 1) % windowSize;
+  _size = std::min(_size + 1, windowSize);
+
+  // Too few values for a meaningful median
+  if ((mode == Mode::None) or (_size < 3)) {
+    return value;
+  }
+
+  const float center = median(_values, _size);
+  if (mode == Mode::Median) {
+    return center;
+  }
+
+  std::array<float, windowSize> deviations;
+  for (std::size_t i = 0; i < _size; ++i) {
+    deviations[i] = std::fabs(_values[i] - center);
+  }
+  const float limit = std::max(threshold * madScale * median(deviations, _size), minimumDeviation);
+
+  if (std::fabs(value - center) > limit) {
+    _numberOfReplacedValues++;
+    return center;
+  }
+
+  return value;
+}
+
+void MeasurementFilter::setup(const Config& config) {
+  const auto mode = config.getValueAsString("filter").value_or("hampel");
+  if (mode == "none") {
+    _mode = HampelFilter::Mode::None;
+  } else if (mode == "median") {
+    _mode = HampelFilter::Mode::Median;
+  } else {
+    _mode = HampelFilter::Mode::Hampel;
+  }
+
+  _threshold = std::max(config.getValueAsInt("filterThreshold").value_or(3), 1);
+}
+
+uint32_t MeasurementFilter::filter(Measurement& measurement) {
+  uint32_t rejected = 0;
+
+  for (std::size_t i = 0; i < quantityLimits.size(); ++i) {
+    const auto quantity = static_cast<Quantity>(i);
+    const auto& limits = quantityLimits[i];
+    float value = measurement.data[i];
+
+    if ((not std::isnan(value)) and ((value < limits.minimum) or (value > limits.maximum))) {
+      rejected |= (1u << i);
+      _numberOfRejectedValues[i]++;
+      value = NAN;
+    }
+
+    measurement.set(quantity, _filters[i].filter(value, _mode, _threshold, limits.minimumDeviation));
+  }
+
+  return rejected;
+}
+
+float MeasurementFilter::getMinimum(Quantity quantity) {
+  return quantityLimits[static_cast<std::underlying_type_t<Quantity>>(quantity)].minimum;
+}
+
+float MeasurementFilter::getMaximum(Quantity quantity) {
+  return quantityLimits[static_cast<std::underlying_type_t<Quantity>>(quantity)].maximum;
+}
@@ -0,0 +1,89 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "config.hpp"
+#include "quantity.hpp"
+
+/**
+ * Outlier filter over the last samples of one quantity.
+ *
+ * Keeps a fixed window of raw values, so memory and time per sample are constant. In median mode the output is the
+ * running median. In Hampel mode a value is only replaced by the median if it deviates by more than threshold times
+ * the scaled median absolute deviation (MAD), otherwise it passes unchanged.
+ */
+class HampelFilter {
+public:
+  static constexpr std::size_t windowSize = 5u;
+
+  enum class Mode : uint8_t {
+    None,
+    Median,
+    Hampel
+  };
+
+  /**
+   * @brief Filters a value
+   *
+   * NaN passes unchanged and is not added to the window.
+   *
+   * @param[in] value raw value
+   * @param[in] mode filter mode
+   * @param[in] threshold number of scaled MADs a value may deviate from the median
+   * @param[in] minimumDeviation deviation always accepted, avoids rejecting everything while the signal is flat
+   * @return filtered value
+   */
+  float filter(float value, Mode mode, float threshold, float minimumDeviation);
+
+  /// Number of values replaced since boot
+  uint32_t getNumberOfReplacedValues() const { return _numberOfReplacedValues; }
+
+private:
+  static float median(std::array<float, windowSize> values, std::size_t size);
+
+  std::array<float, windowSize> _values{};
+  std::size_t _next{0};
+  std::size_t _size{0};
+  uint32_t _numberOfReplacedValues{0};
+};
+
+/**
+ * Guards and filters measurements before they are stored.
+ *
+ * Values outside of the range a sensor can report are marked invalid, the remaining ones pass a HampelFilter per
+ * quantity. Fused quantities are computed after filtering and pass unchanged.
+ */
+class MeasurementFilter {
+public:
+  void setup(const Config& config);
+
+  /**
+   * @brief Filters a measurement in place
+   *
+   * @param[in,out] measurement measurement to filter
+   * @return one bit per quantity as in Measurement::valid, set if the value was outside of the sensor range
+   */
+  uint32_t filter(Measurement& measurement);
+
+  /// Range a sensor can report, values outside of it are rejected. Only defined for quantities read from a sensor.
+  static float getMinimum(Quantity quantity);
+  static float getMaximum(Quantity quantity);
+
+  /// Number of values outside of the sensor range since boot
+  uint32_t getNumberOfRejectedValues(Quantity quantity) const { return _numberOfRejectedValues[static_cast<std::underlying_type_t<Quantity>>(quantity)]; }
+
+  /// Number of outliers replaced by the median since boot
+  uint32_t getNumberOfReplacedValues(Quantity quantity) const { return _filters[static_cast<std::underlying_type_t<Quantity>>(quantity)].getNumberOfReplacedValues(); }
+
+private:
+  HampelFilter::Mode _mode{HampelFilter::Mode::Hampel};
+  float _threshold{3.0f};
+
+  std::array<HampelFilter, static_cast<size_t>(Quantity::NumberOfQuantities)> _filters{};
+  std::array<uint32_t, static_cast<size_t>(Quantity::NumberOfQuantities)> _numberOfRejectedValues{};
+};
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef HISTORY_FRAME_HPP
+#define HISTORY_FRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+
+/**
+ * Binary history frame (little-endian):
+ *
+ *   magic              4 bytes  "C2HF"
+ *   version            uint8
+ *   numberOfQuantities uint8
+ *   numberOfSamples    uint16
+ *   exponents          int8 per quantity, value = raw * 10^exponent
+ *   samples            oldest first, numberOfSamples times:
+ *     time             zigzag varint, absolute for the first sample, delta to the previous sample afterwards
+ *     values           zigzag varint per quantity, invalidValue marks a missing value
+ *
+ * This header has no Arduino dependencies, so the decoder can be used on the host as reference.
+ */
+namespace historyFrame {
+
+constexpr uint8_t magic[4] = {'C', '2', 'H', 'F'};
+constexpr uint8_t version = 1u;
+constexpr int32_t invalidValue = INT32_MIN;
+constexpr std::size_t maxNumberOfQuantities = 16u;
+
+inline uint64_t zigzagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1u);
+}
+
+inline int32_t toFixedPoint(float value, int8_t exponent) {
+  if (std::isnan(value)) {
+    return invalidValue;
+  }
+
+  const double raw = std::round(value * std::pow(10.0, -exponent));
+  if ((raw <= static_cast<double>(INT32_MIN)) or (raw > static_cast<double>(INT32_MAX))) {
+    return invalidValue;
+  }
+
+  return static_cast<int32_t>(raw);
+}
+
+inline float fromFixedPoint(int32_t raw, int8_t exponent) {
+  if (raw == invalidValue) {
+    return NAN;
+  }
+
+  return raw * std::pow(10.0, exponent);
+}
+
+/**
+ * Streams a frame through a fixed size buffer into a sink.
+ *
+ * The complete frame is never held in memory, samples are encoded directly from the storage they are read from.
+ */
+class Encoder {
+public:
+  using Sink = std::function<void(const uint8_t* data, std::size_t size)>;
+
+  explicit Encoder(const Sink& sink) : _sink{sink} {};
+
+  void begin(uint8_t numberOfQuantities, const int8_t* exponents, uint16_t numberOfSamples) {
+    _numberOfQuantities = numberOfQuantities;
+    _exponents = exponents;
+    _lastTime = 0;
+    _first = true;
+
+    writeBytes(magic, sizeof(magic));
+    writeByte(version);
+    writeByte(numberOfQuantities);
+    writeByte(numberOfSamples);
+    writeByte(numberOfSamples >> 8);
+    for (uint8_t i = 0; i < numberOfQuantities; ++i) {
+      writeByte(static_cast<uint8_t>(exponents[i]));
+    }
+  }
+
+  void addSample(int64_t time, const float* values) {
+    writeVarint(zigzagEncode(_first ? time : (time - _lastTime)));
+    _lastTime = time;
+    _first = false;
+
+    for (uint8_t i = 0; i < _numberOfQuantities; ++i) {
+      writeVarint(zigzagEncode(toFixedPoint(values[i], _exponents[i])));
+    }
+  }
+
+  void finish() {
+    flush();
+  }
+
+private:
+  static constexpr std::size_t bufferSize = 256u;
+  static constexpr std::size_t maxVarintSize = 10u;
+
+  void writeByte(uint8_t value) {
+    if (_size == bufferSize) {
+      flush();
+    }
+    _buffer[_size++] = value;
+  }
+
+  void writeBytes(const uint8_t* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+      writeByte(data[i]);
+    }
+  }
+
+  void writeVarint(uint64_t value) {
+    if ((bufferSize - _size) < maxVarintSize) {
+      flush();
+    }
+    while (value >= 0x80u) {
+      _buffer[_size++] = static_cast<uint8_t>(value) | 0x80u;
+      value >>= 7;
+    }
+    _buffer[_size++] = static_cast<uint8_t>(value);
+  }
+
+  void flush() {
+    if (_size > 0) {
+      _sink(_buffer, _size);
+      _size = 0;
+    }
+  }
+
+  Sink _sink;
+  uint8_t _buffer[bufferSize];
+  std::size_t _size{0};
+  uint8_t _numberOfQuantities{0};
+  const int8_t* _exponents{};
+  int64_t _lastTime{0};
+  bool _first{true};
+};
+
+/**
+ * Reference decoder for frames created by Encoder.
+ */
+class Decoder {
+public:
+  Decoder(const uint8_t* data, std::size_t size) : _data{data}, _size{size} {};
+
+  /**
+   * @brief Reads and checks the frame header
+   *
+   * @retval true header valid
+   * @retval false header invalid or unsupported version
+   */
+  bool readHeader() {
+    for (const auto byte : magic) {
+      uint8_t value;
+      if ((not readByte(value)) or (value != byte)) {
+        return false;
+      }
+    }
+
+    uint8_t frameVersion, low, high;
+    if ((not readByte(frameVersion)) or (frameVersion != version)) {
+      return false;
+    }
+
+    if ((not readByte(_numberOfQuantities)) or (_numberOfQuantities > maxNumberOfQuantities)) {
+      return false;
+    }
+
+    if ((not readByte(low)) or (not readByte(high))) {
+      return false;
+    }
+    _numberOfSamples = low | (high << 8);
+
+    for (uint8_t i = 0; i < _numberOfQuantities; ++i) {
+      uint8_t value;
+      if (not readByte(value)) {
+        return false;
+      }
+      _exponents[i] = static_cast<int8_t>(value);
+    }
+
+    _remainingSamples = _numberOfSamples;
+    _time = 0;
+    return true;
+  }
+
+  /**
+   * @brief Reads the next sample
+   *
+   * @param[out] time time of sample
+   * @param[out] values values of sample, must hold numberOfQuantities() entries
+   * @retval true sample read
+   * @retval false no more samples or frame truncated
+   */
+  bool readSample(int64_t& time, float* values) {
+    if (_remainingSamples == 0) {
+      return false;
+    }
+
+    uint64_t value;
+    if (not readVarint(value)) {
+      return false;
+    }
+    _time = (_remainingSamples == _numberOfSamples) ? zigzagDecode(value) : (_time + zigzagDecode(value));
+
+    for (uint8_t i = 0; i < _numberOfQuantities; ++i) {
+      if (not readVarint(value)) {
+        return false;
+      }
+      values[i] = fromFixedPoint(static_cast<int32_t>(zigzagDecode(value)), _exponents[i]);
+    }
+
+    time = _time;
+    _remainingSamples--;
+    return true;
+  }
+
+  uint8_t numberOfQuantities() const { return _numberOfQuantities; }
+  uint16_t numberOfSamples() const { return _numberOfSamples; }
+  int8_t exponent(uint8_t quantity) const { return _exponents[quantity]; }
+
+private:
+  bool readByte(uint8_t& value) {
+    if (_position >= _size) {
+      return false;
+    }
+    value = _data[_position++];
+    return true;
+  }
+
+  bool readVarint(uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (not readByte(byte)) {
+        return false;
+      }
+      value |= static_cast<uint64_t>(byte & 0x7Fu) << shift;
+      if ((byte & 0x80u) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const uint8_t* _data;
+  std::size_t _size;
+  std::size_t _position{0};
+  uint8_t _numberOfQuantities{0};
+  uint16_t _numberOfSamples{0};
+  uint16_t _remainingSamples{0};
+  int8_t _exponents[maxNumberOfQuantities]{};
+  int64_t _time{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include <Arduino.h>
+
+#include <cstring>
+
+#include "history_store.hpp"
+#include "trace_format.hpp"
+
+namespace {
+
+constexpr uint8_t numberOfQuantities = static_cast<uint8_t>(Quantity::NumberOfQuantities);
+static_assert(numberOfQuantities <= traceFormat::maxNumberOfQuantities);
+
+/// Files start with a trace header, records are a sequence number followed by a trace record
+constexpr uint8_t magic[4] = {'C', '2', 'H', 'S'};
+constexpr std::size_t headerSize = traceFormat::headerSize;
+constexpr std::size_t recordSize = sizeof(uint32_t) + traceFormat::recordSize(numberOfQuantities);
+
+void encodeHeader(uint8_t* buffer) {
+  traceFormat::encodeHeader(buffer, numberOfQuantities);
+  std::memcpy(buffer, magic, sizeof(magic));
+}
+
+bool checkHeader(File& file) {
+  uint8_t header[headerSize];
+  uint8_t expected[headerSize];
+  encodeHeader(expected);
+  return (file.read(header, sizeof(header)) == sizeof(header)) and (std::memcmp(header, expected, sizeof(header)) == 0);
+}
+
+/// Number of complete records, a record truncated by a reset is ignored
+std::size_t numberOfRecords(const File& file) {
+  return (file.size() > headerSize) ? ((file.size() - headerSize) / recordSize) : 0;
+}
+
+bool readRecord(File& file, std::size_t index, Measurement& measurement) {
+  uint8_t record[recordSize];
+  if ((not file.seek(headerSize + index * recordSize)) or (file.read(record, sizeof(record)) != sizeof(record))) {
+    return false;
+  }
+
+  uint32_t time;
+  uint8_t valid;
+  measurement.sequence = traceFormat::readUint32(record);
+  traceFormat::decodeRecord(&record[sizeof(uint32_t)], time, valid, measurement.data.data(), numberOfQuantities);
+  measurement.time = time;
+  measurement.valid = valid;
+  return true;
+}
+
+/// Removes a file written by an incompatible firmware
+void checkFile(const char* fileName) {
+  if (not SPIFFS.exists(fileName)) {
+    return;
+  }
+
+  File file = SPIFFS.open(fileName, "r");
+  const bool compatible = checkHeader(file);
+  file.close();
+
+  if (not compatible) {
+    Serial.printf("Removing incompatible history %s.\r\n", fileName);
+    SPIFFS.remove(fileName);
+  }
+}
+
+}
+
+uint32_t HistoryStore::setup() {
+  checkFile(previousFileName);
+  checkFile(currentFileName);
+
+  uint32_t lastSequence = 0;
+  _firstSequence = 0;
+  for (const auto fileName : {previousFileName, currentFileName}) {
+    if (not SPIFFS.exists(fileName)) {
+      continue;
+    }
+
+    File file = SPIFFS.open(fileName, "r");
+    const auto records = numberOfRecords(file);
+    Measurement measurement{};
+    if ((records > 0) and readRecord(file, 0, measurement) and (_firstSequence == 0)) {
+      _firstSequence = measurement.sequence;
+    }
+    if ((records > 0) and readRecord(file, records - 1, measurement)) {
+      lastSequence = measurement.sequence;
+    }
+    file.close();
+  }
+
+  _available = true;
+  _batchLength = 0;
+
+  if (lastSequence == 0) {
+    Serial.printf("History empty.\r\n");
+    return 1;
+  }
+
+  Serial.printf("History from %u to %u.\r\n", _firstSequence, lastSequence);
+  return lastSequence + batchSize + 1;
+}
+
+void HistoryStore::add(const Measurement& measurement) {
+  if (not _available) {
+    return;
+  }
+
+  _batch[_batchLength++] = measurement;
+  if (_batchLength == _batch.size()) {
+    flush();
+  }
+}
+
+void HistoryStore::flush() {
+  File file = SPIFFS.open(currentFileName, "a");
+  if (not file) {
+    Serial.printf("Opening history failed.\r\n");
+    _batchLength = 0;
+    return;
+  }
+
+  // Records after a truncated one would be misaligned, so the file is restarted
+  if ((file.size() > 0) and ((file.size() < headerSize) or (((file.size() - headerSize) % recordSize) != 0))) {
+    Serial.printf("History truncated, restarting.\r\n");
+    file.close();
+    file = SPIFFS.open(currentFileName, "w");
+  }
+
+  if (file.size() == 0) {
+    uint8_t header[headerSize];
+    encodeHeader(header);
+    file.write(header, sizeof(header));
+  }
+
+  uint8_t records[batchSize * recordSize];
+  for (std::size_t i = 0; i < _batchLength; ++i) {
+    const auto& measurement = _batch[i];
+    auto* record = &records[i * recordSize];
+    traceFormat::writeUint32(record, measurement.sequence);
+    traceFormat::encodeRecord(&record[sizeof(uint32_t)], measurement.time, measurement.valid, measurement.data.data(), numberOfQuantities);
+  }
+  if (file.write(records, _batchLength * recordSize) != (_batchLength * recordSize)) {
+    Serial.printf("Writing history failed.\r\n");
+  }
+
+  if (_firstSequence == 0) {
+    _firstSequence = _batch[0].sequence;
+  }
+  _batchLength = 0;
+
+  const auto size = file.size();
+  file.close();
+
+  if (size >= maxFileSize) {
+    SPIFFS.remove(previousFileName);
+    SPIFFS.rename(currentFileName, previousFileName);
+
+    File previous = SPIFFS.open(previousFileName, "r");
+    Measurement first{};
+    _firstSequence = ((numberOfRecords(previous) > 0) and readRecord(previous, 0, first)) ? first.sequence : 0;
+    previous.close();
+  }
+}
+
+void HistoryStore::read(uint32_t since, uint32_t until, const Callback& callback) const {
+  if (readFile(previousFileName, since, until, callback)) {
+    readFile(currentFileName, since, until, callback);
+  }
+}
+
+bool HistoryStore::readFile(const char* fileName, uint32_t since, uint32_t until, const Callback& callback) const {
+  File file = SPIFFS.open(fileName, "r");
+  if (not file) {
+    return true;
+  }
+
+  // Binary search for the first record after the cursor
+  Measurement measurement{};
+  std::size_t low = 0;
+  std::size_t high = numberOfRecords(file);
+  while (low < high) {
+    const auto middle = low + (high - low) / 2;
+    if (not readRecord(file, middle, measurement)) {
+      high = middle;
+    } else if (measurement.sequence <= since) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  bool proceed = true;
+  for (std::size_t i = low; readRecord(file, i, measurement); ++i) {
+    if (measurement.sequence >= until) {
+      proceed = false;
+      break;
+    }
+    if (not callback(measurement)) {
+      proceed = false;
+      break;
+    }
+  }
+
+  file.close();
+  return proceed;
+}
@@ -0,0 +1,79 @@
+#ifndef HISTORY_STORE_HPP
+#define HISTORY_STORE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <SPIFFS.h>
+
+#include "quantity.hpp"
+
+/**
+ * Keeps measurements on flash, so a collector can fetch samples it missed while it was down.
+ *
+ * Measurements are buffered in RAM and appended to currentFileName in batches of batchSize to limit flash writes.
+ * When the file reaches maxFileSize it replaces previousFileName, so the flash holds between one and two files of
+ * history. Records are stored in ascending sequence order, which allows a binary search for a cursor.
+ *
+ * Sequence numbers continue across reboots. As buffered measurements are lost on reboot, numbering continues one batch
+ * after the last stored measurement, so a collector never sees a sequence number twice.
+ */
+class HistoryStore {
+public:
+  /// Called for each measurement read, returns false to stop reading
+  using Callback = std::function<bool(const Measurement& measurement)>;
+
+  static constexpr const char* currentFileName = "/history.bin";
+  static constexpr const char* previousFileName = "/history.old";
+
+  /**
+   * @brief Opens the history and finds the last stored sequence number
+   *
+   * @return sequence number for the next measurement, starting at 1
+   */
+  uint32_t setup();
+
+  /**
+   * @brief Adds a measurement, sequence numbers must increase
+   *
+   * @param[in] measurement measurement to add
+   */
+  void add(const Measurement& measurement);
+
+  /**
+   * @brief Reads stored measurements in sequence order
+   *
+   * Only measurements already written to flash are read, the latest ones are in the RAM ring of Measurements.
+   *
+   * @param[in] since only measurements with a higher sequence number are read
+   * @param[in] until only measurements with a lower sequence number are read
+   * @param[in] callback called for each measurement
+   */
+  void read(uint32_t since, uint32_t until, const Callback& callback) const;
+
+  /// Lowest sequence number on flash, 0 if empty
+  uint32_t getFirstSequence() const { return _firstSequence; }
+
+private:
+  static constexpr std::size_t batchSize = 16u;
+  static constexpr std::size_t maxFileSize = 64u * 1024u;
+
+  void flush();
+
+  /**
+   * @brief Reads measurements of one file
+   *
+   * @retval true continue with the next file
+   * @retval false callback requested to stop
+   */
+  bool readFile(const char* fileName, uint32_t since, uint32_t until, const Callback& callback) const;
+
+  bool _available{false};
+  std::array<Measurement, batchSize> _batch{};
+  std::size_t _batchLength{0};
+  uint32_t _firstSequence{0};
+};
+
+#endif
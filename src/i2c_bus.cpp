@@ -0,0 +1,153 @@
+#include <Arduino.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "i2c_bus.hpp"
+
+namespace {
+
+struct KnownDevice {
+  I2cBus::Device device;
+  uint8_t address;
+  /// Highest clock supported in Hz
+  uint32_t maximumClock;
+  /// Register holding a chip id, 0 if the device has none
+  uint8_t chipIdRegister;
+  uint8_t chipId;
+  const char* name;
+};
+
+// Sorted by address, first match wins
+constexpr KnownDevice knownDevices[] = {
+  // Clock stretching of the SCD30 is only specified up to 100 kHz
+  {I2cBus::Device::Scd30, 0x61u, 100000u, 0x00u, 0x00u, "SCD30"},
+  {I2cBus::Device::Bmp280, 0x76u, 400000u, 0xD0u, 0x58u, "BMP280"},
+  {I2cBus::Device::Bmp280, 0x77u, 400000u, 0xD0u, 0x58u, "BMP280"},
+};
+
+constexpr const char* deviceNames[] = {
+  "SCD30",
+  "BMP280",
+};
+
+static_assert(std::size(deviceNames) == static_cast<size_t>(I2cBus::Device::NumberOfDevices));
+
+/// Weight of a new transfer in the error rate
+constexpr float errorRateWeight = 0.01f;
+
+}
+
+void I2cBus::setup() {
+  const Lock lock{*this};
+
+  _wire.begin(_sda, _scl, standardClock);
+  scan();
+  _wire.setClock(_clock);
+}
+
+void I2cBus::scan() {
+  _addresses.fill(0);
+  _numberOfDevicesFound = 0;
+  uint32_t clock = UINT32_MAX;
+
+  // Addresses below 0x08 and above 0x77 are reserved
+  for (uint8_t address = 0x08u; address <= 0x77u; ++address) {
+    if (not probe(address)) {
+      continue;
+    }
+    _numberOfDevicesFound++;
+
+    const KnownDevice* known = nullptr;
+    for (const auto& knownDevice : knownDevices) {
+      uint8_t chipId = 0;
+      if ((knownDevice.address == address) and (_addresses[static_cast<std::underlying_type_t<Device>>(knownDevice.device)] == 0)
+        and ((knownDevice.chipIdRegister == 0) or (readRegister(address, knownDevice.chipIdRegister, chipId) and (chipId == knownDevice.chipId)))) {
+        known = &knownDevice;
+        break;
+      }
+    }
+
+    if (known) {
+      Serial.printf("I2C 0x%02x: %s\r\n", address, known->name);
+      _addresses[static_cast<std::underlying_type_t<Device>>(known->device)] = address;
+      clock = std::min(clock, known->maximumClock);
+    } else {
+      Serial.printf("I2C 0x%02x: unknown device\r\n", address);
+      clock = std::min(clock, standardClock);
+    }
+  }
+
+  _clock = (clock == UINT32_MAX) ? standardClock : clock;
+  Serial.printf("I2C: %u devices found, clock %u Hz.\r\n", _numberOfDevicesFound, _clock);
+
+  for (std::size_t i = 0; i < _addresses.size(); ++i) {
+    if (_addresses[i] == 0) {
+      Serial.printf("I2C: %s not found.\r\n", deviceNames[i]);
+    }
+  }
+}
+
+bool I2cBus::probe(uint8_t address) {
+  _wire.beginTransmission(address);
+  return _wire.endTransmission() == 0;
+}
+
+bool I2cBus::readRegister(uint8_t address, uint8_t reg, uint8_t& value) {
+  _wire.beginTransmission(address);
+  _wire.write(reg);
+  if (_wire.endTransmission(false) != 0) {
+    return false;
+  }
+
+  if ((_wire.requestFrom(address, static_cast<size_t>(1)) != 1) or (_wire.available() != 1)) {
+    return false;
+  }
+
+  value = _wire.read();
+  return true;
+}
+
+bool I2cBus::recover() {
+  const Lock lock{*this};
+
+  // A slave interrupted in the middle of a read holds SDA low until it shifted out the remaining bits of its byte.
+  // Clocking SCL until SDA is released followed by a stop condition brings it back to idle.
+  static constexpr unsigned int halfClock = 5; // µs, 100 kHz
+  static constexpr uint8_t maxClocks = 9;
+
+  pinMode(_sda, INPUT_PULLUP);
+  pinMode(_scl, OUTPUT_OPEN_DRAIN);
+  digitalWrite(_scl, HIGH);
+  delayMicroseconds(halfClock);
+
+  for (uint8_t clock = 0; (clock < maxClocks) and (digitalRead(_sda) == LOW); ++clock) {
+    digitalWrite(_scl, LOW);
+    delayMicroseconds(halfClock);
+    digitalWrite(_scl, HIGH);
+    delayMicroseconds(halfClock);
+  }
+
+  // Stop condition
+  pinMode(_sda, OUTPUT_OPEN_DRAIN);
+  digitalWrite(_sda, LOW);
+  delayMicroseconds(halfClock);
+  digitalWrite(_sda, HIGH);
+  delayMicroseconds(halfClock);
+
+  pinMode(_sda, INPUT_PULLUP);
+  const bool released = (digitalRead(_sda) == HIGH);
+
+  _wire.begin(_sda, _scl, _clock);
+
+  return released;
+}
+
+void I2cBus::countTransfer(Device device, bool success) {
+  auto& statistics = _statistics[static_cast<std::underlying_type_t<Device>>(device)];
+  statistics.transfers++;
+  if (not success) {
+    statistics.failures++;
+  }
+  statistics.errorRate += ((success ? 0.0f : 1.0f) - statistics.errorRate) * errorRateWeight;
+}
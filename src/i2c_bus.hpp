@@ -0,0 +1,100 @@
+#ifndef I2C_BUS_HPP
+#define I2C_BUS_HPP
+
+#include <array>
+#include <cstdint>
+
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * Owns the I2C bus shared by the sensors.
+ *
+ * At setup the bus is scanned and the devices found are matched against a table of known devices, so board variants
+ * with other addresses work with the same firmware. The bus then runs at the highest clock all devices found support.
+ * Drivers hold a Lock for the duration of multi-transfer sequences and report the result of their transfers, which is
+ * tracked per device.
+ */
+class I2cBus {
+public:
+  enum class Device : uint8_t {
+    Scd30,
+    Bmp280,
+    NumberOfDevices
+  };
+
+  struct DeviceStatistics {
+    uint32_t transfers;
+    uint32_t failures;
+    /// Exponentially weighted share of failed transfers over about the last 100 transfers
+    float errorRate;
+  };
+
+  /// Scoped exclusive access to the bus, may be nested
+  class Lock {
+  public:
+    explicit Lock(I2cBus& bus) : _bus{bus} { xSemaphoreTakeRecursive(_bus._mutex, portMAX_DELAY); }
+    ~Lock() { xSemaphoreGiveRecursive(_bus._mutex); }
+
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+
+  private:
+    I2cBus& _bus;
+  };
+
+  I2cBus(TwoWire& wire, uint8_t sda, uint8_t scl) : _wire{wire}, _sda{sda}, _scl{scl} {};
+
+  /// Initializes the bus, scans it and sets the clock
+  void setup();
+
+  /**
+   * @brief Releases a slave holding SDA low and reinitializes the bus
+   *
+   * @retval true SDA released
+   * @retval false SDA still low
+   */
+  bool recover();
+
+  bool isPresent(Device device) const { return _addresses[static_cast<std::underlying_type_t<Device>>(device)] != 0; }
+
+  /// Address the device was found at, 0 if not found
+  uint8_t getAddress(Device device) const { return _addresses[static_cast<std::underlying_type_t<Device>>(device)]; }
+
+  /// Clock of the bus in Hz
+  uint32_t getClock() const { return _clock; }
+
+  /// Number of devices found during the scan, including unknown ones
+  uint8_t getNumberOfDevicesFound() const { return _numberOfDevicesFound; }
+
+  /**
+   * @brief Records the result of a transfer
+   *
+   * @param[in] device device transferred with
+   * @param[in] success transfer result
+   */
+  void countTransfer(Device device, bool success);
+
+  const DeviceStatistics& getStatistics(Device device) const { return _statistics[static_cast<std::underlying_type_t<Device>>(device)]; }
+
+private:
+  /// Used for the scan and whenever an unknown device is present
+  static constexpr uint32_t standardClock = 100000u; // Hz
+
+  bool probe(uint8_t address);
+  bool readRegister(uint8_t address, uint8_t reg, uint8_t& value);
+  void scan();
+
+  TwoWire& _wire;
+  const uint8_t _sda;
+  const uint8_t _scl;
+  SemaphoreHandle_t _mutex{xSemaphoreCreateRecursiveMutex()};
+
+  uint32_t _clock{standardClock};
+  uint8_t _numberOfDevicesFound{0};
+  std::array<uint8_t, static_cast<size_t>(Device::NumberOfDevices)> _addresses{};
+  std::array<DeviceStatistics, static_cast<size_t>(Device::NumberOfDevices)> _statistics{};
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include "instrumentation.hpp"
+
+#ifdef INSTRUMENTATION
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#include "text_writer.hpp"
+
+namespace instrumentation {
+
+namespace {
+
+struct RegisterInfo {
+  Scd30::Register reg;
+  const char* name;
+};
+
+constexpr RegisterInfo scd30Registers[] = {
+  {Scd30::Register::TriggerContinousMeasurement, "triggerContinousMeasurement"},
+  {Scd30::Register::StopContinousMeasurement, "stopContinousMeasurement"},
+  {Scd30::Register::MeasurementInterval, "measurementInterval"},
+  {Scd30::Register::DataReadyStatus, "dataReadyStatus"},
+  {Scd30::Register::Measurement, "measurement"},
+  {Scd30::Register::AutomaticSelfCalibration, "automaticSelfCalibration"},
+  {Scd30::Register::ForcedRecalibrationValue, "forcedRecalibrationValue"},
+  {Scd30::Register::TemperatureOffset, "temperatureOffset"},
+  {Scd30::Register::AltitudeCompensation, "altitudeCompensation"},
+  {Scd30::Register::FirmwareVersion, "firmwareVersion"},
+  {Scd30::Register::SoftReset, "softReset"},
+};
+
+constexpr const char* timerNames[] = {
+  "mainLoop",
+  "networkLoop",
+  "uiLoop",
+  "measurementsLoop",
+};
+
+constexpr const char* routeNames[] = {
+  "root",
+  "config",
+  "apiConfig",
+  "update",
+  "historyBinary",
+  "history",
+  "metrics",
+  "diagnostics",
+  "allocations",
+  "trace",
+  "captivePortalProbe",
+  "notFound",
+};
+
+constexpr const char* sampleEventNames[] = {
+  "ready",
+  "stored",
+  "displayed",
+  "served",
+};
+
+constexpr bool namesFit(const char* const* names, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    if (std::char_traits<char>::length(names[i]) > maxNameLength) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(std::size(scd30Registers) == numberOfScd30Registers);
+static_assert(std::size(sampleEventNames) == static_cast<size_t>(SampleEvent::NumberOfSampleEvents));
+static_assert(std::size(timerNames) == static_cast<size_t>(Timer::NumberOfTimers));
+static_assert(std::size(routeNames) == static_cast<size_t>(Route::NumberOfRoutes));
+static_assert(namesFit(timerNames, std::size(timerNames)) and namesFit(routeNames, std::size(routeNames))
+  and namesFit(sampleEventNames, std::size(sampleEventNames)), "maxJsonLength assumes shorter names");
+
+std::array<Histogram, static_cast<size_t>(Timer::NumberOfTimers)> timers{};
+std::array<RouteStatistics, static_cast<size_t>(Route::NumberOfRoutes)> routes{};
+std::array<TransferStatistics, std::size(scd30Registers)> scd30Transfers{};
+Route currentRoute{Route::NumberOfRoutes};
+
+// Latency histograms of all stages after Ready
+std::array<Histogram, static_cast<size_t>(SampleEvent::NumberOfSampleEvents)> sampleLatencies{};
+std::array<bool, static_cast<size_t>(SampleEvent::NumberOfSampleEvents)> sampleEventsSeen{};
+unsigned long sampleReadyTime{0};
+
+uint32_t cyclesToMicroseconds(uint32_t cycles) {
+  return cycles / ESP.getCpuFreqMHz();
+}
+
+void renderHistogram(TextWriter& writer, const Histogram& histogram) {
+  writer.append("{\"count\":%u,\"mean\":%u,\"min\":%u,\"max\":%u,\"p50\":%u,\"p95\":%u,\"buckets\":[",
+    histogram.getCount(), histogram.getMean(), histogram.getCount() ? histogram.getMinimum() : 0, histogram.getMaximum(),
+    histogram.getPercentile(50), histogram.getPercentile(95));
+  for (size_t i = 0; i < histogram.getBuckets().size(); ++i) {
+    writer.append("%s%u", i > 0 ? "," : "", histogram.getBuckets()[i]);
+  }
+  writer.append("]}");
+}
+
+}
+
+void Histogram::add(uint32_t duration) {
+  std::size_t bucket = 0;
+  for (uint32_t value = duration >> 1; (value > 0) and (bucket < (numberOfBuckets - 1)); value >>= 1) {
+    bucket++;
+  }
+
+  _buckets[bucket]++;
+  _count++;
+  _sum += duration;
+  _minimum = std::min(_minimum, duration);
+  _maximum = std::max(_maximum, duration);
+}
+
+uint32_t Histogram::getPercentile(uint8_t percentile) const {
+  if (_count == 0) {
+    return 0;
+  }
+
+  const uint64_t rank = (static_cast<uint64_t>(_count) * percentile + 99) / 100;
+  uint64_t sum = 0;
+  for (std::size_t bucket = 0; bucket < numberOfBuckets; ++bucket) {
+    sum += _buckets[bucket];
+    if ((sum >= rank) and (sum > 0)) {
+      return (bucket == (numberOfBuckets - 1)) ? _maximum : std::min(_maximum, (2u << bucket) - 1);
+    }
+  }
+
+  return _maximum;
+}
+
+void addTime(Timer timer, uint32_t cycles) {
+  timers[static_cast<std::underlying_type_t<Timer>>(timer)].add(cyclesToMicroseconds(cycles));
+}
+
+void beginRoute(Route route) {
+  currentRoute = route;
+  routes[static_cast<std::underlying_type_t<Route>>(route)].requests++;
+}
+
+void endRoute(uint32_t cycles) {
+  routes[static_cast<std::underlying_type_t<Route>>(currentRoute)].time.add(cyclesToMicroseconds(cycles));
+  currentRoute = Route::NumberOfRoutes;
+}
+
+void countRouteFailure() {
+  if (currentRoute != Route::NumberOfRoutes) {
+    routes[static_cast<std::underlying_type_t<Route>>(currentRoute)].failures++;
+  }
+}
+
+void markSample(SampleEvent event) {
+  const auto index = static_cast<std::underlying_type_t<SampleEvent>>(event);
+
+  if (event == SampleEvent::Ready) {
+    sampleReadyTime = micros();
+    sampleEventsSeen.fill(false);
+    sampleEventsSeen[index] = true;
+    return;
+  }
+
+  // Ignore stages before the first sample and repeated stages of the same sample
+  if (sampleEventsSeen[index] or (not sampleEventsSeen[static_cast<std::underlying_type_t<SampleEvent>>(SampleEvent::Ready)])) {
+    return;
+  }
+
+  sampleEventsSeen[index] = true;
+  sampleLatencies[index].add(micros() - sampleReadyTime);
+}
+
+void onScd30Transfer(Scd30::Register reg, bool success) {
+  for (size_t i = 0; i < std::size(scd30Registers); ++i) {
+    if (scd30Registers[i].reg == reg) {
+      scd30Transfers[i].transfers++;
+      if (not success) {
+        scd30Transfers[i].failures++;
+      }
+      return;
+    }
+  }
+}
+
+const Histogram& getTimer(Timer timer) {
+  return timers[static_cast<std::underlying_type_t<Timer>>(timer)];
+}
+
+const RouteStatistics& getRoute(Route route) {
+  return routes[static_cast<std::underlying_type_t<Route>>(route)];
+}
+
+const Histogram& getSampleLatency(SampleEvent event) {
+  return sampleLatencies[static_cast<std::underlying_type_t<SampleEvent>>(event)];
+}
+
+TransferStatistics getScd30Total() {
+  TransferStatistics total{};
+  for (const auto& statistics : scd30Transfers) {
+    total.transfers += statistics.transfers;
+    total.failures += statistics.failures;
+  }
+  return total;
+}
+
+std::size_t renderJson(char* buffer, std::size_t size) {
+  TextWriter writer{buffer, size};
+
+  writer.append("{\"version\":\"%s\",\"uptime\":%lu,\"timers\":{", GIT_DESCRIBE, millis());
+  for (size_t i = 0; i < timers.size(); ++i) {
+    writer.append("%s\"%s\":", i > 0 ? "," : "", timerNames[i]);
+    renderHistogram(writer, timers[i]);
+  }
+
+  writer.append("},\"sampleLatencies\":{");
+  for (size_t i = 1; i < sampleLatencies.size(); ++i) {
+    writer.append("%s\"%s\":", i > 1 ? "," : "", sampleEventNames[i]);
+    renderHistogram(writer, sampleLatencies[i]);
+  }
+
+  writer.append("},\"routes\":{");
+  for (size_t i = 0; i < routes.size(); ++i) {
+    writer.append("%s\"%s\":{\"requests\":%u,\"failures\":%u,\"time\":", i > 0 ? "," : "", routeNames[i], routes[i].requests, routes[i].failures);
+    renderHistogram(writer, routes[i].time);
+    writer.append("}");
+  }
+
+  writer.append("},\"scd30\":{");
+  for (size_t i = 0; i < scd30Transfers.size(); ++i) {
+    writer.append("%s\"%s\":{\"transfers\":%u,\"failures\":%u}", i > 0 ? "," : "", scd30Registers[i].name, scd30Transfers[i].transfers, scd30Transfers[i].failures);
+  }
+  writer.append("}}");
+
+  return writer.overflowed() ? 0 : writer.length();
+}
+
+}
+
+#endif
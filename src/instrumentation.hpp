@@ -0,0 +1,189 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+/**
+ * Timing and failure counters of the hot paths.
+ *
+ * Only available if built with INSTRUMENTATION defined (see env:esp32dev_instrumentation), otherwise all macros
+ * compile to nothing.
+ */
+
+#ifdef INSTRUMENTATION
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <Arduino.h>
+#include <Scd30.h>
+
+namespace instrumentation {
+
+enum class Timer : uint8_t {
+  MainLoop,
+  NetworkLoop,
+  UiLoop,
+  MeasurementsLoop,
+  NumberOfTimers
+};
+
+enum class Route : uint8_t {
+  Root,
+  Config,
+  ApiConfig,
+  Update,
+  HistoryBinary,
+  History,
+  Metrics,
+  Diagnostics,
+  Allocations,
+  Trace,
+  CaptivePortalProbe,
+  NotFound,
+  NumberOfRoutes
+};
+
+/// Stages of a sample from being read out of the sensor to being served
+enum class SampleEvent : uint8_t {
+  Ready,
+  Stored,
+  Displayed,
+  Served,
+  NumberOfSampleEvents
+};
+
+/**
+ * Histogram of durations in µs with logarithmic buckets.
+ *
+ * Bucket 0 counts durations below 2 µs, bucket i durations in [2^i, 2^(i+1)) µs, the last bucket everything above.
+ */
+class Histogram {
+public:
+  static constexpr std::size_t numberOfBuckets = 25u;
+
+  void add(uint32_t duration);
+
+  /**
+   * @brief Estimates a percentile
+   *
+   * @param[in] percentile percentile between 0 and 100
+   * @return upper bound of the bucket containing the percentile in µs
+   */
+  uint32_t getPercentile(uint8_t percentile) const;
+
+  uint32_t getCount() const { return _count; }
+  uint32_t getMinimum() const { return _minimum; }
+  uint32_t getMaximum() const { return _maximum; }
+  uint32_t getMean() const { return _count ? (_sum / _count) : 0; }
+  const std::array<uint32_t, numberOfBuckets>& getBuckets() const { return _buckets; }
+
+private:
+  std::array<uint32_t, numberOfBuckets> _buckets{};
+  uint32_t _count{0};
+  uint32_t _minimum{UINT32_MAX};
+  uint32_t _maximum{0};
+  uint64_t _sum{0};
+};
+
+struct RouteStatistics {
+  uint32_t requests;
+  uint32_t failures;
+  Histogram time;
+};
+
+struct TransferStatistics {
+  uint32_t transfers;
+  uint32_t failures;
+};
+
+inline uint32_t getCycleCount() {
+  return ESP.getCycleCount();
+}
+
+void addTime(Timer timer, uint32_t cycles);
+void beginRoute(Route route);
+void endRoute(uint32_t cycles);
+
+/// Counts a failure of the route currently being handled
+void countRouteFailure();
+
+/**
+ * @brief Marks a stage of the latest sample
+ *
+ * Ready starts a new sample, every later stage is recorded once per sample as latency since Ready.
+ *
+ * @param[in] event stage reached
+ */
+void markSample(SampleEvent event);
+
+/// Transfer callback for Scd30
+void onScd30Transfer(Scd30::Register reg, bool success);
+
+const Histogram& getTimer(Timer timer);
+const RouteStatistics& getRoute(Route route);
+const Histogram& getSampleLatency(SampleEvent event);
+
+/**
+ * @brief Sums up the SCD30 transfer statistics of all registers
+ *
+ * @return total SCD30 transfer statistics
+ */
+TransferStatistics getScd30Total();
+
+constexpr std::size_t numberOfScd30Registers = 11u;
+constexpr std::size_t maxNameLength = 32u;
+constexpr std::size_t maxNumberLength = 10u;
+constexpr std::size_t maxHistogramJsonLength = 64u + (6u + Histogram::numberOfBuckets) * (maxNumberLength + 1u);
+
+/// Upper bound of the renderJson() output with all counters at their maximum
+constexpr std::size_t maxJsonLength = 128u + sizeof(GIT_DESCRIBE)
+  + (static_cast<std::size_t>(Timer::NumberOfTimers) + static_cast<std::size_t>(SampleEvent::NumberOfSampleEvents))
+    * (maxNameLength + 8u + maxHistogramJsonLength)
+  + static_cast<std::size_t>(Route::NumberOfRoutes) * (maxNameLength + 48u + 2u * maxNumberLength + maxHistogramJsonLength)
+  + numberOfScd30Registers * (maxNameLength + 40u + 2u * maxNumberLength);
+
+/**
+ * @brief Renders all statistics as JSON
+ *
+ * @param[out] buffer buffer to render into, maxJsonLength + 1 characters are always sufficient
+ * @param[in] size size of buffer
+ * @return number of characters written, 0 if buffer is too small
+ */
+std::size_t renderJson(char* buffer, std::size_t size);
+
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Timer timer) : _timer{timer}, _start{getCycleCount()} {};
+  ~ScopedTimer() { addTime(_timer, getCycleCount() - _start); }
+
+private:
+  Timer _timer;
+  uint32_t _start;
+};
+
+class ScopedRoute {
+public:
+  explicit ScopedRoute(Route route) : _start{getCycleCount()} { beginRoute(route); };
+  ~ScopedRoute() { endRoute(getCycleCount() - _start); }
+
+private:
+  uint32_t _start;
+};
+
+}
+
+#define INSTRUMENTATION_TIMER(timer) instrumentation::ScopedTimer instrumentationScopedTimer{instrumentation::Timer::timer}
+#define INSTRUMENTATION_ROUTE(route) instrumentation::ScopedRoute instrumentationScopedRoute{instrumentation::Route::route}
+#define INSTRUMENTATION_ROUTE_FAILURE() instrumentation::countRouteFailure()
+#define INSTRUMENTATION_SAMPLE(event) instrumentation::markSample(instrumentation::SampleEvent::event)
+
+#else
+
+#define INSTRUMENTATION_TIMER(timer)
+#define INSTRUMENTATION_ROUTE(route)
+#define INSTRUMENTATION_ROUTE_FAILURE()
+#define INSTRUMENTATION_SAMPLE(event)
+
+#endif
+
+#endif
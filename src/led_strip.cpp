@@ -0,0 +1,90 @@
+#include <Arduino.h>
+
+#include <algorithm>
+
+#include "led_strip.hpp"
+
+bool LedStrip::setup(std::size_t numberOfLeds) {
+  _numberOfLeds = std::min(numberOfLeds, maxNumberOfLeds);
+
+  spi_bus_config_t busConfig{};
+  busConfig.mosi_io_num = _dataPin;
+  busConfig.miso_io_num = -1;
+  busConfig.sclk_io_num = _clockPin;
+  busConfig.quadwp_io_num = -1;
+  busConfig.quadhd_io_num = -1;
+  busConfig.max_transfer_sz = bufferSize;
+
+  if (spi_bus_initialize(_host, &busConfig, _dmaChannel) != ESP_OK) {
+    Serial.printf("SPI bus initialization for LED strip failed.\r\n");
+    return false;
+  }
+
+  spi_device_interface_config_t deviceConfig{};
+  deviceConfig.mode = 0;
+  deviceConfig.clock_speed_hz = 1000000;
+  deviceConfig.spics_io_num = -1;
+  deviceConfig.queue_size = 1;
+
+  if (spi_bus_add_device(_host, &deviceConfig, &_device) != ESP_OK) {
+    Serial.printf("Adding LED strip to SPI bus failed.\r\n");
+    return false;
+  }
+
+  _initialized = true;
+  _dirty = true;
+  return true;
+}
+
+void LedStrip::setColor(const Color& color, uint8_t brightness) {
+  brightness = std::min<uint8_t>(brightness, 31u);
+  if ((color.red == _color.red) and (color.green == _color.green) and (color.blue == _color.blue) and (brightness == _brightness)) {
+    return;
+  }
+
+  _color = color;
+  _brightness = brightness;
+  _dirty = true;
+}
+
+void LedStrip::loop() {
+  if (not _initialized) {
+    return;
+  }
+
+  if (_busy) {
+    spi_transaction_t* transaction;
+    if (spi_device_get_trans_result(_device, &transaction, 0) != ESP_OK) {
+      return;
+    }
+    _busy = false;
+  }
+
+  if (not _dirty) {
+    return;
+  }
+
+  // The buffer belongs to the DMA until the transfer finished, so it is only filled now
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < 4u; ++i) {
+    _buffer[length++] = 0x00u;
+  }
+  for (std::size_t led = 0; led < _numberOfLeds; ++led) {
+    _buffer[length++] = 0xE0u | _brightness;
+    _buffer[length++] = _color.blue;
+    _buffer[length++] = _color.green;
+    _buffer[length++] = _color.red;
+  }
+  for (std::size_t i = 0; i < 4u; ++i) {
+    _buffer[length++] = 0xFFu;
+  }
+
+  _transaction = spi_transaction_t{};
+  _transaction.length = length * 8u;
+  _transaction.tx_buffer = _buffer.data();
+
+  if (spi_device_queue_trans(_device, &_transaction, 0) == ESP_OK) {
+    _busy = true;
+    _dirty = false;
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef LED_STRIP_HPP
+#define LED_STRIP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <driver/spi_master.h>
+
+/**
+ * Clocked RGB LED strip (APA102/SK9822) driven by a SPI peripheral with DMA.
+ *
+ * Updates are queued and transferred in the background, loop() only collects finished transfers and starts the next
+ * one. Nothing ever waits for the strip.
+ */
+class LedStrip {
+public:
+  static constexpr std::size_t maxNumberOfLeds = 16u;
+
+  struct Color {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+  };
+
+  LedStrip(spi_host_device_t host, int dmaChannel, uint8_t dataPin, uint8_t clockPin) :
+    _host{host}, _dmaChannel{dmaChannel}, _dataPin{dataPin}, _clockPin{clockPin} {};
+
+  /**
+   * @brief Initializes the SPI peripheral
+   *
+   * @param[in] numberOfLeds number of LEDs, at most maxNumberOfLeds
+   * @retval true initialization successful
+   * @retval false initialization failed
+   */
+  bool setup(std::size_t numberOfLeds);
+
+  /**
+   * @brief Sets all LEDs to a color, transferred with the next loop()
+   *
+   * @param[in] color color
+   * @param[in] brightness global brightness between 0 and 31
+   */
+  void setColor(const Color& color, uint8_t brightness);
+
+  void loop();
+
+private:
+  // Start frame, one frame per LED and end frame with at least numberOfLeds/2 clock edges
+  static constexpr std::size_t bufferSize = 4u + 4u * maxNumberOfLeds + 4u;
+
+  spi_host_device_t _host;
+  int _dmaChannel;
+  uint8_t _dataPin;
+  uint8_t _clockPin;
+
+  spi_device_handle_t _device{};
+  spi_transaction_t _transaction{};
+  WORD_ALIGNED_ATTR std::array<uint8_t, bufferSize> _buffer{};
+  std::size_t _numberOfLeds{0};
+
+  Color _color{};
+  uint8_t _brightness{0};
+  bool _initialized{false};
+  bool _busy{false};
+  bool _dirty{false};
+};
+
+#endif
@@ -11,6 +11,11 @@
 #include "ui.hpp"
 #include "config.hpp"
 #include "network.hpp"
+#include "ota.hpp"
+#include "power.hpp"
+#include "alerts.hpp"
+#include "instrumentation.hpp"
+#include "allocation_tracker.hpp"
 
 static void restart();
 
@@ -18,23 +23,32 @@ Config config{};
 
 Ui ui{config, restart};
 
-Measurements measurements{[](const std::string& text) {
+Measurements measurements{config, [](const std::string& text) {
   ui.showError(text);
   Serial.printf("Error: %s", text.c_str());
 }};
 
 Network network{config, restart};
 
+Ota ota{};
+
+Power power{config};
+
+Alerts alerts{config};
+
 void setup() {
   // Setup serial connection
   Serial.begin(115200);
 
+  // Rolls back a pending firmware that failed to start before
+  ota.setup();
+
   // Initialize File System
   if (not SPIFFS.begin(true)) {
     Serial.printf("File system init failed.");
     restart();
   }
-  Serial.printf("File system: %u/%u bytes used.\r\n", SPIFFS.usedBytes(), SPIFFS.totalBytes());
+  Serial.printf("File system: %u/%u bytes used.\r\n", static_cast<unsigned>(SPIFFS.usedBytes()), static_cast<unsigned>(SPIFFS.totalBytes()));
 
   config.setup();
 
@@ -45,14 +59,31 @@ void setup() {
   digitalWrite(pins::ledDisable, LOW);
 
   ui.setup(&measurements, &network);
-  network.setup(&measurements);
+  network.setup(&measurements, &power, &ota);
   measurements.setup();
+  alerts.setup(&measurements);
+  power.setup(&measurements, &ui, &network);
+
+#ifdef ALLOCATION_TRACKING
+  allocationTracker::markSteadyState();
+#endif
 }
 
 void loop() {
+  INSTRUMENTATION_TIMER(MainLoop);
+
   network.loop();
   ui.loop();
   measurements.loop();
+  alerts.loop();
+  power.loop();
+
+  // A new firmware has to get its web server reachable, otherwise the previous one is restored
+  ota.loop(network.isWebServerReachable());
+
+#ifdef ALLOCATION_TRACKING
+  allocationTracker::loop();
+#endif
 }
 
 static void restart() {
@@ -2,92 +2,362 @@
 
 #include "measurements.hpp"
 #include "pins.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
 #include <type_traits>
 
+namespace {
+
+/// Transfers are repeated this often before they count as failed
+constexpr uint8_t maxTransferAttempts = 3;
+constexpr unsigned long transferRetryDelay = 10; // ms
+
+/// Repeats a transfer until it succeeds, waiting twice as long before each repetition
+template <typename Function>
+bool retry(Function&& function) {
+  for (uint8_t attempt = 0; attempt < maxTransferAttempts; ++attempt) {
+    if (attempt > 0) {
+      delay(transferRetryDelay << (attempt - 1));
+    }
+    if (function()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
 void Measurements::setup() {
-  // Initialize I2C
-  Wire.begin(pins::Sda, pins::Scl);
+  // Initialize I2C and find sensors
+  _i2cBus.setup();
+  const I2cBus::Lock lock{_i2cBus};
+
+  _scd30.setTransferCallback([this](Scd30::Register reg, bool success) {
+    _i2cBus.countTransfer(I2cBus::Device::Scd30, success);
+#ifdef INSTRUMENTATION
+    instrumentation::onScd30Transfer(reg, success);
+#endif
+  });
 
   setupScd30();
   setupBmp280();
+  if (not _bmp280Available) {
+    _errorCallback("Pressure sensor not detected. Please check wiring.");
+  }
+
+  _filter.setup(_config);
+  _pressureCompensation.setup(_config);
+  _statistics.setup(_config);
+  _trace.setup(_config);
+  _nextSequence = _historyStore.setup();
 }
 
 void Measurements::loop() {
-  bool dataReady;
-  if (_scd30.getDataReady(dataReady) and dataReady) {
-    _dataLast.shiftMeasurements();
-    Measurement& measurement = _dataLast.getMeasurement(0);
+  INSTRUMENTATION_TIMER(MeasurementsLoop);
+
+  // Recorded measurements replace the sensors until the trace is exhausted
+  if (_trace.isReplaying()) {
+    replayMeasurement();
+    _lastMeasurementMillis = millis();
+    return;
+  }
+
+  const I2cBus::Lock lock{_i2cBus};
+
+  if (_scd30Available) {
+    bool dataReady = false;
+    if (not retry([&]() { return _scd30.getDataReady(dataReady); })) {
+      countError(Error::Scd30DataReady);
+      handleScd30Failure();
+    } else if (dataReady) {
+      INSTRUMENTATION_SAMPLE(Ready);
+
+      // Measurement is completed before it is stored, so the history never contains a half written sample
+      Measurement measurement{};
+      measurement.time = time(nullptr);
+      readScd30(measurement);
+      readBmp280(measurement);
 
+      Serial.printf(" SCD30:      CO2: %5.0f ppm    Temperature: %5.1f °C   Humidity: %5.1f %%\r\n",
+        measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)],
+        measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)],
+        measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)]);
+      Serial.printf("BMP280: Pressure: %5.0f mbar   Temperature: %5.1f °C\r\n",
+        measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)],
+        measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Temperature)]);
+
+      storeMeasurement(measurement);
+
+      if (_scd30Available) {
+        _pressureCompensation.addMeasurement(millis(), _measurementInterval);
+        updatePressure(measurement);
+      }
+
+      if (_adaptiveIntervalEnabled and measurement.isValid(Quantity::Scd30Co2)) {
+        updateMeasurementInterval(measurement);
+      }
+      return;
+    }
+  } else if ((millis() - _lastRecoveryMillis) >= _recoveryDelay) {
+    recoverScd30();
+  }
+
+  // Record a gap when the SCD30 is silent for too long, so consumers see missing data instead of stale data
+  const unsigned long timeout = _measurementInterval * 2000ul + minRecoveryDelay;
+  if ((millis() - _lastMeasurementMillis) >= timeout) {
+    if (_scd30Available) {
+      Serial.printf("SCD30 measurement overdue.\r\n");
+      countError(Error::Scd30Timeout);
+      handleScd30Failure();
+    }
+
+    Measurement measurement{};
     measurement.time = time(nullptr);
-    if (not _scd30.getMeasurement(measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)], measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)], measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)])) {
-      Serial.printf("getMeasurement failed\r\n");
+    measurement.clear();
+    readBmp280(measurement);
+    storeMeasurement(measurement);
+  }
+}
+
+void Measurements::readScd30(Measurement& measurement) {
+  float co2, temperature, humidity;
+  if (retry([&]() { return _scd30.getMeasurement(co2, temperature, humidity); })) {
+    measurement.set(Quantity::Scd30Co2, co2);
+    measurement.set(Quantity::Scd30Temperature, temperature);
+    measurement.set(Quantity::Scd30Humidity, humidity);
+    _consecutiveFailures = 0;
+  } else {
+    Serial.printf("getMeasurement failed\r\n");
+    countError(Error::Scd30Measurement);
+    measurement.set(Quantity::Scd30Co2, NAN);
+    measurement.set(Quantity::Scd30Temperature, NAN);
+    measurement.set(Quantity::Scd30Humidity, NAN);
+    handleScd30Failure();
+  }
+}
+
+void Measurements::readBmp280(Measurement& measurement) {
+  if (not _bmp280Available) {
+    setupBmp280();
+  }
+
+  // An absent or hanging BMP280 reads as all ones, which ends up far outside of the specified range
+  const float pressure = _bmp280Available ? (_bmp280.readPressure() / 100.0f) : NAN;
+  const bool success = (pressure >= 300.0f) and (pressure <= 1100.0f);
+  if (_bmp280Available) {
+    _i2cBus.countTransfer(I2cBus::Device::Bmp280, success);
+  }
+
+  if (_bmp280Available and success) {
+    measurement.set(Quantity::Bmp280Pressure, pressure);
+    measurement.set(Quantity::Bmp280Temperature, _bmp280.readTemperature());
+  } else {
+    if (_bmp280Available) {
+      countError(Error::Bmp280Measurement);
+      _bmp280Available = false;
     }
+    measurement.set(Quantity::Bmp280Pressure, NAN);
+    measurement.set(Quantity::Bmp280Temperature, NAN);
+  }
+}
 
-    measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)] = _bmp280.readPressure() / 100.0;
-    measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Temperature)] = _bmp280.readTemperature();
-
-    Serial.printf(" SCD30:      CO2: %5.0f ppm    Temperature: %5.1f °C   Humidity: %5.1f %%\r\n",
-      measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)],
-      measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)],
-      measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)]);
-    Serial.printf("BMP280: Pressure: %5.0f mbar   Temperature: %5.1f °C\r\n",
-      measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)],
-      measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Temperature)]);
-
-    // Check if pressure changed and update SCD30 if required
-    if (fabs(_pressureScd30 - measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)]) >= 1.0) {
-      Serial.printf("Updating ambient pressure from %5.0f mbar to %5.0f mbar.\r\n", _pressureScd30, measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)]);
-      if (_scd30.startContinousMeasurement(measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)])) { // mbar
-        _pressureScd30 = measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)];
-      } else {
-        Serial.printf("Update failed.\n");
-      }
+void Measurements::processMeasurement(const Measurement& raw, Measurement& measurement) {
+  measurement = raw;
+  const auto rejected = _filter.filter(measurement);
+  for (std::size_t i = 0; i < raw.data.size(); ++i) {
+    if (rejected & (1u << i)) {
+      const auto quantity = static_cast<Quantity>(i);
+      Serial.printf("Rejected %s %.2f, outside of %.0f..%.0f.\r\n", quantityNames[i], raw.data[i],
+        MeasurementFilter::getMinimum(quantity), MeasurementFilter::getMaximum(quantity));
     }
   }
+  _temperatureFusion.update(measurement);
+  _trace.add(raw, measurement);
 }
 
-void Measurements::setupBmp280() {
-  if (_bmp280.begin(0x76) == false) {
-    _errorCallback("Pressure sensor not detected. Please check wiring.");
+void Measurements::replayMeasurement() {
+  // Replayed measurements only go through the processing into the replay output. They have old time stamps and
+  // would confuse the history, statistics and everything that publishes new measurements.
+  Measurement raw{};
+  if (_trace.replay(raw)) {
+    Measurement measurement{};
+    processMeasurement(raw, measurement);
+  }
+
+  // The sensors continue with fresh processing state
+  if (not _trace.isReplaying()) {
+    _filter = MeasurementFilter{};
+    _filter.setup(_config);
+    _temperatureFusion = TemperatureFusion{};
   }
 }
 
+void Measurements::storeMeasurement(Measurement& measurement) {
+  _rawLast = measurement;
+  processMeasurement(_rawLast, measurement);
+
+  measurement.sequence = _nextSequence++;
+  _dataLast.shiftMeasurements();
+  _dataLast.getMeasurement(0) = measurement;
+  _historyStore.add(measurement);
+  _statistics.add(measurement, _measurementInterval);
+
+  _measurementCounter++;
+  _lastMeasurementMillis = millis();
+  INSTRUMENTATION_SAMPLE(Stored);
+}
+
+void Measurements::updatePressure(const Measurement& measurement) {
+  if (not measurement.isValid(Quantity::Bmp280Pressure)) {
+    return;
+  }
+
+  if (not _pressureCompensation.update(millis(), measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)])) {
+    return;
+  }
+
+  const auto pressure = _pressureCompensation.getTarget();
+  Serial.printf("Updating ambient pressure from %u mbar to %u mbar.\r\n", _pressureCompensation.getApplied(), pressure);
+  if (_scd30.startContinousMeasurement(pressure)) { // mbar
+    _pressureCompensation.applied(millis(), pressure);
+  } else {
+    Serial.printf("Update failed.\n");
+    countError(Error::Scd30PressureUpdate);
+  }
+}
+
+void Measurements::handleScd30Failure() {
+  if (++_consecutiveFailures < maxConsecutiveFailures) {
+    return;
+  }
+
+  Serial.printf("SCD30 failed %u times in a row, starting recovery.\r\n", _consecutiveFailures);
+  _scd30Available = false;
+  _consecutiveFailures = 0;
+  _recoveryAttempts = 0;
+  _recoveryDelay = 0;
+  _lastRecoveryMillis = millis();
+}
+
+void Measurements::recoverScd30() {
+  _recoveryAttempts++;
+  countError(Error::Scd30Recovery);
+  Serial.printf("SCD30 recovery attempt %u.\r\n", _recoveryAttempts);
+
+  if (not _i2cBus.recover()) {
+    Serial.printf("I2C bus still blocked.\r\n");
+  }
+
+  const char* error = nullptr;
+  if (configureScd30(error)) {
+    Serial.printf("SCD30 recovered.\r\n");
+    _scd30Available = true;
+    _recoveryDelay = minRecoveryDelay;
+    return;
+  }
+
+  Serial.printf("%s\r\n", error);
+
+  // The sensor might be stuck in a bad state, the reset is completed when the next attempt starts
+  _scd30.reset();
+
+  _lastRecoveryMillis = millis();
+  _recoveryDelay = std::min(std::max(_recoveryDelay * 2, minRecoveryDelay), maxRecoveryDelay);
+
+  if (_recoveryAttempts == recoveryAttemptsUntilError) {
+    _errorCallback("SCD30 does not respond. Retrying in background.");
+  }
+}
+
+void Measurements::updateMeasurementInterval(const Measurement& measurement) {
+  const auto measurementInterval = _adaptiveInterval.update(measurement.time, measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)]);
+  if (measurementInterval == _measurementInterval) {
+    return;
+  }
+
+  Serial.printf("Changing measurement interval from %u s to %u s (%.1f ppm/min).\r\n", _measurementInterval, measurementInterval, _adaptiveInterval.getRateOfChange());
+  if (_scd30.setMeasurementInterval(measurementInterval)) {
+    _measurementInterval = measurementInterval;
+  } else {
+    Serial.printf("Update failed.\n");
+    _adaptiveInterval.reset(_measurementInterval);
+  }
+}
+
+uint32_t Measurements::getMillisUntilNextMeasurement() const {
+  if (_trace.isReplaying()) {
+    return 0;
+  }
+
+  const unsigned long elapsed = millis() - _lastMeasurementMillis;
+  const unsigned long interval = _measurementInterval * 1000ul;
+
+  return (elapsed < interval) ? (interval - elapsed) : 0;
+}
+
+void Measurements::setupBmp280() {
+  // Fall back to the address of the original board if the BMP280 was not found during the scan
+  const auto address = _i2cBus.isPresent(I2cBus::Device::Bmp280) ? _i2cBus.getAddress(I2cBus::Device::Bmp280) : 0x76u;
+  _bmp280Available = _bmp280.begin(address);
+  _i2cBus.countTransfer(I2cBus::Device::Bmp280, _bmp280Available);
+}
+
 void Measurements::setupScd30() {
-   uint8_t major, minor;
+  // Configure measurement interval, adaptive interval starts from there
+  _adaptiveIntervalEnabled = _config.getValueAsBool("adaptiveInterval").value_or(false);
 
-  if (_scd30.getFirmwareVersion(major, minor)) {
-    printf("SCD30 Firmware: %u.%u\n", major, minor);
+  const char* error = nullptr;
+  _scd30Available = configureScd30(error);
+  if (not _scd30Available) {
+    // Keep running without SCD30 and retry in background
+    _lastRecoveryMillis = millis();
+    _errorCallback(error);
+  }
+  _lastMeasurementMillis = millis();
+}
+
+bool Measurements::configureScd30(const char*& error) {
+  uint8_t major, minor;
+
+  if (retry([&]() { return _scd30.getFirmwareVersion(major, minor); })) {
+    Serial.printf("SCD30 Firmware: %u.%u\r\n", major, minor);
   } else {
-    _errorCallback("Read out of SCD30 firmware version failed. Please check wiring.");
+    error = "Read out of SCD30 firmware version failed. Please check wiring.";
+    return false;
   }
 
-  // Configure measurement interval
-  static constexpr uint16_t desiredMeasurementInterval = 15u;
+  _adaptiveInterval.reset(nominalMeasurementInterval);
 
   uint16_t measurementInterval = 0;
-  if (not _scd30.getMeasurementInterval(measurementInterval)) {
-    _errorCallback("Read out of SCD30 measurement interval failed.");
+  if (not retry([&]() { return _scd30.getMeasurementInterval(measurementInterval); })) {
+    error = "Read out of SCD30 measurement interval failed.";
+    return false;
   }
 
-  if (measurementInterval != desiredMeasurementInterval) {
-    if (not _scd30.setMeasurementInterval(desiredMeasurementInterval)) {
-      _errorCallback("Setting of SCD30 measurement interval failed.");
+  if (measurementInterval != nominalMeasurementInterval) {
+    if (not retry([&]() { return _scd30.setMeasurementInterval(nominalMeasurementInterval); })) {
+      error = "Setting of SCD30 measurement interval failed.";
+      return false;
     }
 
     delay(200);
   }
+  _measurementInterval = nominalMeasurementInterval;
 
   // Configure temperature offset
-  static constexpr uint16_t desiredTemperatureOffset = 100u;
+  const uint16_t desiredTemperatureOffset = std::clamp(_config.getValueAsInt("scd30TemperatureOffset").value_or(100), 0, UINT16_MAX);
 
   uint16_t temperatureOffset = 0;
-  if (not _scd30.getTemperatureOffset(temperatureOffset)) {
-    _errorCallback("Read out of SCD30 temperature offset failed.");
+  if (not retry([&]() { return _scd30.getTemperatureOffset(temperatureOffset); })) {
+    error = "Read out of SCD30 temperature offset failed.";
+    return false;
   }
 
   if (temperatureOffset != desiredTemperatureOffset) {
-    if (not _scd30.setTemperatureOffset(desiredTemperatureOffset)) {
-      _errorCallback("Setting of SCD30 temperature offset failed.");
+    if (not retry([&]() { return _scd30.setTemperatureOffset(desiredTemperatureOffset); })) {
+      error = "Setting of SCD30 temperature offset failed.";
+      return false;
     }
 
     delay(200);
@@ -97,20 +367,27 @@ void Measurements::setupScd30() {
   static constexpr bool desiredAutomaticSelfCalibration = true;
 
   bool automaticSelfCalibration = 0;
-  if (not _scd30.getAutomaticSelfCalibration(automaticSelfCalibration)) {
-    _errorCallback("Read out of SCD30 automatic self calibration failed.");
+  if (not retry([&]() { return _scd30.getAutomaticSelfCalibration(automaticSelfCalibration); })) {
+    error = "Read out of SCD30 automatic self calibration failed.";
+    return false;
   }
 
   if (automaticSelfCalibration != desiredAutomaticSelfCalibration) {
-    if (not _scd30.setAutomaticSelfCalibration(desiredAutomaticSelfCalibration)) {
-    _errorCallback("Setting of SCD30 automatic self calibration failed.");
+    if (not retry([&]() { return _scd30.setAutomaticSelfCalibration(desiredAutomaticSelfCalibration); })) {
+      error = "Setting of SCD30 automatic self calibration failed.";
+      return false;
     }
 
     delay(200);
   }
 
-  // Start measurementsArray
-  if (not _scd30.startContinousMeasurement(0)) {
-    _errorCallback("Starting of SCD30 continous measurement of failed.");
+  // Start measurementsArray, ambient pressure is sent again with the next measurement
+  _pressureCompensation.reset();
+  if (not retry([&]() { return _scd30.startContinousMeasurement(0); })) {
+    error = "Starting of SCD30 continous measurement of failed.";
+    return false;
   }
+
+  _consecutiveFailures = 0;
+  return true;
 }
@@ -6,28 +6,28 @@
 #include <ctime>
 #include <utility>
 #include <array>
+#include <type_traits>
 
 #include <Scd30.h>
 #include <Adafruit_Sensor.h>
 #include <Adafruit_BMP280.h>
 
-enum class Quantity {
-  Scd30Co2,
-  Scd30Temperature,
-  Scd30Humidity,
-  Bmp280Pressure,
-  Bmp280Temperature,
-  NumberOfQuantities
-};
-
-struct Measurement {
-  time_t time;
-  std::array<float, static_cast<size_t>(Quantity::NumberOfQuantities)> data;
-};
+#include "adaptive_interval.hpp"
+#include "config.hpp"
+#include "filter.hpp"
+#include "history_store.hpp"
+#include "i2c_bus.hpp"
+#include "pins.hpp"
+#include "pressure_compensation.hpp"
+#include "quantity.hpp"
+#include "statistics.hpp"
+#include "temperature_fusion.hpp"
+#include "trace.hpp"
 
 class TimeDataInterface {
 public:
   virtual std::size_t getNumberOfMeasurements() const = 0;
+  virtual std::size_t getNumberOfStoredMeasurements() const = 0;
 
   virtual const Measurement& getMeasurement(std::size_t i) const = 0;
   virtual Measurement& getMeasurement(std::size_t i) = 0;
@@ -42,6 +42,10 @@ public:
     return _numberOfMeasurements;
   }
 
+  std::size_t getNumberOfStoredMeasurements() const override {
+    return _numberOfStoredMeasurements;
+  }
+
   const Measurement& getMeasurement(std::size_t i) const override {
     return _data[getIndex(i)];
   }
@@ -55,6 +59,9 @@ public:
     if (_currentMeasurement == _numberOfMeasurements) {
       _currentMeasurement = 0;
     }
+    if (_numberOfStoredMeasurements < _numberOfMeasurements) {
+      _numberOfStoredMeasurements++;
+    }
   }
 
 private:
@@ -69,6 +76,7 @@ private:
   const std::size_t _numberOfMeasurements = N;
   std::array<Measurement, N> _data;
   std::size_t _currentMeasurement{N-1};
+  std::size_t _numberOfStoredMeasurements{0};
 };
 
 class Measurements {
@@ -76,25 +84,135 @@ public:
   using ErrorCallback = std::function<void(std::string)>;
   using TimeDataLast = TimeData<100>;
 
-  Measurements(const ErrorCallback& errorCallback) : _errorCallback(std::move(errorCallback)) {};
+  enum class Error {
+    Scd30DataReady,
+    Scd30Measurement,
+    Scd30PressureUpdate,
+    Scd30Timeout,
+    Scd30Recovery,
+    Bmp280Measurement,
+    NumberOfErrors
+  };
+
+  using ErrorCounters = std::array<uint32_t, static_cast<size_t>(Error::NumberOfErrors)>;
+
+  Measurements(const Config& config, const ErrorCallback& errorCallback) : _config{config}, _errorCallback(std::move(errorCallback)) {};
 
   void setup();
   void loop();
 
   const TimeDataInterface& dataLast() const { return _dataLast; };
 
+  /// Last measurement as read from the sensors, before filtering
+  const Measurement& rawLast() const { return _rawLast; }
+
+  const MeasurementFilter& filter() const { return _filter; }
+
+  const Trace& trace() const { return _trace; }
+
+  const HistoryStore& historyStore() const { return _historyStore; }
+
+  const PressureCompensation& pressureCompensation() const { return _pressureCompensation; }
+
+  const TemperatureFusion& temperatureFusion() const { return _temperatureFusion; }
+
+  const I2cBus& i2cBus() const { return _i2cBus; }
+
+  /// Number of measurements taken since boot, changes whenever a new measurement was stored
+  uint32_t getMeasurementCounter() const { return _measurementCounter; }
+
+  const ErrorCounters& getErrorCounters() const { return _errorCounters; }
+
+  const Statistics& statistics() const { return _statistics; }
+
+  /// Time until the SCD30 is expected to have the next measurement ready, 0 if overdue
+  uint32_t getMillisUntilNextMeasurement() const;
+
+  /// Current measurement interval of SCD30 in s
+  uint16_t getMeasurementInterval() const { return _measurementInterval; }
+
+  /// False while the SCD30 does not respond and is being recovered
+  bool isScd30Available() const { return _scd30Available; }
+
+  bool isBmp280Available() const { return _bmp280Available; }
+
 private:
+  /// Recovery starts after this number of consecutive failures
+  static constexpr uint8_t maxConsecutiveFailures{3};
+
+  /// Recovery attempts back off exponentially, the first one waits for the SCD30 to boot after a soft reset
+  static constexpr unsigned long minRecoveryDelay{2000}; // ms
+  static constexpr unsigned long maxRecoveryDelay{300000}; // ms
+
+  /// The error is shown after this number of unsuccessful recovery attempts
+  static constexpr uint8_t recoveryAttemptsUntilError{5};
+
+  /// Measurement interval the SCD30 is configured to, also paces gap records while it was never configured
+  static constexpr uint16_t nominalMeasurementInterval{15}; // s
+
+  void countError(Error error) { _errorCounters[static_cast<std::underlying_type_t<Error>>(error)]++; }
+
   void setupScd30();
   void setupBmp280();
 
+  /**
+   * @brief Configures the SCD30 and starts the continuous measurement
+   *
+   * @param[out] error description of the failed step
+   * @retval true configuration successful
+   * @retval false configuration failed
+   */
+  bool configureScd30(const char*& error);
+
+  void recoverScd30();
+  void handleScd30Failure();
+  void readScd30(Measurement& measurement);
+  void readBmp280(Measurement& measurement);
+  /**
+   * @brief Filters, fuses and traces a measurement
+   *
+   * @param[in] raw measurement as read from the sensors or the trace
+   * @param[out] measurement processed measurement
+   */
+  void processMeasurement(const Measurement& raw, Measurement& measurement);
+  void replayMeasurement();
+  void storeMeasurement(Measurement& measurement);
+  void updatePressure(const Measurement& measurement);
+  void updateMeasurementInterval(const Measurement& measurement);
+
+  const Config& _config;
   ErrorCallback _errorCallback;
+  I2cBus _i2cBus{Wire, pins::Sda, pins::Scl};
   Scd30 _scd30{};
   Adafruit_BMP280 _bmp280{};
 
-  // Pressure known to SCD30
-  float _pressureScd30 = 0u;
+  PressureCompensation _pressureCompensation{};
+  TemperatureFusion _temperatureFusion{};
 
   TimeDataLast _dataLast{};
+  Measurement _rawLast{};
+  MeasurementFilter _filter{};
+  Trace _trace{};
+  HistoryStore _historyStore{};
+  uint32_t _measurementCounter{0};
+  uint32_t _nextSequence{1};
+
+  // Measurement interval of SCD30 in s
+  uint16_t _measurementInterval{nominalMeasurementInterval};
+  unsigned long _lastMeasurementMillis{0};
+
+  Statistics _statistics{};
+
+  bool _adaptiveIntervalEnabled{false};
+  AdaptiveInterval _adaptiveInterval{};
+  ErrorCounters _errorCounters{};
+
+  bool _scd30Available{false};
+  bool _bmp280Available{false};
+  uint8_t _consecutiveFailures{0};
+  uint8_t _recoveryAttempts{0};
+  unsigned long _recoveryDelay{minRecoveryDelay};
+  unsigned long _lastRecoveryMillis{0};
 };
 
 #endif
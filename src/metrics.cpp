@@ -0,0 +1,369 @@
+#include <Arduino.h>
+
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+#include "allocation_tracker.hpp"
+#include "arena.hpp"
+#include "metrics.hpp"
+#include "network.hpp"
+#include "power.hpp"
+#include "text_writer.hpp"
+
+namespace {
+
+/// Values from this on are written in exponent notation, so no value takes more than maxValueLength characters
+constexpr float maxFixedValue = 1e9f;
+
+void appendValue(TextWriter& writer, float value) {
+  if (std::isnan(value)) {
+    writer.append("NaN\n");
+  } else if (std::fabs(value) < maxFixedValue) {
+    writer.append("%.2f\n", value);
+  } else {
+    writer.append("%.6e\n", value);
+  }
+}
+
+struct QuantityMetric {
+  Quantity quantity;
+  const char* family;
+  const char* unit;
+  const char* help;
+  const char* sensor;
+};
+
+// Samples of one family have to be adjacent
+constexpr QuantityMetric quantityMetrics[] = {
+  {Quantity::Scd30Co2, "co2sensor_co2_ppm", "ppm", "CO2 concentration", "scd30"},
+  {Quantity::Scd30Temperature, "co2sensor_temperature_celsius", "celsius", "Temperature", "scd30"},
+  {Quantity::Bmp280Temperature, "co2sensor_temperature_celsius", "celsius", "Temperature", "bmp280"},
+  {Quantity::FusedTemperature, "co2sensor_temperature_celsius", "celsius", "Temperature", "fused"},
+  {Quantity::Scd30Humidity, "co2sensor_humidity_percent", "percent", "Relative humidity", "scd30"},
+  {Quantity::FusedHumidity, "co2sensor_humidity_percent", "percent", "Relative humidity", "fused"},
+  {Quantity::Bmp280Pressure, "co2sensor_pressure_hectopascals", "hectopascals", "Ambient pressure", "bmp280"},
+};
+
+constexpr const char* windowNames[] = {
+  "5m",
+  "1h",
+  "1d",
+};
+
+constexpr const char* errorNames[] = {
+  "scd30_data_ready",
+  "scd30_measurement",
+  "scd30_pressure_update",
+  "scd30_timeout",
+  "scd30_recovery",
+  "bmp280_measurement",
+};
+
+constexpr const char* i2cDeviceNames[] = {
+  "scd30",
+  "bmp280",
+};
+
+constexpr const char* powerStateNames[] = {
+  "active",
+  "idle",
+  "light_sleep",
+};
+
+constexpr const char* subsystemNames[] = {
+  "cpu",
+  "wifi",
+  "scd30",
+  "display",
+};
+
+static_assert(std::size(windowNames) == static_cast<size_t>(Statistics::Window::NumberOfWindows));
+static_assert(std::size(errorNames) == static_cast<size_t>(Measurements::Error::NumberOfErrors));
+static_assert(std::size(i2cDeviceNames) == static_cast<size_t>(I2cBus::Device::NumberOfDevices));
+static_assert(std::size(powerStateNames) == static_cast<size_t>(Power::State::NumberOfStates));
+static_assert(std::size(subsystemNames) == static_cast<size_t>(Power::Subsystem::NumberOfSubsystems));
+
+}
+
+void Metrics::setup(const Measurements* measurements, const Network* network, const Power* power) {
+  _measurements = measurements;
+  _network = network;
+  _power = power;
+}
+
+void Metrics::update() {
+  if ((_measurementMetricsLength > 0) and (_measurements->getMeasurementCounter() == _measurementCounter)) {
+    return;
+  }
+
+  render();
+}
+
+void Metrics::render() {
+  const auto& measurements = *_measurements;
+  TextWriter writer{_measurementMetrics.data(), _measurementMetrics.size()};
+
+  _measurementCounter = measurements.getMeasurementCounter();
+
+  if (_measurementCounter > 0) {
+    const auto& measurement = measurements.dataLast().getMeasurement(0);
+
+    const char* family = nullptr;
+    for (const auto& metric : quantityMetrics) {
+      if ((family == nullptr) or (strcmp(family, metric.family) != 0)) {
+        family = metric.family;
+        writer.append("# TYPE %s gauge\n# UNIT %s %s\n# HELP %s %s.\n", family, family, metric.unit, family, metric.help);
+      }
+      writer.append("%s{sensor=\"%s\"} ", family, metric.sensor);
+      appendValue(writer, measurement.data[static_cast<std::underlying_type_t<Quantity>>(metric.quantity)]);
+    }
+
+    writer.append("# TYPE co2sensor_measurement_timestamp_seconds gauge\n"
+      "# UNIT co2sensor_measurement_timestamp_seconds seconds\n"
+      "# HELP co2sensor_measurement_timestamp_seconds Time of the last measurement.\n"
+      "co2sensor_measurement_timestamp_seconds %ld\n", static_cast<long>(measurement.time));
+
+    writer.append("# TYPE co2sensor_raw_value gauge\n"
+      "# HELP co2sensor_raw_value Last value as read from the sensor, before filtering.\n");
+    const auto& raw = measurements.rawLast();
+    for (size_t i = 0; i < quantityNames.size(); ++i) {
+      writer.append("co2sensor_raw_value{quantity=\"%s\"} ", quantityNames[i]);
+      appendValue(writer, raw.data[i]);
+    }
+  }
+
+  const auto& filter = measurements.filter();
+  writer.append("# TYPE co2sensor_filter_rejected counter\n"
+    "# HELP co2sensor_filter_rejected Number of values outside of the sensor range.\n");
+  for (size_t i = 0; i < quantityNames.size(); ++i) {
+    writer.append("co2sensor_filter_rejected_total{quantity=\"%s\"} %u\n", quantityNames[i], filter.getNumberOfRejectedValues(static_cast<Quantity>(i)));
+  }
+  writer.append("# TYPE co2sensor_filter_replaced counter\n"
+    "# HELP co2sensor_filter_replaced Number of outliers replaced by the median.\n");
+  for (size_t i = 0; i < quantityNames.size(); ++i) {
+    writer.append("co2sensor_filter_replaced_total{quantity=\"%s\"} %u\n", quantityNames[i], filter.getNumberOfReplacedValues(static_cast<Quantity>(i)));
+  }
+
+  renderStatistics(writer);
+
+  writer.append("# TYPE co2sensor_measurement_interval_seconds gauge\n"
+    "# UNIT co2sensor_measurement_interval_seconds seconds\n"
+    "# HELP co2sensor_measurement_interval_seconds Current SCD30 measurement interval.\n"
+    "co2sensor_measurement_interval_seconds %u\n", measurements.getMeasurementInterval());
+
+  const auto& temperatureFusion = measurements.temperatureFusion();
+  writer.append("# TYPE co2sensor_temperature_fusion_offset_celsius gauge\n"
+    "# UNIT co2sensor_temperature_fusion_offset_celsius celsius\n"
+    "# HELP co2sensor_temperature_fusion_offset_celsius Learned self-heating of the SCD30 compared to the BMP280.\n"
+    "co2sensor_temperature_fusion_offset_celsius ");
+  appendValue(writer, temperatureFusion.getOffset());
+  writer.append("# TYPE co2sensor_temperature_fusion_offset_uncertainty_celsius gauge\n"
+    "# UNIT co2sensor_temperature_fusion_offset_uncertainty_celsius celsius\n"
+    "# HELP co2sensor_temperature_fusion_offset_uncertainty_celsius Standard deviation of the learned offset.\n"
+    "co2sensor_temperature_fusion_offset_uncertainty_celsius ");
+  appendValue(writer, temperatureFusion.getOffsetUncertainty());
+
+  const auto& pressureCompensation = measurements.pressureCompensation();
+  writer.append("# TYPE co2sensor_pressure_compensation_hectopascals gauge\n"
+    "# UNIT co2sensor_pressure_compensation_hectopascals hectopascals\n"
+    "# HELP co2sensor_pressure_compensation_hectopascals Ambient pressure known to the SCD30, 0 if none.\n"
+    "co2sensor_pressure_compensation_hectopascals %u\n"
+    "# TYPE co2sensor_pressure_compensation_updates counter\n"
+    "# HELP co2sensor_pressure_compensation_updates Number of SCD30 restarts to update the ambient pressure.\n"
+    "co2sensor_pressure_compensation_updates_total %u\n"
+    "# TYPE co2sensor_pressure_compensation_lost_samples counter\n"
+    "# HELP co2sensor_pressure_compensation_lost_samples Number of measurements lost by these restarts.\n"
+    "co2sensor_pressure_compensation_lost_samples_total %u\n",
+    pressureCompensation.getApplied(), pressureCompensation.getNumberOfUpdates(), pressureCompensation.getNumberOfLostSamples());
+
+  writer.append("# TYPE co2sensor_measurements counter\n"
+    "# HELP co2sensor_measurements Number of measurements since boot.\n"
+    "co2sensor_measurements_total %u\n", _measurementCounter);
+
+  writer.append("# TYPE co2sensor_sensor_available gauge\n"
+    "# HELP co2sensor_sensor_available Whether the sensor responds, 0 while it is being recovered.\n"
+    "co2sensor_sensor_available{sensor=\"scd30\"} %u\n"
+    "co2sensor_sensor_available{sensor=\"bmp280\"} %u\n", measurements.isScd30Available(), measurements.isBmp280Available());
+
+  writer.append("# TYPE co2sensor_sensor_errors counter\n"
+    "# HELP co2sensor_sensor_errors Number of sensor errors since boot.\n");
+  const auto& errorCounters = measurements.getErrorCounters();
+  for (size_t i = 0; i < errorCounters.size(); ++i) {
+    writer.append("co2sensor_sensor_errors_total{error=\"%s\"} %u\n", errorNames[i], errorCounters[i]);
+  }
+
+  const auto& i2cBus = measurements.i2cBus();
+  writer.append("# TYPE co2sensor_i2c_clock_hertz gauge\n"
+    "# UNIT co2sensor_i2c_clock_hertz hertz\n"
+    "# HELP co2sensor_i2c_clock_hertz Clock of the I2C bus.\n"
+    "co2sensor_i2c_clock_hertz %u\n", i2cBus.getClock());
+  writer.append("# TYPE co2sensor_i2c_device_address gauge\n"
+    "# HELP co2sensor_i2c_device_address Address a device was found at during the scan, 0 if not found.\n");
+  for (size_t i = 0; i < std::size(i2cDeviceNames); ++i) {
+    writer.append("co2sensor_i2c_device_address{device=\"%s\"} %u\n", i2cDeviceNames[i], i2cBus.getAddress(static_cast<I2cBus::Device>(i)));
+  }
+  writer.append("# TYPE co2sensor_i2c_transfers counter\n"
+    "# HELP co2sensor_i2c_transfers Number of transfers per device.\n");
+  for (size_t i = 0; i < std::size(i2cDeviceNames); ++i) {
+    writer.append("co2sensor_i2c_transfers_total{device=\"%s\"} %u\n", i2cDeviceNames[i], i2cBus.getStatistics(static_cast<I2cBus::Device>(i)).transfers);
+  }
+  writer.append("# TYPE co2sensor_i2c_failures counter\n"
+    "# HELP co2sensor_i2c_failures Number of failed transfers per device.\n");
+  for (size_t i = 0; i < std::size(i2cDeviceNames); ++i) {
+    writer.append("co2sensor_i2c_failures_total{device=\"%s\"} %u\n", i2cDeviceNames[i], i2cBus.getStatistics(static_cast<I2cBus::Device>(i)).failures);
+  }
+  writer.append("# TYPE co2sensor_i2c_error_ratio gauge\n"
+    "# HELP co2sensor_i2c_error_ratio Share of failed transfers over about the last 100 transfers per device.\n");
+  for (size_t i = 0; i < std::size(i2cDeviceNames); ++i) {
+    writer.append("co2sensor_i2c_error_ratio{device=\"%s\"} %.4f\n", i2cDeviceNames[i], i2cBus.getStatistics(static_cast<I2cBus::Device>(i)).errorRate);
+  }
+
+  if (writer.overflowed()) {
+    Serial.printf("Metrics buffer too small.\r\n");
+  }
+
+  _measurementMetricsLength = writer.length();
+}
+
+void Metrics::renderStatistics(TextWriter& writer) const {
+  const auto& statistics = _measurements->statistics();
+
+  writer.append("# TYPE co2sensor_statistics_ewma gauge\n"
+    "# HELP co2sensor_statistics_ewma Exponentially weighted moving average.\n");
+  for (size_t i = 0; i < quantityNames.size(); ++i) {
+    writer.append("co2sensor_statistics_ewma{quantity=\"%s\"} ", quantityNames[i]);
+    appendValue(writer, statistics.get(i).ewma);
+  }
+
+  struct WindowMetric {
+    const char* name;
+    const char* help;
+    float (RollingWindow::*get)() const;
+  };
+  static constexpr WindowMetric windowMetrics[] = {
+    {"mean", "Time weighted mean over the window.", &RollingWindow::getMean},
+    {"min", "Minimum over the window.", &RollingWindow::getMinimum},
+    {"max", "Maximum over the window.", &RollingWindow::getMaximum},
+  };
+
+  for (const auto& metric : windowMetrics) {
+    writer.append("# TYPE co2sensor_statistics_%s gauge\n# HELP co2sensor_statistics_%s %s\n", metric.name, metric.name, metric.help);
+    for (size_t i = 0; i < quantityNames.size(); ++i) {
+      for (size_t window = 0; window < std::size(windowNames); ++window) {
+        writer.append("co2sensor_statistics_%s{quantity=\"%s\",window=\"%s\"} ", metric.name, quantityNames[i], windowNames[window]);
+        appendValue(writer, (statistics.get(i).windows[window].*metric.get)());
+      }
+    }
+  }
+
+  writer.append("# TYPE co2sensor_statistics_quantile gauge\n"
+    "# HELP co2sensor_statistics_quantile Approximate quantile since boot.\n");
+  for (size_t i = 0; i < quantityNames.size(); ++i) {
+    for (const auto* quantile : {&statistics.get(i).median, &statistics.get(i).percentile95}) {
+      writer.append("co2sensor_statistics_quantile{quantity=\"%s\",quantile=\"%.2f\"} ", quantityNames[i], quantile->getQuantile());
+      appendValue(writer, quantile->get());
+    }
+  }
+
+  writer.append("# TYPE co2sensor_co2_above_threshold_seconds counter\n"
+    "# UNIT co2sensor_co2_above_threshold_seconds seconds\n"
+    "# HELP co2sensor_co2_above_threshold_seconds Time CO2 was above threshold since boot.\n");
+  for (size_t i = 0; i < Statistics::numberOfCo2Thresholds; ++i) {
+    writer.append("co2sensor_co2_above_threshold_seconds_total{threshold=\"%i\"} %u\n", statistics.getCo2Threshold(i), statistics.getTimeAboveCo2Threshold(i));
+  }
+}
+
+std::size_t Metrics::renderRuntimeMetrics() {
+  TextWriter writer{_runtimeMetrics.data(), _runtimeMetrics.size()};
+
+  writer.append("# TYPE co2sensor_uptime_seconds gauge\n"
+    "# UNIT co2sensor_uptime_seconds seconds\n"
+    "# HELP co2sensor_uptime_seconds Time since boot.\n"
+    "co2sensor_uptime_seconds %.3f\n", millis() / 1000.0);
+
+  writer.append("# TYPE co2sensor_wifi_connect_seconds gauge\n"
+    "# UNIT co2sensor_wifi_connect_seconds seconds\n"
+    "# HELP co2sensor_wifi_connect_seconds Duration of the last WiFi connect or reconnect.\n"
+    "co2sensor_wifi_connect_seconds %.3f\n"
+    "# TYPE co2sensor_wifi_connects counter\n"
+    "# HELP co2sensor_wifi_connects Number of WiFi connects since boot.\n"
+    "co2sensor_wifi_connects_total %u\n"
+    "# TYPE co2sensor_wifi_fast_connect_failures counter\n"
+    "# HELP co2sensor_wifi_fast_connect_failures Number of connects with cached parameters which fell back to a scan.\n"
+    "co2sensor_wifi_fast_connect_failures_total %u\n",
+    _network->getLastConnectDuration() / 1000.0f, _network->getNumberOfConnects(), _network->getNumberOfFastConnectFailures());
+
+  if (_network->isWifiConnected()) {
+    writer.append("# TYPE co2sensor_wifi_rssi_dbm gauge\n"
+      "# UNIT co2sensor_wifi_rssi_dbm dbm\n"
+      "# HELP co2sensor_wifi_rssi_dbm WiFi signal strength.\n"
+      "co2sensor_wifi_rssi_dbm %ld\n", _network->getWifiRssi());
+  }
+
+  if (_network->telemetry().isEnabled()) {
+    writer.append("# TYPE co2sensor_telemetry_datagrams counter\n"
+      "# HELP co2sensor_telemetry_datagrams Number of telemetry datagrams sent since boot.\n"
+      "co2sensor_telemetry_datagrams_total %u\n", _network->telemetry().getNumberOfDatagrams());
+  }
+
+  writer.append("# TYPE co2sensor_heap_bytes gauge\n"
+    "# UNIT co2sensor_heap_bytes bytes\n"
+    "# HELP co2sensor_heap_bytes Heap statistics.\n"
+    "co2sensor_heap_bytes{type=\"size\"} %u\n"
+    "co2sensor_heap_bytes{type=\"free\"} %u\n"
+    "co2sensor_heap_bytes{type=\"min_free\"} %u\n"
+    "co2sensor_heap_bytes{type=\"max_alloc\"} %u\n",
+    ESP.getHeapSize(), ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+
+  const std::pair<const char*, const Arena*> arenas[] = {{"startup", &arena::startup()}, {"request", &arena::request()}};
+  writer.append("# TYPE co2sensor_arena_bytes gauge\n"
+    "# UNIT co2sensor_arena_bytes bytes\n"
+    "# HELP co2sensor_arena_bytes Static arena statistics.\n");
+  for (const auto& [name, arena] : arenas) {
+    writer.append("co2sensor_arena_bytes{arena=\"%s\",type=\"size\"} %u\n"
+      "co2sensor_arena_bytes{arena=\"%s\",type=\"used\"} %u\n"
+      "co2sensor_arena_bytes{arena=\"%s\",type=\"peak\"} %u\n",
+      name, static_cast<unsigned>(arena->getSize()), name, static_cast<unsigned>(arena->getUsed()),
+      name, static_cast<unsigned>(arena->getPeak()));
+  }
+  writer.append("# TYPE co2sensor_arena_failures counter\n"
+    "# HELP co2sensor_arena_failures Number of allocations not served because the arena was exhausted.\n");
+  for (const auto& [name, arena] : arenas) {
+    writer.append("co2sensor_arena_failures_total{arena=\"%s\"} %u\n", name, arena->getNumberOfFailures());
+  }
+
+#ifdef ALLOCATION_TRACKING
+  writer.append("# TYPE co2sensor_steady_state_allocations counter\n"
+    "# HELP co2sensor_steady_state_allocations Number of allocations of the loop task after setup.\n"
+    "co2sensor_steady_state_allocations_total %u\n", allocationTracker::getSteadyStateAllocations());
+#endif
+
+  const auto stateTimes = _power->getStateTimes();
+  writer.append("# TYPE co2sensor_power_state_seconds counter\n"
+    "# UNIT co2sensor_power_state_seconds seconds\n"
+    "# HELP co2sensor_power_state_seconds Time spent in each power state since boot.\n");
+  for (size_t i = 0; i < stateTimes.size(); ++i) {
+    writer.append("co2sensor_power_state_seconds_total{state=\"%s\"} %.3f\n", powerStateNames[i], stateTimes[i] / 1e6);
+  }
+
+  writer.append("# TYPE co2sensor_power_duty_cycle_ratio gauge\n"
+    "# UNIT co2sensor_power_duty_cycle_ratio ratio\n"
+    "# HELP co2sensor_power_duty_cycle_ratio Fraction of time the CPU was active since boot.\n"
+    "co2sensor_power_duty_cycle_ratio %.4f\n", _power->getDutyCycle());
+
+  writer.append("# TYPE co2sensor_power_estimated_current_amperes gauge\n"
+    "# UNIT co2sensor_power_estimated_current_amperes amperes\n"
+    "# HELP co2sensor_power_estimated_current_amperes Rough estimate of the average current draw per subsystem.\n");
+  for (size_t i = 0; i < std::size(subsystemNames); ++i) {
+    writer.append("co2sensor_power_estimated_current_amperes{subsystem=\"%s\"} %.4f\n", subsystemNames[i], _power->getEstimatedCurrent(static_cast<Power::Subsystem>(i)));
+  }
+
+  writer.append("# EOF\n");
+
+  if (writer.overflowed()) {
+    Serial.printf("Metrics buffer too small.\r\n");
+  }
+
+  return writer.length();
+}
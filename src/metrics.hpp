@@ -0,0 +1,59 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "measurements.hpp"
+
+class Network;
+class Power;
+class TextWriter;
+
+/**
+ * Renders the OpenMetrics text exposition.
+ *
+ * Measurement related metrics only change with a new measurement, so they are rendered once per measurement into a
+ * preallocated buffer and served from there. The few runtime metrics (uptime, heap, RSSI) are rendered per scrape.
+ */
+class Metrics {
+public:
+  static constexpr const char* contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+  static constexpr std::size_t measurementMetricsSize = 16384u;
+  static constexpr std::size_t runtimeMetricsSize = 4096u;
+  /// Longest value, "-999999999.99" or "-3.402823e+38"
+  static constexpr std::size_t maxValueLength = 13u;
+
+  void setup(const Measurements* measurements, const Network* network, const Power* power);
+
+  /// Re-renders the cached measurement metrics if a new measurement is available
+  void update();
+
+  const char* getMeasurementMetrics() const { return _measurementMetrics.data(); }
+  std::size_t getMeasurementMetricsLength() const { return _measurementMetricsLength; }
+
+  /**
+   * @brief Renders the runtime metrics including the terminating EOF marker
+   *
+   * @return number of characters rendered
+   */
+  std::size_t renderRuntimeMetrics();
+
+  const char* getRuntimeMetrics() const { return _runtimeMetrics.data(); }
+
+private:
+  void render();
+  void renderStatistics(TextWriter& writer) const;
+
+  const Measurements* _measurements{};
+  const Network* _network{};
+  const Power* _power{};
+
+  std::array<char, measurementMetricsSize> _measurementMetrics{};
+  std::size_t _measurementMetricsLength{0};
+  std::array<char, runtimeMetricsSize> _runtimeMetrics{};
+  uint32_t _measurementCounter{0};
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "mqtt.hpp"
+#include "arena.hpp"
+#include "text_writer.hpp"
+
+namespace {
+
+/// Length of a published measurement with separator, for the longest time stamp and values
+constexpr std::size_t rowLength(std::size_t valueLength) {
+  std::size_t length = sizeof(",{\"time\":-9223372036854775808}") - 1;
+  for (const auto name : quantityNames) {
+    length += sizeof(",\"\":") - 1 + std::char_traits<char>::length(name) + valueLength;
+  }
+  return length;
+}
+
+/// Values are published with two decimals, larger ones can't come from the sensors and are published as null
+constexpr float maxPublishedValue = 1e6f;
+constexpr std::size_t maxRowLength = rowLength(sizeof("-999999.99") - 1);
+
+const char* copyToStartupArena(const char* string) {
+  const char* copy = arena::startup().copy(string);
+  if (not copy) {
+    Serial.printf("Startup arena exhausted, %s dropped.\r\n", string);
+    return "";
+  }
+  return copy;
+}
+
+}
+
+void Mqtt::setup() {
+  _broker = copyToStartupArena(_config.getValueAsCString("mqttBroker").value_or(""));
+  _topic = copyToStartupArena(_config.getValueAsCString("mqttTopic").value_or(""));
+  _clientId = copyToStartupArena(_config.getValueAsCString("hostname").value_or("Co2-Sensor"));
+  _port = _config.getValueAsInt("mqttPort").value_or(1883);
+  _qos = std::clamp(_config.getValueAsInt("mqttQos").value_or(0), 0, 2);
+
+  if (not isEnabled()) {
+    return;
+  }
+
+  Serial.printf("Publishing to mqtt://%s:%i/%s with QoS %i.\r\n", _broker, _port, _topic, _qos);
+  _client.begin(_broker, _port, _wifiClient);
+  _client.setTimeout(commandTimeout);
+}
+
+void Mqtt::loop(const Measurements& measurements, bool wifiConnected) {
+  if (not isEnabled()) {
+    return;
+  }
+
+  enqueueNewMeasurements(measurements);
+
+  if (not wifiConnected) {
+    return;
+  }
+
+  if (not _client.connected()) {
+    if (_connectAttempted and ((millis() - _lastConnectAttempt) < _reconnectDelay)) {
+      return;
+    }
+    if (not connect()) {
+      return;
+    }
+  }
+
+  _client.loop();
+
+  if ((millis() - _lastFlush) >= flushInterval) {
+    _lastFlush = millis();
+    flush();
+  }
+}
+
+void Mqtt::enqueueNewMeasurements(const Measurements& measurements) {
+  const auto measurementCounter = measurements.getMeasurementCounter();
+  const auto& data = measurements.dataLast();
+  const auto newMeasurements = std::min<std::size_t>(measurementCounter - _measurementCounter, data.getNumberOfStoredMeasurements());
+  _measurementCounter = measurementCounter;
+
+  for (std::size_t i = newMeasurements; i > 0; --i) {
+    if (_backlogCount == _backlog.size()) {
+      _backlogHead = (_backlogHead + 1) % _backlog.size();
+      _backlogCount--;
+      _droppedMeasurements++;
+    }
+
+    _backlog[(_backlogHead + _backlogCount) % _backlog.size()] = data.getMeasurement(i - 1);
+    _backlogCount++;
+  }
+}
+
+bool Mqtt::connect() {
+  _lastConnectAttempt = millis();
+  _connectAttempted = true;
+
+  if (not _client.connect(_clientId)) {
+    _reconnectDelay = std::min(2 * _reconnectDelay, maxReconnectInterval);
+    Serial.printf("MQTT connect to %s failed (%i), retrying in %lu s.\r\n", _broker, _client.lastError(), _reconnectDelay / 1000);
+    return false;
+  }
+
+  _reconnectDelay = reconnectInterval;
+
+  Serial.printf("MQTT connected, %u measurements queued.\r\n", static_cast<unsigned>(_backlogCount));
+  return true;
+}
+
+void Mqtt::flush() {
+  if (_backlogCount == 0) {
+    return;
+  }
+
+  // Publish the oldest measurements as one JSON array, as many as fit into the message buffer
+  static_assert((maxRowLength + 2u) <= maxPayloadLength, "A single measurement has to fit into the payload");
+  char payload[maxPayloadLength];
+  std::size_t length = 0;
+  std::size_t count = 0;
+
+  payload[length++] = '[';
+  for (; (count < batchSize) and (count < _backlogCount); ++count) {
+    const auto& measurement = _backlog[(_backlogHead + count) % _backlog.size()];
+
+    char row[maxRowLength + 1];
+    TextWriter writer{row, sizeof(row)};
+    writer.append("%s{\"time\":%ld", count > 0 ? "," : "", static_cast<long>(measurement.time));
+    for (size_t i = 0; i < measurement.data.size(); ++i) {
+      if (std::isnan(measurement.data[i]) or (std::fabs(measurement.data[i]) >= maxPublishedValue)) {
+        writer.append(",\"%s\":null", quantityNames[i]);
+      } else {
+        writer.append(",\"%s\":%.2f", quantityNames[i], measurement.data[i]);
+      }
+    }
+    writer.append("}");
+
+    // Room for the closing bracket
+    if ((length + writer.length() + 1) > sizeof(payload)) {
+      break;
+    }
+    std::memcpy(payload + length, row, writer.length());
+    length += writer.length();
+  }
+  payload[length++] = ']';
+
+  if (not _client.publish(_topic, payload, length, false, _qos)) {
+    Serial.printf("MQTT publish failed (%i).\r\n", _client.lastError());
+    return;
+  }
+
+  _backlogHead = (_backlogHead + count) % _backlog.size();
+  _backlogCount -= count;
+}
@@ -0,0 +1,80 @@
+#ifndef MQTT_HPP
+#define MQTT_HPP
+
+#include <array>
+
+#include <WiFiClient.h>
+#include <MQTT.h>
+
+#include "config.hpp"
+#include "measurements.hpp"
+
+/**
+ * Publishes measurements to a MQTT broker.
+ *
+ * Every new measurement is queued in a bounded backlog first. While connected the backlog is flushed in batches, at
+ * most one batch per flushInterval, so a long backlog after a reconnect never starves sensing or the UI. If the backlog
+ * is full the oldest measurement is dropped.
+ *
+ * Connecting and publishing with QoS > 0 block the loop until the broker answers or commandTimeout expires. While the
+ * broker stays unreachable the interval between connect attempts doubles up to maxReconnectInterval, so an offline
+ * broker stalls UI and sensing only rarely.
+ */
+class Mqtt {
+public:
+  Mqtt(const Config& config) : _config{config} {};
+
+  void setup();
+
+  /**
+   * @brief Queues new measurements and publishes them if possible
+   *
+   * @param[in] measurements measurements to publish
+   * @param[in] wifiConnected WiFi connection state
+   */
+  void loop(const Measurements& measurements, bool wifiConnected);
+
+  bool isEnabled() const { return _broker[0] != '\0'; }
+  bool isConnected() { return _client.connected(); }
+  std::size_t getBacklogSize() const { return _backlogCount; }
+  uint32_t getDroppedMeasurements() const { return _droppedMeasurements; }
+
+private:
+  static constexpr std::size_t backlogSize = 256u;
+  static constexpr std::size_t batchSize = 10u;
+  static constexpr std::size_t messageBufferSize = 1536u;
+  /// Leaves room for the header and topic in the message buffer
+  static constexpr std::size_t maxPayloadLength = messageBufferSize - 128u;
+  static constexpr unsigned long flushInterval = 200u; // ms
+  static constexpr unsigned long reconnectInterval = 10000u; // ms
+  static constexpr unsigned long maxReconnectInterval = 320000u; // ms
+  static constexpr int commandTimeout = 500; // ms
+
+  void enqueueNewMeasurements(const Measurements& measurements);
+  bool connect();
+  void flush();
+
+  const Config& _config;
+  // Copies in the startup arena, the client keeps pointers to them
+  const char* _broker{""};
+  const char* _topic{""};
+  const char* _clientId{""};
+  int _port{1883};
+  int _qos{0};
+
+  WiFiClient _wifiClient{};
+  MQTTClient _client{messageBufferSize};
+
+  std::array<Measurement, backlogSize> _backlog{};
+  std::size_t _backlogHead{0};
+  std::size_t _backlogCount{0};
+  uint32_t _droppedMeasurements{0};
+  uint32_t _measurementCounter{0};
+
+  unsigned long _lastFlush{0};
+  unsigned long _lastConnectAttempt{0};
+  unsigned long _reconnectDelay{reconnectInterval};
+  bool _connectAttempted{false};
+};
+
+#endif
@@ -1,11 +1,65 @@
 #include <WiFi.h>
+#include <ESPmDNS.h>
+#include <SPIFFS.h>
 
 #include "network.hpp"
+#include "arena.hpp"
 #include "pins.hpp"
 #include "html.hpp"
+#include "history_frame.hpp"
+#include "text_writer.hpp"
+#include "instrumentation.hpp"
+#include "allocation_tracker.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+
+namespace {
+
+/// Access point of the last connect, kept in RTC memory across software resets. The address always comes from DHCP,
+/// a lease reused without asking the server could be handed out to another device in the meantime.
+struct WifiCache {
+  uint32_t magic;
+  uint32_t ssidHash;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t checksum;
+};
+
+constexpr uint32_t wifiCacheMagic = 0x57494632u; // WIF2, without lease
+
+RTC_NOINIT_ATTR WifiCache wifiCache;
+
+/// FNV-1a
+uint32_t hash(const void* data, size_t size) {
+  uint32_t value = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    value = (value ^ static_cast<const uint8_t*>(data)[i]) * 16777619u;
+  }
+  return value;
+}
+
+uint32_t wifiCacheChecksum() {
+  return hash(&wifiCache, offsetof(WifiCache, checksum));
+}
+
+bool isWifiCacheValid(const char* ssid) {
+  // Content is random after power-on
+  return (wifiCache.magic == wifiCacheMagic) and (wifiCache.checksum == wifiCacheChecksum()) and (wifiCache.ssidHash == hash(ssid, strlen(ssid)));
+}
+
+void invalidateWifiCache() {
+  wifiCache.magic = 0;
+}
 
-void Network::setup(const Measurements* measurements) {
+}
+
+void Network::setup(const Measurements* measurements, const Power* power, Ota* ota) {
   _measurements = measurements;
+  _ota = ota;
+  _metrics.setup(measurements, this, power);
 
   WiFi.disconnect();
   WiFi.mode(WIFI_OFF);
@@ -26,18 +80,51 @@ void Network::setup(const Measurements* measurements) {
 }
 
 void Network::setupWebserver() {
-  _webServer.on("/", [this]() { onWebServerRoot(); });
-  _webServer.on("/config", [this]() { onWebServerConfig(); });
-  _webServer.onNotFound([this]() { onWebServerConfig(); });
+  _webSession.setup(_config);
+
+  // Authorization is always collected
+  const char* headerKeys[] = {"Cookie"};
+  _webServer.collectHeaders(headerKeys, std::size(headerKeys));
+
+  _webServer.on("/", [this]() { INSTRUMENTATION_ROUTE(Root); onWebServerRoot(); });
+  _webServer.on("/config", [this]() { INSTRUMENTATION_ROUTE(Config); onWebServerConfig(); });
+  _webServer.on("/api/config", HTTP_GET, [this]() { INSTRUMENTATION_ROUTE(ApiConfig); onWebServerApiConfig(); });
+  _webServer.on("/api/config", HTTP_PATCH, [this]() { INSTRUMENTATION_ROUTE(ApiConfig); onWebServerApiConfig(); });
+  _webServer.on("/api/update", HTTP_POST, [this]() { INSTRUMENTATION_ROUTE(Update); onWebServerUpdate(); }, [this]() { onWebServerUpdateUpload(); });
+  _webServer.on("/api/history.bin", [this]() { INSTRUMENTATION_ROUTE(HistoryBinary); onWebServerHistoryBinary(); });
+  _webServer.on("/api/history", [this]() { INSTRUMENTATION_ROUTE(History); onWebServerHistory(); });
+  _webServer.on("/metrics", [this]() { INSTRUMENTATION_ROUTE(Metrics); onWebServerMetrics(); });
+#ifdef INSTRUMENTATION
+  _webServer.on("/api/diagnostics", [this]() { INSTRUMENTATION_ROUTE(Diagnostics); onWebServerDiagnostics(); });
+#endif
+#ifdef ALLOCATION_TRACKING
+  _webServer.on("/api/allocations", [this]() { INSTRUMENTATION_ROUTE(Allocations); onWebServerAllocations(); });
+#endif
+  _webServer.on("/api/trace.bin", [this]() { INSTRUMENTATION_ROUTE(Trace); onWebServerFile(Trace::traceFileName, contentTypeOctetStream); });
+  _webServer.on("/api/replay.csv", [this]() { INSTRUMENTATION_ROUTE(Trace); onWebServerFile(Trace::replayFileName, contentTypeCsv); });
+  for (const auto path : CaptivePortal::probePaths) {
+    _webServer.on(path, [this]() { INSTRUMENTATION_ROUTE(CaptivePortalProbe); onWebServerCaptivePortalProbe(); });
+  }
+  _webServer.onNotFound([this]() {
+    INSTRUMENTATION_ROUTE(NotFound);
+    // All host names resolve to the portal, so unknown URLs get the cheap redirect instead of the configuration page
+    if (_state == State::CONFIGURATION_MODE) {
+      onWebServerCaptivePortalProbe();
+    } else {
+      onWebServerConfig();
+    }
+  });
 }
 
 void Network::loop() {
+  INSTRUMENTATION_TIMER(NetworkLoop);
+
   switch (_state) {
     case State::INITIAL:
       break;
 
     case State::CONFIGURATION_MODE:
-      _dnsServer.processNextRequest();
+      _captivePortal.loop();
       _webServer.handleClient();
       break;
 
@@ -47,8 +134,21 @@ void Network::loop() {
         onWifiConnect();
       } else if ((_onConnectHandled == true) and (not isWifiConnected())) {
         _onConnectHandled = false;
+        _connectStartMillis = millis();
+      } else if ((_onConnectHandled == false) and _fastConnect and ((millis() - _connectStartMillis) >= fastConnectTimeout)) {
+        Serial.printf("Fast connect failed, scanning.\r\n");
+        _numberOfFastConnectFailures++;
+        invalidateWifiCache();
+        WiFi.disconnect();
+        connectWifi(false);
       }
 
+      // Measurements taken while disconnected are queued and flushed after reconnect
+      _mqtt.loop(*_measurements, _onConnectHandled);
+      _telemetry.loop(*_measurements, _onConnectHandled);
+
+      updateMdns();
+
       _webServer.handleClient();
       break;
 
@@ -99,9 +199,7 @@ void Network::enterConfigurationMode() {
   WiFi.softAPConfig(apIP, apIP, IPAddress(255, 255, 255, 0));
   WiFi.softAP("Co2-Sensor", nullptr, 1, false, 1);//, "", selectChannelForAp());
 
-  _dnsServer.setTTL(0);
-  _dnsServer.setErrorReplyCode(DNSReplyCode::NoError);
-  _dnsServer.start(53, "*", apIP);
+  _captivePortal.start(apIP);
 
   _webServer.begin();
 }
@@ -112,7 +210,7 @@ void Network::exitConfigurationMode() {
   WiFi.softAPdisconnect(true);
   WiFi.mode(WIFI_MODE_NULL);
 
-  _dnsServer.stop();
+  _captivePortal.stop();
   _webServer.stop();
 }
 
@@ -125,19 +223,55 @@ void Network::enterConfiguredMode() {
   }
 
   WiFi.mode(WIFI_STA);
-  WiFi.setHostname(_config.getValueAsString("hostname").value_or("").c_str());
+  // Modem sleep wakes up for every DTIM beacon
+  WiFi.setSleep(_config.getValueAsBool("powerSave").value_or(false));
+  WiFi.setHostname(_config.getValueAsCString("hostname").value_or(""));
 
   _webServer.begin();
+  _mqtt.setup();
+  _telemetry.setup();
 
-  WiFi.begin(
-    _config.getValueAsString("wifiSsid").value_or("").c_str(),
-    _config.getValueAsString("wifiPassword").value_or("").c_str()
-  );
+  connectWifi(true);
+}
+
+void Network::connectWifi(bool fast) {
+  const char* ssid = _config.getValueAsCString("wifiSsid").value_or("");
+  const char* password = _config.getValueAsCString("wifiPassword").value_or("");
+
+  IPAddress localIp, gateway, subnet, dns;
+  const bool staticIp = localIp.fromString(_config.getValueAsCString("staticIp").value_or(""))
+    and gateway.fromString(_config.getValueAsCString("staticGateway").value_or(""))
+    and subnet.fromString(_config.getValueAsCString("staticSubnet").value_or(""));
+
+  _fastConnect = fast and isWifiCacheValid(ssid);
+  _connectStartMillis = millis();
+
+  if (staticIp) {
+    if (not dns.fromString(_config.getValueAsCString("staticDns").value_or(""))) {
+      dns = gateway;
+    }
+    WiFi.config(localIp, gateway, subnet, dns);
+  } else {
+    WiFi.config(IPAddress(0u), IPAddress(0u), IPAddress(0u));
+  }
+
+  if (_fastConnect) {
+    // Known access point and channel skip the scan
+    Serial.printf("Connecting to %s on channel %i.\r\n", ssid, wifiCache.channel);
+    WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
 }
 
 void Network::exitConfiguredMode() {
   Serial.println(__FUNCTION__);
 
+  if (_mdnsStarted) {
+    MDNS.end();
+    _mdnsStarted = false;
+  }
+
   WiFi.softAPdisconnect(true);
   WiFi.mode(WIFI_MODE_NULL);
 
@@ -161,17 +295,78 @@ bool Network::isWifiConfigured() const {
   return true;
 }
 
+bool Network::isWebServerReachable() const {
+  return (_state == State::CONFIGURATION_MODE) or ((_state == State::CONFIGURED) and _onConnectHandled);
+}
+
 bool Network::isWifiConnected() const {
   return (WiFi.status() == WL_CONNECTED);
 }
 
+void Network::startMdns() {
+  const char* hostname = _config.getValueAsCString("hostname").value_or("");
+  if ((hostname[0] == '\0') or (not MDNS.begin(hostname))) {
+    Serial.printf("mDNS start failed.\r\n");
+    return;
+  }
+
+  MDNS.setInstanceName(hostname);
+  MDNS.addService("http", "tcp", 80);
+  MDNS.addService("co2sensor", "tcp", 80);
+  MDNS.addServiceTxt("co2sensor", "tcp", "version", GIT_DESCRIBE);
+  MDNS.addServiceTxt("co2sensor", "tcp", "api", apiVersion);
+  MDNS.addServiceTxt("co2sensor", "tcp", "co2", "");
+
+  Serial.printf("mDNS started as %s.local.\r\n", hostname);
+  _mdnsStarted = true;
+  _mdnsMeasurementCounter = 0;
+}
+
+void Network::updateMdns() {
+  if ((not _mdnsStarted) or (_measurements->getMeasurementCounter() == _mdnsMeasurementCounter)) {
+    return;
+  }
+
+  if ((_mdnsMeasurementCounter != 0) and ((millis() - _mdnsLastUpdateMillis) < mdnsUpdateInterval)) {
+    return;
+  }
+
+  _mdnsMeasurementCounter = _measurements->getMeasurementCounter();
+  _mdnsLastUpdateMillis = millis();
+
+  // Setting an existing key replaces its value
+  char co2[8] = "";
+  const auto& measurement = _measurements->dataLast().getMeasurement(0);
+  if (measurement.isValid(Quantity::Scd30Co2)) {
+    snprintf(co2, sizeof(co2), "%.0f", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)]);
+  }
+  MDNS.addServiceTxt("co2sensor", "tcp", "co2", co2);
+}
+
 void Network::onWifiConnect() {
-  const auto ntpServer = _config.getValueAsString("ntpServer").value_or("");
-  const auto tzInfo = _config.getValueAsString("tzInfo").value_or("");
+  if (not _mdnsStarted) {
+    startMdns();
+  }
+
+  _lastConnectDuration = millis() - _connectStartMillis;
+  _numberOfConnects++;
+  _fastConnect = false;
+  Serial.printf("WiFi connected after %u ms, IP %s.\r\n", _lastConnectDuration, WiFi.localIP().toString().c_str());
 
-  if (not ntpServer.empty()) {
-    Serial.printf("Getting time from %s.\r\n", ntpServer.c_str());
-    configTzTime(tzInfo.c_str(), ntpServer.c_str());
+  // Remember the access point for the next start
+  const char* ssid = _config.getValueAsCString("wifiSsid").value_or("");
+  wifiCache.ssidHash = hash(ssid, strlen(ssid));
+  memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+  wifiCache.channel = WiFi.channel();
+  wifiCache.magic = wifiCacheMagic;
+  wifiCache.checksum = wifiCacheChecksum();
+
+  const char* ntpServer = _config.getValueAsCString("ntpServer").value_or("");
+  const char* tzInfo = _config.getValueAsCString("tzInfo").value_or("");
+
+  if (ntpServer[0] != '\0') {
+    Serial.printf("Getting time from %s.\r\n", ntpServer);
+    configTzTime(tzInfo, ntpServer);
 
     // Call getLocalTime to trigger update of time. Unclear why this is required.
     struct tm timeinfo;
@@ -192,6 +387,15 @@ void Network::sendHttpRedirect(const char* url) {
   _webServer.send(302, contentTypeHtmlUtf8, "");
 }
 
+void Network::sendJson(int code, const JsonDocument& json) {
+  _webServer.setContentLength(measureJson(json));
+  _webServer.send(code, contentTypeJson, "");
+
+  // Serialized straight into the connection, without an intermediate string
+  WiFiClient client = _webServer.client();
+  serializeJson(json, client);
+}
+
 void Network::onWebServerRoot() {
   if (_state == State::CONFIGURATION_MODE) {
     sendHttpRedirect("http://192.168.4.1/config");
@@ -207,31 +411,26 @@ void Network::onWebServerRoot() {
   _webServer.sendContent("<meta http-equiv='refresh' content='15'>");
   _webServer.sendContent(html::body);
 
-  char* s  = nullptr;
-  auto& measurement = _measurements->dataLast().getMeasurement(0);
-
+  const auto& measurement = _measurements->dataLast().getMeasurement(0);
 
   _webServer.sendContent("<div><table>");
 
-  if ((asprintf(&s,"<tr><td>Co2</td><td>%5.0f ppm</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)]) != -1) and s) {
-    _webServer.sendContent(s);
-    free(s);
-  }
+  char row[64];
+  TextWriter writer{row, sizeof(row)};
+  writer.append("<tr><td>Co2</td><td>%5.0f ppm</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)]);
+  _webServer.sendContent_P(row, writer.length());
 
-  if ((asprintf(&s,"<tr><td>Temperature</td><td>%5.1f °C</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)]) != -1) and s) {
-    _webServer.sendContent(s);
-    free(s);
-  }
+  writer = TextWriter{row, sizeof(row)};
+  writer.append("<tr><td>Temperature</td><td>%5.1f °C</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)]);
+  _webServer.sendContent_P(row, writer.length());
 
-  if ((asprintf(&s,"<tr><td>Humidity</td><td>%5.1f %%</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)]) != -1) and s) {
-    _webServer.sendContent(s);
-    free(s);
-  }
+  writer = TextWriter{row, sizeof(row)};
+  writer.append("<tr><td>Humidity</td><td>%5.1f %%</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)]);
+  _webServer.sendContent_P(row, writer.length());
 
-  if ((asprintf(&s,"<tr><td>Pressure</td><td>%5.0f mBar</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)]) != -1) and s) {
-    _webServer.sendContent(s);
-    free(s);
-  }
+  writer = TextWriter{row, sizeof(row)};
+  writer.append("<tr><td>Pressure</td><td>%5.0f mBar</td></tr>", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)]);
+  _webServer.sendContent_P(row, writer.length());
 
 // #if 1
 //   struct tm timeinfo;
@@ -246,16 +445,51 @@ void Network::onWebServerRoot() {
 
   _webServer.sendContent(html::footer);
   _webServer.client().stop();
+  INSTRUMENTATION_SAMPLE(Served);
+}
+
+Network::Authentication Network::checkWebServerAuthentication() {
+  const String cookie = _webServer.header("Cookie");
+  if (_webSession.verifyCookie(cookie.c_str())) {
+    return Authentication::Cookie;
+  }
+
+  const String authorization = _webServer.header("Authorization");
+  if (_webSession.verifyBasicAuthorization(authorization.c_str())) {
+    return Authentication::Basic;
+  }
+
+  return Authentication::None;
 }
 
 bool Network::requestWebServerAuthentication() {
-  if (_config.getValueAsBool("webAuthentification").value_or(false) and (_state != State::CONFIGURATION_MODE)) {
-    if (!_webServer.authenticate(_config.getValueAsString("webUserName").value_or("").c_str(), _config.getValueAsString("webPassword").value_or("").c_str())) {
-      _webServer.requestAuthentication(BASIC_AUTH, "Sensor Login", "Authentication failed");
-      return false;
-    }
+  if ((not _webSession.isEnabled()) or (_state == State::CONFIGURATION_MODE)) {
+    return true;
   }
-  return true;
+
+  const auto authentication = checkWebServerAuthentication();
+  if (authentication == Authentication::Cookie) {
+    return true;
+  }
+
+  if (authentication == Authentication::Basic) {
+    char token[WebSession::tokenLength + 1];
+    _webSession.createToken(token);
+
+    // Name, token and attributes, Max-Age has at most 10 digits
+    char cookie[WebSession::tokenLength + 64];
+    snprintf(cookie, sizeof(cookie), "%s=%s; Max-Age=%u; Path=/; HttpOnly; SameSite=Strict", WebSession::cookieName, token, WebSession::sessionLifetime);
+    _webServer.sendHeader("Set-Cookie", cookie);
+    return true;
+  }
+
+  _webServer.requestAuthentication(BASIC_AUTH, "Sensor Login", "Authentication failed");
+  INSTRUMENTATION_ROUTE_FAILURE();
+  return false;
+}
+
+bool Network::isWebServerUpdateAuthorized() {
+  return _webSession.isEnabled() and (checkWebServerAuthentication() != Authentication::None);
 }
 
 void Network::onWebServerConfig() {
@@ -276,36 +510,51 @@ void Network::onWebServerConfig() {
   if (_webServer.method() == HTTP_GET) {
     _webServer.sendContent("<form method='POST' action='/config'>");
 
+    const arena::RequestScope scope{};
+    auto* row = static_cast<char*>(arena::request().allocate(rowSize));
+    if (not row) {
+      INSTRUMENTATION_ROUTE_FAILURE();
+      _webServer.sendContent(html::footer);
+      _webServer.client().stop();
+      return;
+    }
+
+    bool rowDropped = false;
     for (const auto &entry : _config) {
-      char* s  = nullptr;
-      int ret = 0;
+      TextWriter writer{row, rowSize};
 
-      _webServer.sendContent("<div>");
+      writer.append("<div>");
 
       if (auto* value = std::get_if<std::string>(&entry._value)) {
-        ret = asprintf(&s,
+        writer.append(
           "<label for='%s'>%s</label>"
           "<input type='text' name='%s' id='%s' value='%s'/>"
           , entry._name, entry._name, entry._name, entry._name, value->c_str());
       } else if (auto* value = std::get_if<int>(&entry._value)) {
-        ret = asprintf(&s,
+        writer.append(
           "<label for='%s'>%s</label>"
           "<input type='number' name='%s' id='%s' value='%i'/>"
           , entry._name, entry._name, entry._name, entry._name, *value);
       } else if (auto* value = std::get_if<bool>(&entry._value)) {
-        ret = asprintf(&s,
+        writer.append(
           "<label for='%s'>%s</label>"
           "<input type='checkbox' name='%s' id='%s' value='1'%s/><input type='hidden' name='%s' value='0'/>"
           , entry._name, entry._name, entry._name, entry._name, *value ? " checked='checked'" : "", entry._name);
       }
 
-      if ((ret != -1) and s) {
-        _webServer.sendContent(s);
-        free(s);
-      }
+      writer.append("</div>");
 
-      _webServer.sendContent("</div>");
+      if (writer.overflowed()) {
+        // Only a string longer than Config::maxStringLength, e.g. from an old configuration file, gets here
+        Serial.printf("Configuration entry %s too long for the form.\r\n", entry._name);
+        rowDropped = true;
+        continue;
+      }
+      _webServer.sendContent_P(row, writer.length());
+    }
 
+    if (rowDropped) {
+      INSTRUMENTATION_ROUTE_FAILURE();
     }
 
     _webServer.sendContent(
@@ -314,37 +563,377 @@ void Network::onWebServerConfig() {
       "</div>"
       "</form>"
     );
-  } else {
-    for (auto &entry : _config) {
-      if (not _webServer.hasArg(entry._name)) {
-        continue;
+  } else if (not applyConfigForm()) {
+    _webServer.sendContent(html::footer);
+    _webServer.client().stop();
+    return;
+  }
+
+  _webServer.sendContent(html::footer);
+  _webServer.client().stop();
+
+  if (_webServer.method() == HTTP_POST) {
+    _restartCallback();
+  }
+}
+
+bool Network::applyConfigForm() {
+  // Same validation as PATCH /api/config, form values are converted to the type of each entry first
+  const arena::RequestScope scope{};
+  arena::RequestJsonDocument changes(Config::jsonBufferSize);
+  arena::RequestJsonDocument result(Config::jsonBufferSize);
+
+  for (const auto& entry : _config) {
+    if (not _webServer.hasArg(entry._name)) {
+      continue;
+    }
+
+    const auto arg = _webServer.arg(entry._name);
+
+    if (std::holds_alternative<int>(entry._value)) {
+      char* end;
+      const long integer = strtol(arg.c_str(), &end, 10);
+      if ((arg.length() > 0) and (*end == '\0') and (integer >= INT_MIN) and (integer <= INT_MAX)) {
+        changes[entry._name] = static_cast<int>(integer);
+      } else {
+        // Rejected by Config::patch as not an integer
+        changes[entry._name] = arg;
       }
+    } else if (std::holds_alternative<bool>(entry._value)) {
+      changes[entry._name] = (arg == "1");
+    } else {
+      changes[entry._name] = arg;
+    }
+  }
 
-      auto arg = _webServer.arg(entry._name);
+  auto changed = result.createNestedObject("changed");
+  auto errors = result.createNestedObject("errors");
+  if ((not changes.overflowed()) and _config.patch(changes.as<JsonObjectConst>(), changed, errors)) {
+    return true;
+  }
 
-      if (auto* value = std::get_if<std::string>(&entry._value)) {
-        *value = std::string(arg.c_str());
-      } else if (auto* value = std::get_if<int>(&entry._value)) {
-        *value = arg.toInt();
-      } else if (auto* value = std::get_if<bool>(&entry._value)) {
-        *value = (arg == "1");
+  INSTRUMENTATION_ROUTE_FAILURE();
+  _webServer.sendContent("<p>Configuration not saved:</p><ul>");
+  if (changes.overflowed()) {
+    _webServer.sendContent("<li>Too many values.</li>");
+  }
+  for (const auto error : errors) {
+    char line[128];
+    TextWriter writer{line, sizeof(line)};
+    writer.append("<li>%s: %s</li>", error.key().c_str(), error.value().as<const char*>());
+    _webServer.sendContent_P(line, writer.length());
+  }
+  _webServer.sendContent("</ul><p><a href='/config'>Back</a></p>");
+  return false;
+}
+
+void Network::onWebServerApiConfig() {
+  if (not requestWebServerAuthentication()) {
+    return;
+  }
+
+  const arena::RequestScope scope{};
+  arena::RequestJsonDocument response(2 * Config::jsonBufferSize);
+
+  if (_webServer.method() == HTTP_GET) {
+    auto object = response.to<JsonObject>();
+    if (_webServer.hasArg("schema")) {
+      _config.schemaToJson(object);
+    } else {
+      _config.toJson(object);
+    }
+    sendJson(response.overflowed() ? 500 : 200, response);
+    return;
+  }
+
+  const auto& body = _webServer.arg("plain");
+  arena::RequestJsonDocument request(Config::jsonBufferSize);
+  const auto error = deserializeJson(request, body.c_str(), body.length());
+  if (error or (not request.is<JsonObject>())) {
+    response["error"] = error ? error.c_str() : "expected object";
+    INSTRUMENTATION_ROUTE_FAILURE();
+    sendJson(400, response);
+    return;
+  }
+
+  auto changed = response.createNestedObject("changed");
+  auto errors = response.createNestedObject("errors");
+  if (not _config.patch(request.as<JsonObjectConst>(), changed, errors)) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    sendJson(400, response);
+    return;
+  }
+
+  // Most entries are only read at startup, so changes take effect with the next restart
+  const bool modified = changed.size() > 0;
+  const bool restart = modified and _webServer.hasArg("restart");
+  if (modified) {
+    _config.finish();
+  }
+  response["restart"] = restart;
+  response["restartRequired"] = modified and (not restart);
+  sendJson(response.overflowed() ? 500 : 200, response);
+
+  if (restart) {
+    _webServer.client().stop();
+    _restartCallback();
+  }
+}
+
+void Network::onWebServerUpdateUpload() {
+  auto& upload = _webServer.upload();
+
+  switch (upload.status) {
+    case UPLOAD_FILE_START:
+      _updateWritten = false;
+      _updateAuthorized = isWebServerUpdateAuthorized();
+      // Unauthorized uploads are read but ignored, the response is sent after the upload
+      if (*_updateAuthorized) {
+        Serial.printf("Receiving firmware %s.\r\n", upload.filename.c_str());
+        _ota->begin(_webServer.arg("sha256").c_str());
       }
+      break;
+
+    case UPLOAD_FILE_WRITE:
+      _ota->write(upload.buf, upload.currentSize);
+      break;
+
+    case UPLOAD_FILE_END:
+      _updateWritten = _ota->end();
+      break;
+
+    case UPLOAD_FILE_ABORTED:
+      _ota->abort();
+      break;
+  }
+}
+
+void Network::onWebServerUpdate() {
+  if (not _webSession.isEnabled()) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    _webServer.send(403, contentTypePlain, "Updates require webAuthentification.");
+    return;
+  }
+
+  // Without an upload the credentials weren't checked yet
+  const bool authorized = _updateAuthorized ? *_updateAuthorized : isWebServerUpdateAuthorized();
+  _updateAuthorized.reset();
+  if (not authorized) {
+    _webServer.requestAuthentication(BASIC_AUTH, "Sensor Login", "Authentication failed");
+    INSTRUMENTATION_ROUTE_FAILURE();
+    return;
+  }
+
+  if (not _updateWritten) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    _webServer.send(400, contentTypePlain, _ota->getError());
+    return;
+  }
+
+  _webServer.send(200, contentTypePlain, "Update written, restarting.");
+  _webServer.client().stop();
+  _restartCallback();
+}
+
+void Network::onWebServerHistoryBinary() {
+  if (not requestWebServerAuthentication()) {
+    return;
+  }
+
+  _webServer.sendHeader("Cache-Control", "no-cache");
+  _webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  _webServer.send(200, contentTypeOctetStream, "");
+
+  // Samples are encoded straight out of the ring, the encoder only holds one chunk at a time
+  historyFrame::Encoder encoder{[this](const uint8_t* data, std::size_t size) {
+    _webServer.sendContent_P(reinterpret_cast<const char*>(data), size);
+  }};
 
+  const auto& data = _measurements->dataLast();
+  const auto numberOfSamples = data.getNumberOfStoredMeasurements();
+
+  encoder.begin(quantityDecimalExponents.size(), quantityDecimalExponents.data(), numberOfSamples);
+  for (std::size_t i = numberOfSamples; i > 0; --i) {
+    const auto& measurement = data.getMeasurement(i - 1);
+    encoder.addSample(measurement.time, measurement.data.data());
+  }
+  encoder.finish();
+
+  // Terminate chunked transfer
+  _webServer.sendContent("");
+  _webServer.client().stop();
+  INSTRUMENTATION_SAMPLE(Served);
+}
+
+void Network::onWebServerHistory() {
+  if (not requestWebServerAuthentication()) {
+    return;
+  }
+
+  const uint32_t since = _webServer.hasArg("since") ? strtoul(_webServer.arg("since").c_str(), nullptr, 10) : 0;
+  std::size_t limit = maxHistoryLimit;
+  if (_webServer.hasArg("limit")) {
+    limit = std::min<std::size_t>(std::max(_webServer.arg("limit").toInt(), 1l), maxHistoryLimit);
+  }
+
+  // The RAM ring holds the latest measurements, everything older comes from flash
+  const auto& data = _measurements->dataLast();
+  const auto numberOfStored = data.getNumberOfStoredMeasurements();
+  const uint32_t ringFirst = (numberOfStored > 0) ? data.getMeasurement(numberOfStored - 1).sequence : 0;
+  const uint32_t last = (numberOfStored > 0) ? data.getMeasurement(0).sequence : 0;
+  const auto& historyStore = _measurements->historyStore();
+  const uint32_t first = (historyStore.getFirstSequence() != 0) ? historyStore.getFirstSequence() : ringFirst;
+
+  _webServer.sendHeader("Cache-Control", "no-cache");
+  _webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  _webServer.send(200, contentTypeJson, "");
+
+  // Rows are collected into chunks, so a page needs few TCP segments without holding it in memory
+  char chunk[1024];
+  std::size_t chunkLength = 0;
+  std::size_t count = 0;
+  uint32_t cursor = since;
+
+  const auto appendRow = [&](const Measurement& measurement) {
+    char row[256];
+    TextWriter writer{row, sizeof(row)};
+    writer.append("%s{\"sequence\":%u,\"time\":%ld", (count > 0) ? "," : "", measurement.sequence, static_cast<long>(measurement.time));
+    for (std::size_t i = 0; i < measurement.data.size(); ++i) {
+      if (measurement.isValid(static_cast<Quantity>(i))) {
+        writer.append(",\"%s\":%.*f", quantityNames[i], std::max(-quantityDecimalExponents[i], 0), measurement.data[i]);
+      } else {
+        writer.append(",\"%s\":null", quantityNames[i]);
+      }
+    }
+    writer.append("}");
+
+    if ((chunkLength + writer.length()) > sizeof(chunk)) {
+      _webServer.sendContent_P(chunk, chunkLength);
+      chunkLength = 0;
     }
+    memcpy(&chunk[chunkLength], row, writer.length());
+    chunkLength += writer.length();
+
+    cursor = measurement.sequence;
+    return ++count < limit;
+  };
+
+  _webServer.sendContent("{\"measurements\":[");
+
+  if ((ringFirst == 0) or ((cursor + 1) < ringFirst)) {
+    // A reference keeps the callback within the small buffer of std::function
+    historyStore.read(cursor, (ringFirst != 0) ? ringFirst : UINT32_MAX, [&appendRow](const Measurement& measurement) {
+      return appendRow(measurement);
+    });
   }
 
-  _webServer.sendContent(html::footer);
+  for (std::size_t i = numberOfStored; (i > 0) and (count < limit); --i) {
+    const auto& measurement = data.getMeasurement(i - 1);
+    if (measurement.sequence > cursor) {
+      appendRow(measurement);
+    }
+  }
+
+  if (chunkLength > 0) {
+    _webServer.sendContent_P(chunk, chunkLength);
+  }
+
+  // Resuming with since=next continues after the last measurement of this page
+  TextWriter writer{chunk, sizeof(chunk)};
+  writer.append("],\"first\":%u,\"last\":%u,\"next\":%u,\"more\":%s}", first, last, cursor, (cursor < last) ? "true" : "false");
+  _webServer.sendContent_P(chunk, writer.length());
+
+  // Terminate chunked transfer
+  _webServer.sendContent("");
   _webServer.client().stop();
+  INSTRUMENTATION_SAMPLE(Served);
+}
 
-  if (_webServer.method() == HTTP_POST) {
-    _restartCallback();
+void Network::onWebServerMetrics() {
+  if (not requestWebServerAuthentication()) {
+    return;
   }
+
+  _metrics.update();
+
+  const auto runtimeMetricsLength = _metrics.renderRuntimeMetrics();
+
+  _webServer.setContentLength(_metrics.getMeasurementMetricsLength() + runtimeMetricsLength);
+  _webServer.send(200, Metrics::contentType, "");
+  _webServer.sendContent_P(_metrics.getMeasurementMetrics(), _metrics.getMeasurementMetricsLength());
+  _webServer.sendContent_P(_metrics.getRuntimeMetrics(), runtimeMetricsLength);
+  INSTRUMENTATION_SAMPLE(Served);
 }
 
-void Network::onWebServerNotFound() {
-  if (_state == State::CONFIGURATION_MODE) {
-    sendHttpRedirect("http://192.168.4.1/config");
-  } else {
+#ifdef INSTRUMENTATION
+void Network::onWebServerDiagnostics() {
+  if (not requestWebServerAuthentication()) {
+    return;
+  }
+
+  static char diagnostics[instrumentation::maxJsonLength + 1];
+  const auto length = instrumentation::renderJson(diagnostics, sizeof(diagnostics));
+  if (length == 0) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    _webServer.send(500, contentTypePlain, "Diagnostics buffer too small.");
+    return;
+  }
+
+  _webServer.setContentLength(length);
+  _webServer.send(200, contentTypeJson, "");
+  _webServer.sendContent_P(diagnostics, length);
+}
+#endif
+
+#ifdef ALLOCATION_TRACKING
+void Network::onWebServerAllocations() {
+  if (not requestWebServerAuthentication()) {
+    return;
+  }
+
+  static char allocations[allocationTracker::maxJsonLength + 1];
+  const auto length = allocationTracker::renderJson(allocations, sizeof(allocations));
+  if (length == 0) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    _webServer.send(500, contentTypePlain, "Allocations buffer too small.");
+    return;
+  }
+
+  _webServer.setContentLength(length);
+  _webServer.send(200, contentTypeJson, "");
+  _webServer.sendContent_P(allocations, length);
+}
+#endif
+
+void Network::onWebServerFile(const char* fileName, const char* contentType) {
+  if (not requestWebServerAuthentication()) {
+    return;
+  }
+
+  File file = SPIFFS.open(fileName, "r");
+  if (not file) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    _webServer.send(404, contentTypePlain, "Not found.");
+    return;
+  }
+
+  _webServer.sendHeader("Cache-Control", "no-cache");
+  _webServer.streamFile(file, contentType);
+  file.close();
+}
+
+void Network::onWebServerCaptivePortalProbe() {
+  if (_state != State::CONFIGURATION_MODE) {
+    INSTRUMENTATION_ROUTE_FAILURE();
     _webServer.send(404, contentTypePlain, "Not found.");
+    return;
   }
+
+  if (not _captivePortal.allowHttpRequest(_webServer.client().remoteIP())) {
+    INSTRUMENTATION_ROUTE_FAILURE();
+    _webServer.send(429, contentTypePlain, "Too many requests.");
+    return;
+  }
+
+  sendHttpRedirect("http://192.168.4.1/config");
 }
@@ -1,10 +1,15 @@
 #ifndef NETWORK_HPP
 #define NETWORK_HPP
 
+#include "captive_portal.hpp"
 #include "config.hpp"
 #include "measurements.hpp"
+#include "metrics.hpp"
+#include "mqtt.hpp"
+#include "ota.hpp"
+#include "telemetry.hpp"
+#include "web_session.hpp"
 
-#include <DNSServer.h>
 #include <WebServer.h>
 
 class Network {
@@ -18,9 +23,9 @@ public:
     NOT_CONFIGURED
   };
 
-  Network(Config& config, const RestartCallback& restartCallback) : _config{config}, _restartCallback(restartCallback) {};
+  Network(Config& config, const RestartCallback& restartCallback) : _config{config}, _restartCallback(restartCallback), _mqtt{config}, _telemetry{config} {};
 
-  void setup(const Measurements* measurements);
+  void setup(const Measurements* measurements, const Power* power, Ota* ota);
   void loop();
 
   long getWifiRssi() const;
@@ -28,10 +33,40 @@ public:
 
   State getState() const { return _state; }
 
+  /// Web server is running and can be reached, via the access point in configuration mode or via WiFi otherwise
+  bool isWebServerReachable() const;
+
+  /// Duration of the last WiFi (re)connect in ms
+  uint32_t getLastConnectDuration() const { return _lastConnectDuration; }
+
+  uint32_t getNumberOfConnects() const { return _numberOfConnects; }
+
+  /// Number of connects with cached parameters which timed out and fell back to a scan
+  uint32_t getNumberOfFastConnectFailures() const { return _numberOfFastConnectFailures; }
+
+  const Telemetry& telemetry() const { return _telemetry; }
+
 private:
+  /// Version of the HTTP API, advertised via DNS-SD
+  static constexpr const char* apiVersion = "1";
+
+  /// TXT records are updated at most this often, each update is multicast to the network
+  static constexpr unsigned long mdnsUpdateInterval{60000}; // ms
+
+  /// Time until a connect with cached parameters falls back to a scan
+  static constexpr unsigned long fastConnectTimeout{5000}; // ms
+
+  /// Maximum number of measurements per /api/history response, bounds the time a request blocks the loop
+  static constexpr std::size_t maxHistoryLimit{200};
+
+  /// Request arena buffer for one entry of the configuration form
+  static constexpr std::size_t rowSize{512};
 
   static constexpr const char* contentTypeHtmlUtf8 = "text/html; charset=utf-8";
   static constexpr const char* contentTypePlain = "text/plain";
+  static constexpr const char* contentTypeOctetStream = "application/octet-stream";
+  static constexpr const char* contentTypeJson = "application/json";
+  static constexpr const char* contentTypeCsv = "text/csv";
 
   void setupWebserver();
 
@@ -48,20 +83,96 @@ private:
 
   void onWebServerRoot();
   void onWebServerConfig();
-  void onWebServerNotFound();
+  /**
+   * @brief Applies the values posted by the configuration form
+   *
+   * @retval true all values valid and applied
+   * @retval false nothing applied, the reasons are sent as part of the page
+   */
+  bool applyConfigForm();
+  void onWebServerApiConfig();
+  void onWebServerUpdate();
+  void onWebServerUpdateUpload();
+  void onWebServerHistoryBinary();
+  void onWebServerHistory();
+  void onWebServerMetrics();
+#ifdef INSTRUMENTATION
+  void onWebServerDiagnostics();
+#endif
+#ifdef ALLOCATION_TRACKING
+  void onWebServerAllocations();
+#endif
+  void onWebServerFile(const char* fileName, const char* contentType);
+  void onWebServerCaptivePortalProbe();
+
+  /**
+   * @brief Starts connecting to the configured WiFi
+   *
+   * @param[in] fast use BSSID and channel of the last connect if available
+   */
+  void connectWifi(bool fast);
 
   void onWifiConnect();
 
+  void startMdns();
+  void updateMdns();
+
+  enum class Authentication {
+    None,
+    Cookie,
+    Basic
+  };
+
+  /**
+   * @brief Checks the session cookie and then the Basic auth of the current request
+   *
+   * WebServer returns each header as a String copy on the heap, so each one is looked up at most once per call.
+   *
+   * @return credential that was valid
+   */
+  Authentication checkWebServerAuthentication();
+
   bool requestWebServerAuthentication();
+
+  /**
+   * @brief Checks the credentials of a firmware update without sending a response
+   *
+   * Unlike the other pages, updates always need credentials, also in configuration mode. The SHA-256 of the image
+   * comes from the uploader, so it only detects transfer errors and proves nothing about who built the image.
+   *
+   * @retval true authentication is enabled and the request has a valid session or Basic auth
+   * @retval false update must be rejected
+   */
+  bool isWebServerUpdateAuthorized();
+
   void sendHttpRedirect(const char* url);
+  void sendJson(int code, const JsonDocument& json);
 
   Config &_config;
-  DNSServer _dnsServer{};
+  CaptivePortal _captivePortal{};
   WebServer _webServer{80};
+  WebSession _webSession{};
   State _state{State::INITIAL};
   RestartCallback _restartCallback;
   const Measurements* _measurements{};
+  Ota* _ota{};
+  bool _updateWritten{false};
+  /// Result of isWebServerUpdateAuthorized() at the start of the upload, reused for the response
+  std::optional<bool> _updateAuthorized{};
+  Metrics _metrics{};
+  Mqtt _mqtt;
+  Telemetry _telemetry;
   bool _onConnectHandled{false};
+
+  bool _mdnsStarted{false};
+  uint32_t _mdnsMeasurementCounter{0};
+  unsigned long _mdnsLastUpdateMillis{0};
+
+  bool _fastConnect{false};
+  unsigned long _connectStartMillis{0};
+  uint32_t _lastConnectDuration{0};
+  uint32_t _numberOfConnects{0};
+  uint32_t _numberOfFastConnectFailures{0};
 };
 
 #endif
@@ -0,0 +1,187 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+
+#include <cstring>
+
+#include "ota.hpp"
+
+namespace {
+
+bool parseHash(const char* hex, uint8_t* hash) {
+  if (strlen(hex) != (2 * Ota::hashSize)) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < (2 * Ota::hashSize); ++i) {
+    const char c = tolower(hex[i]);
+    uint8_t digit;
+    if ((c >= '0') and (c <= '9')) {
+      digit = c - '0';
+    } else if ((c >= 'a') and (c <= 'f')) {
+      digit = c - 'a' + 10;
+    } else {
+      return false;
+    }
+    hash[i / 2] = (i % 2) ? (hash[i / 2] | digit) : (digit << 4);
+  }
+
+  return true;
+}
+
+}
+
+Ota::~Ota() {
+  abort();
+}
+
+void Ota::setup() {
+  Preferences preferences;
+  preferences.begin(preferencesName);
+  _pending = preferences.getBool("pending", false);
+  if (not _pending) {
+    preferences.end();
+    return;
+  }
+
+  // Counted before anything else runs, so a crash during setup() also counts
+  const uint8_t attempts = preferences.getUChar("attempts", 0) + 1;
+  preferences.putUChar("attempts", attempts);
+  preferences.end();
+
+  Serial.printf("Firmware pending, boot attempt %u.\r\n", attempts);
+  if (attempts > maxBootAttempts) {
+    rollback();
+  }
+}
+
+void Ota::loop(bool healthy) {
+  if (not _pending) {
+    return;
+  }
+
+  if (healthy) {
+    confirm(true);
+  } else if (millis() >= confirmTimeout) {
+    confirm(false);
+  }
+}
+
+void Ota::confirm(bool healthy) {
+  if (not _pending) {
+    return;
+  }
+
+  if (not healthy) {
+    Serial.printf("Firmware failed health check.\r\n");
+    rollback();
+    return;
+  }
+
+  Serial.printf("Firmware confirmed.\r\n");
+  clearPending();
+}
+
+void Ota::rollback() {
+  clearPending();
+
+  // With two OTA partitions the next update partition is the one booted before the update
+  const esp_partition_t* previous = esp_ota_get_next_update_partition(nullptr);
+  if ((previous == nullptr) or (esp_ota_set_boot_partition(previous) != ESP_OK)) {
+    Serial.printf("Rollback failed.\r\n");
+    return;
+  }
+
+  Serial.printf("Rolling back to %s.\r\n", previous->label);
+  ESP.restart();
+}
+
+void Ota::clearPending() {
+  Preferences preferences;
+  preferences.begin(preferencesName);
+  preferences.clear();
+  preferences.end();
+  _pending = false;
+}
+
+bool Ota::begin(const char* expectedHash) {
+  abort();
+
+  if (not parseHash(expectedHash, _expectedHash)) {
+    _error = "Invalid sha256.";
+    return false;
+  }
+
+  if (not Update.begin(UPDATE_SIZE_UNKNOWN)) {
+    _error = Update.errorString();
+    return false;
+  }
+
+  mbedtls_sha256_init(&_sha256);
+  mbedtls_sha256_starts_ret(&_sha256, 0);
+  _size = 0;
+  _error = "";
+  _active = true;
+  return true;
+}
+
+bool Ota::write(uint8_t* data, std::size_t size) {
+  if (not _active) {
+    return false;
+  }
+
+  mbedtls_sha256_update_ret(&_sha256, data, size);
+  if (Update.write(data, size) != size) {
+    _error = Update.errorString();
+    abort();
+    return false;
+  }
+
+  _size += size;
+  return true;
+}
+
+bool Ota::end() {
+  if (not _active) {
+    return false;
+  }
+
+  uint8_t hash[hashSize];
+  mbedtls_sha256_finish_ret(&_sha256, hash);
+  mbedtls_sha256_free(&_sha256);
+  _active = false;
+
+  // Hash is not secret, a plain comparison is fine
+  if (memcmp(hash, _expectedHash, sizeof(hash)) != 0) {
+    _error = "Hash mismatch.";
+    Update.abort();
+    return false;
+  }
+
+  // Sets the new partition as boot partition. The size is unknown in begin(), so the image is complete even though
+  // it does not fill the partition.
+  if (not Update.end(true)) {
+    _error = Update.errorString();
+    return false;
+  }
+
+  Preferences preferences;
+  preferences.begin(preferencesName);
+  preferences.putUChar("attempts", 0);
+  preferences.putBool("pending", true);
+  preferences.end();
+
+  Serial.printf("Firmware of %u bytes written.\r\n", static_cast<unsigned>(_size));
+  return true;
+}
+
+void Ota::abort() {
+  if (not _active) {
+    return;
+  }
+
+  mbedtls_sha256_free(&_sha256);
+  Update.abort();
+  _active = false;
+}
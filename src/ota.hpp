@@ -0,0 +1,94 @@
+#ifndef OTA_HPP
+#define OTA_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mbedtls/sha256.h>
+
+/**
+ * Firmware update over HTTP with verification and automatic rollback.
+ *
+ * The image is written in the chunks it is received into the inactive OTA partition while its SHA-256 is computed,
+ * so it is never held in memory. Only an image matching the expected hash is activated. The new firmware is then
+ * pending: every boot counts an attempt in NVS until loop() sees it healthy. If the firmware doesn't become healthy
+ * within confirmTimeout or resets before confirming maxBootAttempts times, the previous partition is booted again.
+ */
+class Ota {
+public:
+  static constexpr std::size_t hashSize = 32u;
+
+  ~Ota();
+
+  /// Counts the boot attempt of a pending firmware and rolls back if it never became healthy, call first in setup()
+  void setup();
+
+  /**
+   * @brief Confirms a pending firmware once it is healthy, call in loop()
+   *
+   * @param[in] healthy result of health check, rolls back if it is still false after confirmTimeout
+   */
+  void loop(bool healthy);
+
+  /**
+   * @brief Ends the pending state after boot
+   *
+   * @param[in] healthy result of health check, rolls back if false
+   */
+  void confirm(bool healthy);
+
+  bool isPending() const { return _pending; }
+
+  /**
+   * @brief Starts an update
+   *
+   * @param[in] expectedHash expected SHA-256 of the image as hex
+   * @retval true ready for data
+   * @retval false invalid hash or update could not be started, see getError()
+   */
+  bool begin(const char* expectedHash);
+
+  /**
+   * @brief Writes the next chunk of the image
+   *
+   * @retval true chunk written
+   * @retval false writing failed, update aborted
+   */
+  bool write(uint8_t* data, std::size_t size);
+
+  /**
+   * @brief Verifies and activates the image
+   *
+   * @retval true image valid, boots after restart
+   * @retval false image invalid, update aborted
+   */
+  bool end();
+
+  void abort();
+
+  bool isActive() const { return _active; }
+
+  /// Reason of last failure
+  const char* getError() const { return _error; }
+
+  std::size_t getSize() const { return _size; }
+
+private:
+  static constexpr const char* preferencesName = "ota";
+  static constexpr uint8_t maxBootAttempts{2};
+
+  /// Time since boot a pending firmware has to become healthy, long enough for a WiFi scan and a slow access point
+  static constexpr unsigned long confirmTimeout{300000}; // ms
+
+  void rollback();
+  void clearPending();
+
+  bool _active{false};
+  bool _pending{false};
+  const char* _error{""};
+  std::size_t _size{0};
+  uint8_t _expectedHash[hashSize]{};
+  mbedtls_sha256_context _sha256{};
+};
+
+#endif
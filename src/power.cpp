@@ -0,0 +1,156 @@
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "power.hpp"
+#include "measurements.hpp"
+#include "network.hpp"
+#include "pins.hpp"
+#include "ui.hpp"
+
+namespace {
+
+constexpr uint8_t buttons[] = {pins::Button1, pins::Button2, pins::Button3, pins::Button4};
+
+// Typical current draw in A
+constexpr float cpuActiveCurrent = 0.050f;
+constexpr float cpuIdleCurrent = 0.025f;
+constexpr float cpuLightSleepCurrent = 0.0008f;
+constexpr float wifiCurrent = 0.100f;
+constexpr float wifiModemSleepCurrent = 0.020f;
+constexpr float scd30Current = 0.019f;
+constexpr float displayCurrent = 0.010f;
+
+}
+
+void Power::setup(const Measurements* measurements, const Ui* ui, const Network* network) {
+  _measurements = measurements;
+  _ui = ui;
+  _network = network;
+  _enabled = _config.getValueAsBool("powerSave").value_or(false);
+  _startTime = esp_timer_get_time();
+
+  if (not _enabled) {
+    return;
+  }
+
+  // Buttons are active low
+  for (const auto button : buttons) {
+    gpio_wakeup_enable(static_cast<gpio_num_t>(button), GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+}
+
+void Power::loop() {
+  if (not _enabled) {
+    return;
+  }
+
+  uint32_t duration = _measurements->getMillisUntilNextMeasurement();
+  if (duration == 0) {
+    duration = samplePollInterval;
+  }
+
+  // While the display is on, or a button is still held after a wake-up, the UI needs its regular updates
+  if ((not _ui->isSleeping()) or isButtonPressed()) {
+    duration = std::min(duration, _ui->getMillisUntilNextUpdate());
+  }
+
+  if (isWifiActive()) {
+    idle(std::min(duration, maxWifiIdleTime));
+  } else if (duration >= minLightSleepTime) {
+    lightSleep(duration);
+  } else {
+    idle(duration);
+  }
+}
+
+bool Power::isWifiActive() const {
+  const auto state = _network->getState();
+  return (state == Network::State::CONFIGURATION_MODE) or (state == Network::State::CONFIGURED);
+}
+
+bool Power::isButtonPressed() const {
+  return std::any_of(std::begin(buttons), std::end(buttons), [](uint8_t button) { return digitalRead(button) == LOW; });
+}
+
+void Power::lightSleep(uint32_t duration) {
+  const auto start = esp_timer_get_time();
+
+  esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(duration) * 1000u);
+  esp_light_sleep_start();
+  _numberOfWakeups++;
+
+  _stateTimes[static_cast<std::underlying_type_t<State>>(State::LightSleep)] += esp_timer_get_time() - start;
+}
+
+void Power::idle(uint32_t duration) {
+  if (duration == 0) {
+    return;
+  }
+
+  const auto start = esp_timer_get_time();
+
+  // Blocks the loop task, the idle task halts the CPU in the meantime
+  delay(duration);
+
+  _stateTimes[static_cast<std::underlying_type_t<State>>(State::Idle)] += esp_timer_get_time() - start;
+}
+
+Power::StateTimes Power::getStateTimes() const {
+  auto stateTimes = _stateTimes;
+
+  const uint64_t total = esp_timer_get_time() - _startTime;
+  const uint64_t inactive = stateTimes[static_cast<std::underlying_type_t<State>>(State::Idle)] + stateTimes[static_cast<std::underlying_type_t<State>>(State::LightSleep)];
+  stateTimes[static_cast<std::underlying_type_t<State>>(State::Active)] = (total > inactive) ? (total - inactive) : 0;
+
+  return stateTimes;
+}
+
+float Power::getDutyCycle() const {
+  const auto stateTimes = getStateTimes();
+
+  uint64_t total = 0;
+  for (const auto time : stateTimes) {
+    total += time;
+  }
+
+  return total ? (static_cast<float>(stateTimes[static_cast<std::underlying_type_t<State>>(State::Active)]) / total) : 1.0f;
+}
+
+float Power::getEstimatedCurrent(Subsystem subsystem) const {
+  switch (subsystem) {
+    case Subsystem::Cpu: {
+      const auto stateTimes = getStateTimes();
+      uint64_t total = 0;
+      for (const auto time : stateTimes) {
+        total += time;
+      }
+      if (total == 0) {
+        return cpuActiveCurrent;
+      }
+      return (stateTimes[static_cast<std::underlying_type_t<State>>(State::Active)] * cpuActiveCurrent
+        + stateTimes[static_cast<std::underlying_type_t<State>>(State::Idle)] * cpuIdleCurrent
+        + stateTimes[static_cast<std::underlying_type_t<State>>(State::LightSleep)] * cpuLightSleepCurrent) / total;
+    }
+
+    case Subsystem::Wifi:
+      if (not isWifiActive()) {
+        return 0.0f;
+      }
+      return _enabled ? wifiModemSleepCurrent : wifiCurrent;
+
+    case Subsystem::Scd30:
+      return scd30Current;
+
+    case Subsystem::Display:
+      return _ui->isSleeping() ? 0.0f : displayCurrent;
+
+    default:
+      return 0.0f;
+  }
+}
@@ -0,0 +1,92 @@
+#ifndef POWER_HPP
+#define POWER_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "config.hpp"
+
+class Measurements;
+class Network;
+class Ui;
+
+/**
+ * Power-aware idling of the main loop.
+ *
+ * If enabled by the config entry powerSave, the main loop no longer busy-spins between samples. Without WiFi the
+ * ESP32 enters light sleep until the next sample or UI update is due, or a button is pressed. With WiFi it uses modem
+ * sleep (see Network) and idles the CPU in short steps, so the web server stays responsive.
+ *
+ * Time spent in each state is accounted for the duty cycle and a rough estimate of the current draw per subsystem.
+ */
+class Power {
+public:
+  enum class State : uint8_t {
+    Active,
+    Idle,
+    LightSleep,
+    NumberOfStates
+  };
+
+  enum class Subsystem : uint8_t {
+    Cpu,
+    Wifi,
+    Scd30,
+    Display,
+    NumberOfSubsystems
+  };
+
+  using StateTimes = std::array<uint64_t, static_cast<size_t>(State::NumberOfStates)>;
+
+  Power(const Config& config) : _config{config} {};
+
+  void setup(const Measurements* measurements, const Ui* ui, const Network* network);
+
+  /// Idles until the next work is due, to be called at the end of the main loop
+  void loop();
+
+  bool isEnabled() const { return _enabled; }
+
+  /// Time spent in each state since boot in µs
+  StateTimes getStateTimes() const;
+
+  /// Fraction of time the CPU was active since boot
+  float getDutyCycle() const;
+
+  /**
+   * @brief Estimates the average current draw of a subsystem
+   *
+   * Based on typical values from the data sheets, so only suitable to compare configurations.
+   *
+   * @param[in] subsystem subsystem
+   * @return estimated current in A
+   */
+  float getEstimatedCurrent(Subsystem subsystem) const;
+
+  uint32_t getNumberOfWakeups() const { return _numberOfWakeups; }
+
+private:
+  /// Upper limit for idling while WiFi is active, keeps HTTP latency low
+  static constexpr uint32_t maxWifiIdleTime = 10u; // ms
+  /// Idle time while waiting for an overdue sample
+  static constexpr uint32_t samplePollInterval = 100u; // ms
+  /// Light sleep is not worth it below this duration
+  static constexpr uint32_t minLightSleepTime = 5u; // ms
+
+  bool isWifiActive() const;
+  bool isButtonPressed() const;
+  void lightSleep(uint32_t duration);
+  void idle(uint32_t duration);
+
+  const Config& _config;
+  const Measurements* _measurements{};
+  const Ui* _ui{};
+  const Network* _network{};
+  bool _enabled{false};
+
+  StateTimes _stateTimes{};
+  int64_t _startTime{0};
+  uint32_t _numberOfWakeups{0};
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include <algorithm>
+
+#include "pressure_compensation.hpp"
+
+void PressureCompensation::setup(const Config& config) {
+  _deadband = std::max(config.getValueAsInt("pressureDeadband").value_or(2), 1);
+  _minimumInterval = std::max(config.getValueAsInt("pressureUpdateInterval").value_or(600), 0) * 1000ul;
+}
+
+void PressureCompensation::reset() {
+  _applied = 0;
+}
+
+bool PressureCompensation::update(unsigned long millis, float pressure) {
+  if (std::isnan(_smoothed)) {
+    _smoothed = pressure;
+  } else {
+    const float elapsed = (millis - _lastSampleMillis) / 1000.0f;
+    _smoothed += (pressure - _smoothed) * (1.0f - std::exp(-elapsed / timeConstant));
+  }
+  _lastSampleMillis = millis;
+
+  // Without compensation the SCD30 assumes standard pressure, so the first value is applied right away
+  if (_applied == 0) {
+    return true;
+  }
+
+  if (std::fabs(_smoothed - _applied) < _deadband) {
+    return false;
+  }
+
+  return (millis - _lastUpdateMillis) >= _minimumInterval;
+}
+
+void PressureCompensation::applied(unsigned long millis, uint16_t pressure) {
+  _applied = pressure;
+  _lastUpdateMillis = millis;
+  _numberOfUpdates++;
+  _restartPending = true;
+}
+
+void PressureCompensation::addMeasurement(unsigned long millis, uint16_t interval) {
+  if (_restartPending and _hasMeasurement and (interval > 0)) {
+    // Without restart the next measurement had been expected one interval after the previous one
+    const long expected = std::lround(static_cast<float>(millis - _lastMeasurementMillis) / (interval * 1000.0f));
+    _numberOfLostSamples += std::max(expected - 1, 0l);
+  }
+
+  _restartPending = false;
+  _lastMeasurementMillis = millis;
+  _hasMeasurement = true;
+}
@@ -0,0 +1,79 @@
+#ifndef PRESSURE_COMPENSATION_HPP
+#define PRESSURE_COMPENSATION_HPP
+
+#include <cmath>
+#include <cstdint>
+
+#include "config.hpp"
+
+/**
+ * Decides when the ambient pressure known to the SCD30 is updated.
+ *
+ * Every update restarts the continuous measurement of the SCD30. The pressure is therefore smoothed, and an update is
+ * only requested once the smoothed pressure left a deadband around the applied one and a minimum interval has passed
+ * since the last update. The samples lost by each restart are counted from the gap until the next measurement.
+ */
+class PressureCompensation {
+public:
+  void setup(const Config& config);
+
+  /// Forgets the applied pressure, e.g. after the SCD30 was restarted without compensation
+  void reset();
+
+  /**
+   * @brief Updates the controller with a new pressure sample
+   *
+   * @param[in] millis time of sample in ms
+   * @param[in] pressure ambient pressure in hPa
+   * @retval true pressure of SCD30 should be updated to getTarget()
+   * @retval false no update required
+   */
+  bool update(unsigned long millis, float pressure);
+
+  /**
+   * @brief Records a successful update of the SCD30
+   *
+   * @param[in] millis time of update in ms
+   * @param[in] pressure pressure sent to SCD30 in hPa
+   */
+  void applied(unsigned long millis, uint16_t pressure);
+
+  /**
+   * @brief Records a new SCD30 measurement to account for samples lost by restarts
+   *
+   * @param[in] millis time of measurement in ms
+   * @param[in] interval current measurement interval in s
+   */
+  void addMeasurement(unsigned long millis, uint16_t interval);
+
+  /// Pressure to send to the SCD30 in hPa
+  uint16_t getTarget() const { return std::lround(_smoothed); }
+
+  /// Pressure known to the SCD30 in hPa, 0 if none
+  uint16_t getApplied() const { return _applied; }
+
+  float getSmoothed() const { return _smoothed; }
+  uint32_t getNumberOfUpdates() const { return _numberOfUpdates; }
+  uint32_t getNumberOfLostSamples() const { return _numberOfLostSamples; }
+
+private:
+  /// Time constant of the pressure smoothing, long enough to ignore doors and HVAC swings
+  static constexpr float timeConstant = 300.0f; // s
+
+  float _deadband{2.0f}; // hPa
+  unsigned long _minimumInterval{600000}; // ms
+
+  float _smoothed{NAN};
+  unsigned long _lastSampleMillis{0};
+  uint16_t _applied{0};
+  unsigned long _lastUpdateMillis{0};
+
+  bool _restartPending{false};
+  unsigned long _lastMeasurementMillis{0};
+  bool _hasMeasurement{false};
+
+  uint32_t _numberOfUpdates{0};
+  uint32_t _numberOfLostSamples{0};
+};
+
+#endif
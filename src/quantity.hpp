@@ -0,0 +1,79 @@
+#ifndef QUANTITY_HPP
+#define QUANTITY_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+
+enum class Quantity {
+  Scd30Co2,
+  Scd30Temperature,
+  Scd30Humidity,
+  Bmp280Pressure,
+  Bmp280Temperature,
+  FusedTemperature,
+  FusedHumidity,
+  NumberOfQuantities
+};
+
+struct Measurement {
+  time_t time;
+  /// Increases with every stored measurement, also across reboots, 0 if not stored yet
+  uint32_t sequence;
+  std::array<float, static_cast<size_t>(Quantity::NumberOfQuantities)> data;
+  /// One bit per quantity, set if the value was read successfully. Values without bit are NaN.
+  uint32_t valid;
+
+  bool isValid(Quantity quantity) const {
+    return (valid & (1u << static_cast<std::underlying_type_t<Quantity>>(quantity))) != 0;
+  }
+
+  /**
+   * @brief Sets a value, NaN marks it as invalid
+   *
+   * @param[in] quantity quantity to set
+   * @param[in] value value to set
+   */
+  void set(Quantity quantity, float value) {
+    const auto index = static_cast<std::underlying_type_t<Quantity>>(quantity);
+    data[index] = value;
+    if (std::isnan(value)) {
+      valid &= ~(1u << index);
+    } else {
+      valid |= (1u << index);
+    }
+  }
+
+  /// Marks all values as missing
+  void clear() {
+    data.fill(NAN);
+    valid = 0;
+  }
+};
+
+/// Fixed-point resolution of each quantity for binary transfer as decimal exponent (value = raw * 10^exponent)
+constexpr std::array<int8_t, static_cast<size_t>(Quantity::NumberOfQuantities)> quantityDecimalExponents{
+  -1, // Scd30Co2
+  -2, // Scd30Temperature
+  -2, // Scd30Humidity
+  -2, // Bmp280Pressure
+  -2, // Bmp280Temperature
+  -2, // FusedTemperature
+  -2, // FusedHumidity
+};
+
+/// Short names of each quantity, e.g. for keys and labels
+constexpr std::array<const char*, static_cast<size_t>(Quantity::NumberOfQuantities)> quantityNames{
+  "co2",
+  "temperature",
+  "humidity",
+  "pressure",
+  "bmp280Temperature",
+  "fusedTemperature",
+  "fusedHumidity",
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#include "statistics.hpp"
+
+void RollingWindow::add(time_t time, float value, float weight) {
+  if (std::isnan(value)) {
+    return;
+  }
+
+  const time_t bucket = time / _bucketDuration;
+
+  if (not _initialized) {
+    _initialized = true;
+    _currentBucket = bucket;
+    for (auto& b : _buckets) {
+      b = Bucket{0.0f, 0.0f, NAN, NAN};
+    }
+  }
+
+  // Clear buckets which dropped out of the window, at most all of them
+  if (bucket > _currentBucket) {
+    const auto expired = std::min<time_t>(bucket - _currentBucket, numberOfBuckets);
+    for (time_t i = 1; i <= expired; ++i) {
+      _buckets[(_currentBucket + i) % numberOfBuckets] = Bucket{0.0f, 0.0f, NAN, NAN};
+    }
+    _currentBucket = bucket;
+  } else if (bucket < _currentBucket) {
+    // Time jumped backwards, e.g. by the first time synchronization
+    return;
+  }
+
+  auto& current = _buckets[_currentBucket % numberOfBuckets];
+  current.sum += value * weight;
+  current.weight += weight;
+  current.minimum = std::isnan(current.minimum) ? value : std::min(current.minimum, value);
+  current.maximum = std::isnan(current.maximum) ? value : std::max(current.maximum, value);
+
+  update();
+}
+
+void RollingWindow::update() {
+  float sum = 0.0f;
+  float weight = 0.0f;
+  _minimum = NAN;
+  _maximum = NAN;
+
+  for (const auto& bucket : _buckets) {
+    sum += bucket.sum;
+    weight += bucket.weight;
+    if (not std::isnan(bucket.minimum)) {
+      _minimum = std::isnan(_minimum) ? bucket.minimum : std::min(_minimum, bucket.minimum);
+      _maximum = std::isnan(_maximum) ? bucket.maximum : std::max(_maximum, bucket.maximum);
+    }
+  }
+
+  _mean = (weight > 0.0f) ? (sum / weight) : NAN;
+}
+
+P2Quantile::P2Quantile(float quantile) : _quantile{quantile} {
+  _desiredPositions = {1.0f, 1.0f + 2.0f * quantile, 1.0f + 4.0f * quantile, 3.0f + 2.0f * quantile, 5.0f};
+  _increments = {0.0f, quantile / 2.0f, quantile, (1.0f + quantile) / 2.0f, 1.0f};
+  for (std::size_t i = 0; i < numberOfMarkers; ++i) {
+    _positions[i] = i + 1;
+  }
+}
+
+void P2Quantile::add(float value) {
+  if (std::isnan(value)) {
+    return;
+  }
+
+  // Collect the first samples as initial marker heights
+  if (_count < numberOfMarkers) {
+    _heights[_count++] = value;
+    if (_count == numberOfMarkers) {
+      std::sort(_heights.begin(), _heights.end());
+    }
+    return;
+  }
+  _count++;
+
+  std::size_t k;
+  if (value < _heights[0]) {
+    _heights[0] = value;
+    k = 0;
+  } else if (value >= _heights[numberOfMarkers - 1]) {
+    _heights[numberOfMarkers - 1] = value;
+    k = numberOfMarkers - 2;
+  } else {
+    k = 0;
+    while (value >= _heights[k + 1]) {
+      k++;
+    }
+  }
+
+  for (std::size_t i = k + 1; i < numberOfMarkers; ++i) {
+    _positions[i] += 1.0f;
+  }
+  for (std::size_t i = 0; i < numberOfMarkers; ++i) {
+    _desiredPositions[i] += _increments[i];
+  }
+
+  // Adjust heights of the inner markers
+  for (std::size_t i = 1; i < (numberOfMarkers - 1); ++i) {
+    const float d = _desiredPositions[i] - _positions[i];
+    if (((d >= 1.0f) and ((_positions[i + 1] - _positions[i]) > 1.0f)) or ((d <= -1.0f) and ((_positions[i - 1] - _positions[i]) < -1.0f))) {
+      const int direction = (d > 0.0f) ? 1 : -1;
+      const float height = parabolic(i, direction);
+      if ((_heights[i - 1] < height) and (height < _heights[i + 1])) {
+        _heights[i] = height;
+      } else {
+        _heights[i] = linear(i, direction);
+      }
+      _positions[i] += direction;
+    }
+  }
+}
+
+float P2Quantile::get() const {
+  if (_count == 0) {
+    return NAN;
+  }
+
+  if (_count < numberOfMarkers) {
+    auto heights = _heights;
+    std::sort(heights.begin(), heights.begin() + _count);
+    return heights[static_cast<std::size_t>(std::round((_count - 1) * _quantile))];
+  }
+
+  return _heights[2];
+}
+
+float P2Quantile::parabolic(std::size_t i, int direction) const {
+  const float d = direction;
+  return _heights[i] + d / (_positions[i + 1] - _positions[i - 1])
+    * ((_positions[i] - _positions[i - 1] + d) * (_heights[i + 1] - _heights[i]) / (_positions[i + 1] - _positions[i])
+      + (_positions[i + 1] - _positions[i] - d) * (_heights[i] - _heights[i - 1]) / (_positions[i] - _positions[i - 1]));
+}
+
+float P2Quantile::linear(std::size_t i, int direction) const {
+  return _heights[i] + direction * (_heights[i + direction] - _heights[i]) / (_positions[i + direction] - _positions[i]);
+}
+
+constexpr std::array<uint32_t, static_cast<size_t>(Statistics::Window::NumberOfWindows)> Statistics::windowDurations;
+
+void Statistics::setup(const Config& config) {
+  _co2Thresholds[0] = config.getValueAsInt("co2Threshold1").value_or(_co2Thresholds[0]);
+  _co2Thresholds[1] = config.getValueAsInt("co2Threshold2").value_or(_co2Thresholds[1]);
+  _co2Thresholds[2] = config.getValueAsInt("co2Threshold3").value_or(_co2Thresholds[2]);
+}
+
+void Statistics::add(const Measurement& measurement, uint16_t interval) {
+  // A measurement covers the time since the previous one, the SCD30 averages over its interval. After an outage
+  // (sensor fault, restart of the measurement) the value is not known for most of the gap.
+  float weight = std::max<uint16_t>(interval, 1u);
+  if ((_lastTime != 0) and (measurement.time > _lastTime)) {
+    const auto gap = measurement.time - _lastTime;
+    if (gap <= static_cast<time_t>(maximumGapIntervals * weight)) {
+      weight = gap;
+    }
+  }
+  _lastTime = measurement.time;
+
+  for (std::size_t i = 0; i < _quantities.size(); ++i) {
+    const auto value = measurement.data[i];
+    if (std::isnan(value)) {
+      continue;
+    }
+
+    auto& statistics = _quantities[i];
+
+    if (std::isnan(statistics.ewma)) {
+      statistics.ewma = value;
+    } else {
+      statistics.ewma += (value - statistics.ewma) * (1.0f - std::exp(-weight / ewmaTimeConstant));
+    }
+
+    for (auto& window : statistics.windows) {
+      window.add(measurement.time, value, weight);
+    }
+
+    statistics.median.add(value);
+    statistics.percentile95.add(value);
+  }
+
+  const auto co2 = measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)];
+  for (std::size_t i = 0; i < numberOfCo2Thresholds; ++i) {
+    if ((not std::isnan(co2)) and (co2 > _co2Thresholds[i])) {
+      _timeAboveCo2Thresholds[i] += weight;
+    }
+  }
+}
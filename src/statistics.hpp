@@ -0,0 +1,146 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "config.hpp"
+#include "quantity.hpp"
+
+/**
+ * Rolling mean, minimum and maximum over a time window.
+ *
+ * The window is split into a fixed number of buckets, so memory is bounded and each sample costs constant time. The
+ * results are granular to one bucket and reflect the state at the last sample. The mean is weighted by the time each
+ * sample covers, as samples may be irregularly spaced.
+ */
+class RollingWindow {
+public:
+  explicit RollingWindow(uint32_t duration) : _bucketDuration{duration / numberOfBuckets} {};
+
+  /**
+   * @brief Adds a sample
+   *
+   * @param[in] time time of sample
+   * @param[in] value value of sample
+   * @param[in] weight time covered by the sample in s
+   */
+  void add(time_t time, float value, float weight);
+
+  float getMean() const { return _mean; }
+  float getMinimum() const { return _minimum; }
+  float getMaximum() const { return _maximum; }
+
+private:
+  static constexpr uint32_t numberOfBuckets = 12u;
+
+  struct Bucket {
+    float sum;
+    float weight;
+    float minimum;
+    float maximum;
+  };
+
+  void update();
+
+  uint32_t _bucketDuration;
+  std::array<Bucket, numberOfBuckets> _buckets{};
+  time_t _currentBucket{0};
+  bool _initialized{false};
+
+  float _mean{NAN};
+  float _minimum{NAN};
+  float _maximum{NAN};
+};
+
+/**
+ * Streaming quantile estimation with the P² algorithm (Jain and Chlamtac, 1985).
+ *
+ * Uses five markers and constant time per sample. The estimate covers all samples since boot.
+ */
+class P2Quantile {
+public:
+  explicit P2Quantile(float quantile);
+
+  void add(float value);
+
+  /// Estimated quantile, NaN without samples
+  float get() const;
+
+  float getQuantile() const { return _quantile; }
+
+private:
+  static constexpr std::size_t numberOfMarkers = 5u;
+
+  float parabolic(std::size_t i, int direction) const;
+  float linear(std::size_t i, int direction) const;
+
+  float _quantile;
+  uint32_t _count{0};
+  std::array<float, numberOfMarkers> _heights{};
+  std::array<float, numberOfMarkers> _positions{};
+  std::array<float, numberOfMarkers> _desiredPositions{};
+  std::array<float, numberOfMarkers> _increments{};
+};
+
+/**
+ * Streaming statistics of all quantities.
+ *
+ * Updated incrementally with each new measurement, nothing is recomputed from the history.
+ */
+class Statistics {
+public:
+  enum class Window : uint8_t {
+    FiveMinutes,
+    OneHour,
+    OneDay,
+    NumberOfWindows
+  };
+
+  static constexpr std::array<uint32_t, static_cast<size_t>(Window::NumberOfWindows)> windowDurations{5u * 60u, 60u * 60u, 24u * 60u * 60u}; // s
+  static constexpr std::size_t numberOfCo2Thresholds = 3u;
+
+  struct QuantityStatistics {
+    float ewma{NAN};
+    std::array<RollingWindow, static_cast<size_t>(Window::NumberOfWindows)> windows{
+      RollingWindow{windowDurations[0]},
+      RollingWindow{windowDurations[1]},
+      RollingWindow{windowDurations[2]},
+    };
+    P2Quantile median{0.5f};
+    P2Quantile percentile95{0.95f};
+  };
+
+  void setup(const Config& config);
+
+  /**
+   * @brief Adds a new measurement
+   *
+   * @param[in] measurement new measurement
+   * @param[in] interval nominal measurement interval in s, weight of a measurement after a gap
+   */
+  void add(const Measurement& measurement, uint16_t interval);
+
+  const QuantityStatistics& get(std::size_t quantity) const { return _quantities[quantity]; }
+
+  int getCo2Threshold(std::size_t i) const { return _co2Thresholds[i]; }
+
+  /// Time CO2 was above threshold i since boot in s
+  uint32_t getTimeAboveCo2Threshold(std::size_t i) const { return _timeAboveCo2Thresholds[i]; }
+
+private:
+  /// Time constant of the EWMA
+  static constexpr float ewmaTimeConstant = 5.0f * 60.0f; // s
+  /// A gap of more measurement intervals is an outage, the measurement after it only covers one interval
+  static constexpr uint32_t maximumGapIntervals = 3u;
+
+  std::array<QuantityStatistics, static_cast<size_t>(Quantity::NumberOfQuantities)> _quantities{};
+  std::array<int, numberOfCo2Thresholds> _co2Thresholds{800, 1000, 1400};
+  std::array<uint32_t, numberOfCo2Thresholds> _timeAboveCo2Thresholds{};
+  time_t _lastTime{0};
+};
+
+#endif
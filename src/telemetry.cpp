@@ -0,0 +1,55 @@
+#include <WiFi.h>
+
+#include "telemetry.hpp"
+#include "telemetry_datagram.hpp"
+
+void Telemetry::setup() {
+  const auto group = _config.getValueAsString("telemetryGroup").value_or("");
+  _port = _config.getValueAsInt("telemetryPort").value_or(0);
+
+  _enabled = (not group.empty()) and _group.fromString(group.c_str()) and (_port != 0);
+  if (not _enabled) {
+    return;
+  }
+
+  WiFi.macAddress(_device);
+  Serial.printf("Sending telemetry to %s:%u.\r\n", group.c_str(), _port);
+}
+
+void Telemetry::loop(const Measurements& measurements, bool wifiConnected) {
+  if ((not _enabled) or (measurements.getMeasurementCounter() == _measurementCounter)) {
+    return;
+  }
+
+  // Sequence counts measurements, so skipped ones show up as lost
+  const auto skipped = measurements.getMeasurementCounter() - _measurementCounter - 1;
+  _measurementCounter = measurements.getMeasurementCounter();
+  _sequence += skipped;
+
+  if (not wifiConnected) {
+    _sequence++;
+    return;
+  }
+
+  const auto& measurement = measurements.dataLast().getMeasurement(0);
+
+  telemetryDatagram::Datagram datagram{};
+  memcpy(datagram.device, _device, sizeof(datagram.device));
+  datagram.sequence = _sequence++;
+  datagram.time = measurement.time;
+  datagram.numberOfQuantities = measurement.data.size();
+  for (std::size_t i = 0; i < measurement.data.size(); ++i) {
+    datagram.exponents[i] = quantityDecimalExponents[i];
+    datagram.values[i] = measurement.data[i];
+  }
+
+  uint8_t buffer[telemetryDatagram::maxSize];
+  const auto size = telemetryDatagram::encode(buffer, datagram);
+
+  if ((not _udp.beginPacket(_group, _port)) or (_udp.write(buffer, size) != size) or (not _udp.endPacket())) {
+    Serial.printf("Sending telemetry failed.\r\n");
+    return;
+  }
+
+  _numberOfDatagrams++;
+}
@@ -0,0 +1,48 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <cstdint>
+
+#include <IPAddress.h>
+#include <WiFiUdp.h>
+
+#include "config.hpp"
+#include "measurements.hpp"
+
+/**
+ * Multicasts every new measurement as telemetry datagram (see telemetry_datagram.hpp).
+ *
+ * Datagrams are sent without acknowledgement, a collector detects lost ones by gaps in the sequence number.
+ * Measurements taken while WiFi is disconnected are skipped, which also shows as a gap.
+ */
+class Telemetry {
+public:
+  Telemetry(const Config& config) : _config{config} {};
+
+  void setup();
+
+  /**
+   * @brief Sends new measurements
+   *
+   * @param[in] measurements measurements to send
+   * @param[in] wifiConnected WiFi connection state
+   */
+  void loop(const Measurements& measurements, bool wifiConnected);
+
+  bool isEnabled() const { return _enabled; }
+  uint32_t getNumberOfDatagrams() const { return _numberOfDatagrams; }
+
+private:
+  const Config& _config;
+  bool _enabled{false};
+  IPAddress _group{};
+  uint16_t _port{0};
+  uint8_t _device[6]{};
+
+  WiFiUDP _udp{};
+  uint32_t _measurementCounter{0};
+  uint32_t _sequence{0};
+  uint32_t _numberOfDatagrams{0};
+};
+
+#endif
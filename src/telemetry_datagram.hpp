@@ -0,0 +1,129 @@
+#ifndef TELEMETRY_DATAGRAM_HPP
+#define TELEMETRY_DATAGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "history_frame.hpp"
+
+/**
+ * Telemetry datagram, one per measurement (little-endian):
+ *
+ *   magic              4 bytes  "C2TD"
+ *   version            uint8
+ *   numberOfQuantities uint8
+ *   device             6 bytes, MAC address of the sender
+ *   sequence           uint32, incremented with every datagram, starts at 0 after boot
+ *   time               int64, seconds since epoch
+ *   quantities         numberOfQuantities times:
+ *     exponent         int8, value = raw * 10^exponent
+ *     raw              int32, historyFrame::invalidValue marks a missing value
+ *
+ * This header has no Arduino dependencies, so collectors can use it on the host.
+ */
+namespace telemetryDatagram {
+
+constexpr uint8_t magic[4] = {'C', '2', 'T', 'D'};
+constexpr uint8_t version = 1u;
+constexpr std::size_t maxNumberOfQuantities = 16u;
+constexpr std::size_t headerSize = sizeof(magic) + 2u + 6u + sizeof(uint32_t) + sizeof(int64_t);
+constexpr std::size_t quantitySize = sizeof(int8_t) + sizeof(int32_t);
+constexpr std::size_t maxSize = headerSize + maxNumberOfQuantities * quantitySize;
+
+struct Datagram {
+  uint8_t device[6];
+  uint32_t sequence;
+  int64_t time;
+  uint8_t numberOfQuantities;
+  int8_t exponents[maxNumberOfQuantities];
+  float values[maxNumberOfQuantities];
+};
+
+inline void writeLittleEndian(uint8_t* buffer, uint64_t value, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+inline uint64_t readLittleEndian(const uint8_t* buffer, std::size_t size) {
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(buffer[i]) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * @brief Encodes a datagram
+ *
+ * @param[out] buffer buffer of at least maxSize bytes
+ * @param[in] datagram datagram to encode, values are rounded to their exponent
+ * @return size of datagram in bytes, 0 if too many quantities
+ */
+inline std::size_t encode(uint8_t* buffer, const Datagram& datagram) {
+  if (datagram.numberOfQuantities > maxNumberOfQuantities) {
+    return 0;
+  }
+
+  std::size_t position = 0;
+  std::memcpy(&buffer[position], magic, sizeof(magic));
+  position += sizeof(magic);
+  buffer[position++] = version;
+  buffer[position++] = datagram.numberOfQuantities;
+  std::memcpy(&buffer[position], datagram.device, sizeof(datagram.device));
+  position += sizeof(datagram.device);
+  writeLittleEndian(&buffer[position], datagram.sequence, sizeof(uint32_t));
+  position += sizeof(uint32_t);
+  writeLittleEndian(&buffer[position], static_cast<uint64_t>(datagram.time), sizeof(int64_t));
+  position += sizeof(int64_t);
+
+  for (uint8_t i = 0; i < datagram.numberOfQuantities; ++i) {
+    buffer[position++] = static_cast<uint8_t>(datagram.exponents[i]);
+    writeLittleEndian(&buffer[position], static_cast<uint32_t>(historyFrame::toFixedPoint(datagram.values[i], datagram.exponents[i])), sizeof(int32_t));
+    position += sizeof(int32_t);
+  }
+
+  return position;
+}
+
+/**
+ * @brief Decodes a datagram
+ *
+ * @param[in] buffer received data
+ * @param[in] size size of received data
+ * @param[out] datagram decoded datagram
+ * @retval true datagram valid
+ * @retval false not a datagram, unsupported version or truncated
+ */
+inline bool decode(const uint8_t* buffer, std::size_t size, Datagram& datagram) {
+  if ((size < headerSize) or (std::memcmp(buffer, magic, sizeof(magic)) != 0) or (buffer[sizeof(magic)] != version)) {
+    return false;
+  }
+
+  std::size_t position = sizeof(magic) + 1;
+  datagram.numberOfQuantities = buffer[position++];
+  if ((datagram.numberOfQuantities > maxNumberOfQuantities) or (size < (headerSize + datagram.numberOfQuantities * quantitySize))) {
+    return false;
+  }
+
+  std::memcpy(datagram.device, &buffer[position], sizeof(datagram.device));
+  position += sizeof(datagram.device);
+  datagram.sequence = static_cast<uint32_t>(readLittleEndian(&buffer[position], sizeof(uint32_t)));
+  position += sizeof(uint32_t);
+  datagram.time = static_cast<int64_t>(readLittleEndian(&buffer[position], sizeof(int64_t)));
+  position += sizeof(int64_t);
+
+  for (uint8_t i = 0; i < datagram.numberOfQuantities; ++i) {
+    datagram.exponents[i] = static_cast<int8_t>(buffer[position++]);
+    const auto raw = static_cast<int32_t>(readLittleEndian(&buffer[position], sizeof(int32_t)));
+    datagram.values[i] = historyFrame::fromFixedPoint(raw, datagram.exponents[i]);
+    position += sizeof(int32_t);
+  }
+
+  return true;
+}
+
+}
+
+#endif
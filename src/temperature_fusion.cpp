@@ -0,0 +1,59 @@
+#include <algorithm>
+
+#include "temperature_fusion.hpp"
+
+float TemperatureFusion::saturationVapourPressure(float temperature) {
+  // Coefficients over water for -45 °C to 60 °C (Sonntag, 1990)
+  return 6.112f * std::exp((17.62f * temperature) / (243.12f + temperature));
+}
+
+void TemperatureFusion::updateOffset(time_t time, float difference) {
+  if (std::isnan(_offset)) {
+    _offset = difference;
+    _offsetVariance = scd30Variance + bmp280Variance;
+    _lastTime = time;
+    return;
+  }
+
+  // Predict
+  const float elapsed = std::clamp<float>(time - _lastTime, 0.0f, maximumSampleGap);
+  _offsetVariance += offsetDrift * elapsed;
+  _lastTime = time;
+
+  // Correct
+  const float gain = _offsetVariance / (_offsetVariance + scd30Variance + bmp280Variance);
+  _offset += gain * (difference - _offset);
+  _offsetVariance *= (1.0f - gain);
+}
+
+void TemperatureFusion::update(Measurement& measurement) {
+  const bool scd30Valid = measurement.isValid(Quantity::Scd30Temperature);
+  const bool bmp280Valid = measurement.isValid(Quantity::Bmp280Temperature);
+  const float scd30 = measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)];
+  const float bmp280 = measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Temperature)];
+
+  if (scd30Valid and bmp280Valid) {
+    updateOffset(measurement.time, scd30 - bmp280);
+  }
+
+  float temperature = NAN;
+  if (scd30Valid and bmp280Valid) {
+    const float bmp280Weight = 1.0f / bmp280Variance;
+    const float scd30Weight = 1.0f / (scd30Variance + _offsetVariance);
+    temperature = (bmp280 * bmp280Weight + (scd30 - _offset) * scd30Weight) / (bmp280Weight + scd30Weight);
+  } else if (bmp280Valid) {
+    temperature = bmp280;
+  } else if (scd30Valid) {
+    // Without a learned offset only the fixed compensation of the SCD30 is left
+    temperature = std::isnan(_offset) ? scd30 : (scd30 - _offset);
+  }
+  measurement.set(Quantity::FusedTemperature, temperature);
+
+  // Same absolute humidity at the fused temperature
+  float humidity = NAN;
+  if (scd30Valid and measurement.isValid(Quantity::Scd30Humidity) and not std::isnan(temperature)) {
+    humidity = measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)];
+    humidity = std::clamp(humidity * saturationVapourPressure(scd30) / saturationVapourPressure(temperature), 0.0f, 100.0f);
+  }
+  measurement.set(Quantity::FusedHumidity, humidity);
+}
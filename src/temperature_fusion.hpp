@@ -0,0 +1,58 @@
+#ifndef TEMPERATURE_FUSION_HPP
+#define TEMPERATURE_FUSION_HPP
+
+#include <cmath>
+#include <cstdint>
+
+#include "quantity.hpp"
+
+/**
+ * Fuses the temperatures of SCD30 and BMP280 and corrects the humidity to the fused temperature.
+ *
+ * The BMP280 is the temperature reference. The SCD30 heats itself while measuring, scd30TemperatureOffset only
+ * compensates a fixed part of that. A one-dimensional Kalman filter learns the remaining self-heating of the SCD30
+ * compared to the BMP280 as a slowly drifting random walk. The fused temperature is the inverse variance weighted mean
+ * of the BMP280 temperature and the offset corrected SCD30 temperature. The SCD30 humidity belongs to the SCD30
+ * temperature, so it is converted to the fused temperature at constant absolute humidity with the Magnus formula.
+ * State is three floats and each sample costs constant time.
+ */
+class TemperatureFusion {
+public:
+  /**
+   * @brief Adds Quantity::FusedTemperature and Quantity::FusedHumidity to a measurement
+   *
+   * @param[in,out] measurement measurement with SCD30 and BMP280 values
+   */
+  void update(Measurement& measurement);
+
+  /// Learned self-heating of the SCD30 compared to the BMP280 in °C, NaN until both were available
+  float getOffset() const { return _offset; }
+
+  /// Standard deviation of the learned offset in °C
+  float getOffsetUncertainty() const { return std::sqrt(_offsetVariance); }
+
+private:
+  /// Noise of the sensors
+  static constexpr float scd30Variance = 0.1f * 0.1f; // °C²
+  static constexpr float bmp280Variance = 0.05f * 0.05f; // °C²
+  /// Drift of the offset, e.g. when the measurement interval changes
+  static constexpr float offsetDrift = 0.1f * 0.1f / 3600.0f; // °C²/s
+  /// Samples are not considered further apart, keeps the offset from jumping after long gaps
+  static constexpr float maximumSampleGap = 1800.0f; // s
+
+  /**
+   * @brief Calculates the saturation vapour pressure over water (Magnus formula)
+   *
+   * @param[in] temperature temperature in °C
+   * @return saturation vapour pressure in hPa
+   */
+  static float saturationVapourPressure(float temperature);
+
+  void updateOffset(time_t time, float difference);
+
+  float _offset{NAN};
+  float _offsetVariance{0.0f};
+  time_t _lastTime{0};
+};
+
+#endif
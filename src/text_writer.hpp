@@ -0,0 +1,51 @@
+#ifndef TEXT_WRITER_HPP
+#define TEXT_WRITER_HPP
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+
+/**
+ * Appends formatted text to a fixed size buffer.
+ *
+ * On overflow the partially written part is dropped and all further appends are ignored.
+ */
+class TextWriter {
+public:
+  TextWriter(char* buffer, std::size_t size) : _buffer{buffer}, _size{size} {
+    if (_size > 0) {
+      _buffer[0] = '\0';
+    }
+  };
+
+  void append(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    if (_overflowed or (_length >= _size)) {
+      _overflowed = true;
+      return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    const int ret = vsnprintf(_buffer + _length, _size - _length, format, args);
+    va_end(args);
+
+    if ((ret < 0) or (static_cast<std::size_t>(ret) >= (_size - _length))) {
+      _buffer[_length] = '\0';
+      _overflowed = true;
+      return;
+    }
+
+    _length += ret;
+  }
+
+  std::size_t length() const { return _length; }
+  bool overflowed() const { return _overflowed; }
+
+private:
+  char* _buffer;
+  std::size_t _size;
+  std::size_t _length{0};
+  bool _overflowed{false};
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include <Arduino.h>
+
+#include <algorithm>
+
+#include "trace.hpp"
+#include "trace_format.hpp"
+#include "text_writer.hpp"
+
+namespace {
+
+constexpr uint8_t numberOfQuantities = static_cast<uint8_t>(Quantity::NumberOfQuantities);
+static_assert(numberOfQuantities <= traceFormat::maxNumberOfQuantities);
+
+}
+
+void Trace::setup(const Config& config) {
+  const auto mode = config.getValueAsString("traceMode").value_or("off");
+  _speedup = std::max(config.getValueAsInt("traceSpeedup").value_or(1000), 1);
+
+  if (mode == "record") {
+    startRecording();
+  } else if (mode == "replay") {
+    startReplay();
+  }
+}
+
+void Trace::startRecording() {
+  // Continue an existing trace, unless it was written by an incompatible version
+  if (SPIFFS.exists(traceFileName)) {
+    File trace = SPIFFS.open(traceFileName, "r");
+    uint8_t header[traceFormat::headerSize];
+    uint8_t quantities = 0;
+    const bool compatible = (trace.read(header, sizeof(header)) == sizeof(header)) and traceFormat::decodeHeader(header, quantities) and (quantities == numberOfQuantities);
+    trace.close();
+
+    if (not compatible) {
+      Serial.printf("Removing incompatible trace.\r\n");
+      SPIFFS.remove(traceFileName);
+    }
+  }
+
+  _trace = SPIFFS.open(traceFileName, "a");
+  if (not _trace) {
+    Serial.printf("Opening trace for recording failed.\r\n");
+    return;
+  }
+
+  if (_trace.size() == 0) {
+    uint8_t header[traceFormat::headerSize];
+    traceFormat::encodeHeader(header, numberOfQuantities);
+    _trace.write(header, sizeof(header));
+  }
+
+  Serial.printf("Recording trace, %u bytes so far.\r\n", static_cast<unsigned>(_trace.size()));
+  _mode = Mode::Record;
+}
+
+void Trace::startReplay() {
+  _trace = SPIFFS.open(traceFileName, "r");
+  if (not _trace) {
+    Serial.printf("No trace to replay.\r\n");
+    return;
+  }
+
+  uint8_t header[traceFormat::headerSize];
+  uint8_t quantities = 0;
+  if ((_trace.read(header, sizeof(header)) != sizeof(header)) or (not traceFormat::decodeHeader(header, quantities)) or (quantities != numberOfQuantities)) {
+    Serial.printf("Trace invalid.\r\n");
+    _trace.close();
+    return;
+  }
+
+  _output = SPIFFS.open(replayFileName, "w");
+  if (not _output) {
+    Serial.printf("Opening replay output failed.\r\n");
+    _trace.close();
+    return;
+  }
+
+  char line[256];
+  TextWriter writer{line, sizeof(line)};
+  writer.append("time,valid");
+  for (const auto name : quantityNames) {
+    writer.append(",raw_%s", name);
+  }
+  for (const auto name : quantityNames) {
+    writer.append(",%s", name);
+  }
+  writer.append("\n");
+  _output.write(reinterpret_cast<const uint8_t*>(line), writer.length());
+
+  Serial.printf("Replaying trace with speedup %u.\r\n", _speedup);
+  _nextPending = false;
+  _numberOfRecords = 0;
+  _mode = Mode::Replay;
+}
+
+void Trace::stop() {
+  if (_mode == Mode::Replay) {
+    Serial.printf("Replay of %u measurements finished.\r\n", _numberOfRecords);
+  }
+
+  _trace.close();
+  _output.close();
+  _mode = Mode::Off;
+}
+
+bool Trace::readRecord(Measurement& measurement) {
+  uint8_t record[traceFormat::recordSize(numberOfQuantities)];
+  if (_trace.read(record, sizeof(record)) != sizeof(record)) {
+    return false;
+  }
+
+  uint32_t time;
+  uint8_t valid;
+  traceFormat::decodeRecord(record, time, valid, measurement.data.data(), numberOfQuantities);
+  measurement.time = time;
+  measurement.valid = valid;
+
+  return true;
+}
+
+bool Trace::replay(Measurement& measurement) {
+  if (_mode != Mode::Replay) {
+    return false;
+  }
+
+  if (not _nextPending) {
+    if (not readRecord(_next)) {
+      stop();
+      return false;
+    }
+    _nextPending = true;
+  }
+
+  // Time since the previous record, accelerated by the speedup. The first record is due right away.
+  if (_numberOfRecords > 0) {
+    const int64_t gap = std::clamp<int64_t>(static_cast<int64_t>(_next.time) - _lastTime, 0, maxRecordGap);
+    const int64_t elapsed = static_cast<int64_t>(millis() - _lastMillis) * _speedup;
+    if (elapsed < (gap * 1000)) {
+      return false;
+    }
+  }
+
+  measurement = _next;
+  _nextPending = false;
+  _lastTime = _next.time;
+  _lastMillis = millis();
+  _numberOfRecords++;
+  return true;
+}
+
+void Trace::add(const Measurement& raw, const Measurement& filtered) {
+  switch (_mode) {
+    case Mode::Off:
+      break;
+
+    case Mode::Record: {
+      if (_trace.size() >= maxTraceSize) {
+        Serial.printf("Trace full, recording stopped.\r\n");
+        stop();
+        break;
+      }
+
+      uint8_t record[traceFormat::recordSize(numberOfQuantities)];
+      traceFormat::encodeRecord(record, raw.time, raw.valid, raw.data.data(), numberOfQuantities);
+      _trace.write(record, sizeof(record));
+      _trace.flush();
+      break;
+    }
+
+    case Mode::Replay: {
+      char line[256];
+      TextWriter writer{line, sizeof(line)};
+      writer.append("%ld,%u", static_cast<long>(raw.time), filtered.valid);
+      for (const auto value : raw.data) {
+        writer.append(",%.9g", value);
+      }
+      for (const auto value : filtered.data) {
+        writer.append(",%.9g", value);
+      }
+      writer.append("\n");
+      _output.write(reinterpret_cast<const uint8_t*>(line), writer.length());
+      break;
+    }
+  }
+}
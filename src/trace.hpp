@@ -0,0 +1,79 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <ctime>
+
+#include <SPIFFS.h>
+
+#include "config.hpp"
+#include "quantity.hpp"
+
+/**
+ * Records sensor readings to a trace file and replays them instead of the sensors.
+ *
+ * In record mode every raw measurement is appended to traceFileName (see trace_format.hpp). In replay mode the
+ * recorded measurements are fed back with their original time stamps, paced by the time between consecutive records
+ * accelerated by traceSpeedup, and the raw and filtered values are written to replayFileName. Comparing this file
+ * between firmware revisions shows the effect of changes to the processing.
+ */
+class Trace {
+public:
+  enum class Mode : uint8_t {
+    Off,
+    Record,
+    Replay
+  };
+
+  static constexpr const char* traceFileName = "/trace.bin";
+  static constexpr const char* replayFileName = "/replay.csv";
+
+  void setup(const Config& config);
+
+  Mode getMode() const { return _mode; }
+  bool isReplaying() const { return _mode == Mode::Replay; }
+
+  /**
+   * @brief Gets the next recorded measurement once it is due
+   *
+   * Switches mode to Off when the trace is exhausted.
+   *
+   * @param[out] measurement recorded measurement
+   * @retval true measurement due
+   * @retval false no measurement due
+   */
+  bool replay(Measurement& measurement);
+
+  /**
+   * @brief Records a measurement or writes the output of a replay
+   *
+   * @param[in] raw measurement as read from the sensors or the trace
+   * @param[in] filtered measurement as stored
+   */
+  void add(const Measurement& raw, const Measurement& filtered);
+
+private:
+  /// Recording stops at this size to leave space for the configuration
+  static constexpr size_t maxTraceSize = 512u * 1024u;
+  /// Longer gaps between records (outages, the jump of the clock at NTP synchronization) are replayed as this
+  static constexpr uint32_t maxRecordGap = 60u; // s
+
+  void startRecording();
+  void startReplay();
+  void stop();
+  bool readRecord(Measurement& measurement);
+
+  Mode _mode{Mode::Off};
+  uint32_t _speedup{1};
+
+  File _trace{};
+  File _output{};
+
+  Measurement _next{};
+  bool _nextPending{false};
+  time_t _lastTime{0};
+  unsigned long _lastMillis{0};
+  uint32_t _numberOfRecords{0};
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef TRACE_FORMAT_HPP
+#define TRACE_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Sensor trace file (little-endian):
+ *
+ *   magic              4 bytes  "C2TR"
+ *   version            uint8
+ *   numberOfQuantities uint8
+ *   records            until end of file:
+ *     time             uint32, seconds since epoch
+ *     valid            uint8, bit per quantity
+ *     values           float per quantity, bit exact as read from the sensors
+ *
+ * Records have a fixed size, so a truncated file loses at most its last record.
+ * This header has no Arduino dependencies, so traces can be decoded on the host.
+ */
+namespace traceFormat {
+
+constexpr uint8_t magic[4] = {'C', '2', 'T', 'R'};
+constexpr uint8_t version = 1u;
+constexpr std::size_t headerSize = sizeof(magic) + 2u;
+constexpr std::size_t maxNumberOfQuantities = 8u;
+
+constexpr std::size_t recordSize(uint8_t numberOfQuantities) {
+  return sizeof(uint32_t) + sizeof(uint8_t) + numberOfQuantities * sizeof(float);
+}
+
+inline void writeUint32(uint8_t* buffer, uint32_t value) {
+  for (std::size_t i = 0; i < sizeof(value); ++i) {
+    buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+inline uint32_t readUint32(const uint8_t* buffer) {
+  uint32_t value = 0;
+  for (std::size_t i = 0; i < sizeof(value); ++i) {
+    value |= static_cast<uint32_t>(buffer[i]) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * @brief Encodes the file header
+ *
+ * @param[out] buffer buffer of headerSize bytes
+ * @param[in] numberOfQuantities number of quantities per record
+ */
+inline void encodeHeader(uint8_t* buffer, uint8_t numberOfQuantities) {
+  std::memcpy(buffer, magic, sizeof(magic));
+  buffer[sizeof(magic)] = version;
+  buffer[sizeof(magic) + 1] = numberOfQuantities;
+}
+
+/**
+ * @brief Decodes and checks the file header
+ *
+ * @param[in] buffer buffer of headerSize bytes
+ * @param[out] numberOfQuantities number of quantities per record
+ * @retval true header valid
+ * @retval false header invalid or unsupported version
+ */
+inline bool decodeHeader(const uint8_t* buffer, uint8_t& numberOfQuantities) {
+  if ((std::memcmp(buffer, magic, sizeof(magic)) != 0) or (buffer[sizeof(magic)] != version)) {
+    return false;
+  }
+
+  numberOfQuantities = buffer[sizeof(magic) + 1];
+  return numberOfQuantities <= maxNumberOfQuantities;
+}
+
+/**
+ * @brief Encodes a record
+ *
+ * @param[out] buffer buffer of recordSize() bytes
+ * @param[in] time time of sample
+ * @param[in] valid validity bit per quantity
+ * @param[in] values values of sample
+ * @param[in] numberOfQuantities number of values
+ */
+inline void encodeRecord(uint8_t* buffer, uint32_t time, uint8_t valid, const float* values, uint8_t numberOfQuantities) {
+  writeUint32(buffer, time);
+  buffer[sizeof(uint32_t)] = valid;
+  for (uint8_t i = 0; i < numberOfQuantities; ++i) {
+    uint32_t raw;
+    std::memcpy(&raw, &values[i], sizeof(raw));
+    writeUint32(&buffer[sizeof(uint32_t) + sizeof(uint8_t) + i * sizeof(float)], raw);
+  }
+}
+
+/**
+ * @brief Decodes a record
+ *
+ * @param[in] buffer buffer of recordSize() bytes
+ * @param[out] time time of sample
+ * @param[out] valid validity bit per quantity
+ * @param[out] values values of sample, must hold numberOfQuantities entries
+ * @param[in] numberOfQuantities number of values
+ */
+inline void decodeRecord(const uint8_t* buffer, uint32_t& time, uint8_t& valid, float* values, uint8_t numberOfQuantities) {
+  time = readUint32(buffer);
+  valid = buffer[sizeof(uint32_t)];
+  for (uint8_t i = 0; i < numberOfQuantities; ++i) {
+    const uint32_t raw = readUint32(&buffer[sizeof(uint32_t) + sizeof(uint8_t) + i * sizeof(float)]);
+    std::memcpy(&values[i], &raw, sizeof(raw));
+  }
+}
+
+}
+
+#endif
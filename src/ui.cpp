@@ -4,6 +4,7 @@
 
 #include "ui.hpp"
 #include "pins.hpp"
+#include "instrumentation.hpp"
 
 Ui::Ui(Config& config, const RestartCallback& restartCallback) :
    _display{displayWidth, displayHeight, pins::OledMosi, pins::OledClk, pins::OledDc, pins::OledReset, pins::OledCs},
@@ -31,8 +32,10 @@ void Ui::setup(const Measurements* measurements, Network *network) {
 }
 
 void Ui::loop() {
+  INSTRUMENTATION_TIMER(UiLoop);
+
   // Only do something every 50 ms
-  if ((millis() < _lastUpdate) or ((millis() - _lastUpdate) < 50)) {
+  if ((millis() < _lastUpdate) or ((millis() - _lastUpdate) < updateInterval)) {
     return;
   }
   _lastUpdate = millis();
@@ -76,10 +79,26 @@ void Ui::loop() {
     std::fill(buttonEvent.begin(), buttonEvent.end(), false);
   }
 
+  if (not _error.empty()) {
+    if (buttonEvent[3]) {
+      _restartCallback();
+    } else if (buttonEvent[2]) {
+      _error.clear();
+    } else {
+      drawError();
+      return;
+    }
+  }
+
   _display.clearDisplay();
   _display.setTextColor(SSD1306_WHITE);
   _display.setRotation(2);
 
+#ifdef INSTRUMENTATION
+  // The screen drawn now, button events below only select the next one
+  const bool sampleShown = showsLatestSample(_screen);
+#endif
+
   switch (_screen) {
     case Screen::Co2Current: {
       drawStatusbar("Co2");
@@ -128,45 +147,50 @@ void Ui::loop() {
       _display.setCursor(0, 16);
       _display.setTextSize(1);
       _display.printf("Co2         %5.0f ppm\n", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)]);
-      _display.printf("Temperature %5.1f \xF9" "C \n", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Temperature)]);
-      _display.printf("Humidity     %4.1f %%  \n", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Humidity)]);
+      _display.printf("Temperature %5.1f \xF9" "C \n", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::FusedTemperature)]);
+      _display.printf("Humidity     %4.1f %%  \n", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::FusedHumidity)]);
       _display.printf("Pressure   %5.0f mBar\n", measurement.data[static_cast<std::underlying_type_t<Quantity>>(Quantity::Bmp280Pressure)]);
 
       break;
     }
 
     case Screen::Co2History: {
-      drawStatusbar("Co2: 25 minutes"); // 15s * 100 = 25 min
-      drawNavigation("\x1B", "", "", "\x1A");
-
-      drawDiagramm(_measurements->dataLast(), 11, Quantity::Scd30Co2);
-
+      drawHistory("Co2", Quantity::Scd30Co2);
       break;
     }
 
     case Screen::TemperatureHistory: {
-      drawStatusbar("Temperature: 25 minutes"); // 15s * 100 = 25 min
-      drawNavigation("\x1B", "", "", "\x1A");
-
-      drawDiagramm(_measurements->dataLast(), 11, Quantity::Scd30Temperature);
-
+      drawHistory("Temp", Quantity::FusedTemperature);
       break;
     }
 
     case Screen::HumidityHistory: {
-      drawStatusbar("Humidity: 25 minutes"); // 15s * 100 = 25 min
-      drawNavigation("\x1B", "", "", "\x1A");
-
-      drawDiagramm(_measurements->dataLast(), 11, Quantity::Scd30Humidity);
-
+      drawHistory("Humidity", Quantity::FusedHumidity);
       break;
     }
 
     case Screen::PressureHistory: {
-      drawStatusbar("Pressure: 25 minutes"); // 15s * 100 = 25 min
+      drawHistory("Pressure", Quantity::Bmp280Pressure);
+      break;
+    }
+
+    case Screen::Co2Statistics: {
+      drawStatusbar("Co2 Statistics");
       drawNavigation("\x1B", "", "", "\x1A");
 
-      drawDiagramm(_measurements->dataLast(), 11, Quantity::Bmp280Pressure);
+      _display.setCursor(0, 16);
+      _display.setTextSize(1);
+      _display.setTextColor(SSD1306_WHITE);
+
+      const auto& statistics = _measurements->statistics();
+      const auto& co2 = statistics.get(static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2));
+      const auto& hour = co2.windows[static_cast<std::underlying_type_t<Statistics::Window>>(Statistics::Window::OneHour)];
+
+      _display.printf("Avg 5min   %5.0f ppm\n", co2.ewma);
+      _display.printf("1h %5.0f %5.0f %5.0f\n", hour.getMinimum(), hour.getMean(), hour.getMaximum());
+      _display.printf("P50/P95 %5.0f %5.0f\n", co2.median.get(), co2.percentile95.get());
+      _display.printf(">%-4i  >%-4i  >%-4i\n", statistics.getCo2Threshold(0), statistics.getCo2Threshold(1), statistics.getCo2Threshold(2));
+      _display.printf("%4u   %4u   %4u min\n", statistics.getTimeAboveCo2Threshold(0) / 60, statistics.getTimeAboveCo2Threshold(1) / 60, statistics.getTimeAboveCo2Threshold(2) / 60);
 
       break;
     }
@@ -203,6 +227,28 @@ void Ui::loop() {
       break;
     }
 
+#ifdef INSTRUMENTATION
+    case Screen::Diagnostics: {
+      drawStatusbar("Diagnostics");
+      drawNavigation("\x1B", "", "", "\x1A");
+      _display.setCursor(0, 16);
+      _display.setTextSize(1);
+      _display.setTextColor(SSD1306_WHITE);
+
+      // Mean and maximum duration in µs
+      const auto& network = instrumentation::getTimer(instrumentation::Timer::NetworkLoop);
+      const auto& ui = instrumentation::getTimer(instrumentation::Timer::UiLoop);
+      const auto& measurements = instrumentation::getTimer(instrumentation::Timer::MeasurementsLoop);
+      _display.printf("Net  %6u %7u\n", network.getMean(), network.getMaximum());
+      _display.printf("UI   %6u %7u\n", ui.getMean(), ui.getMaximum());
+      _display.printf("Meas %6u %7u\n", measurements.getMean(), measurements.getMaximum());
+
+      const auto scd30 = instrumentation::getScd30Total();
+      _display.printf("I2C err %u/%u\n", scd30.failures, scd30.transfers);
+      break;
+    }
+#endif
+
     default:
       break;
   }
@@ -214,6 +260,30 @@ void Ui::loop() {
   }
 
   _display.display();
+#ifdef INSTRUMENTATION
+  if (sampleShown) {
+    INSTRUMENTATION_SAMPLE(Displayed);
+  }
+#endif
+}
+
+bool Ui::showsLatestSample(Screen screen) {
+  switch (screen) {
+    case Screen::Time:
+    case Screen::Version:
+#ifdef INSTRUMENTATION
+    case Screen::Diagnostics:
+#endif
+      return false;
+
+    default:
+      return true;
+  }
+}
+
+uint32_t Ui::getMillisUntilNextUpdate() const {
+  const unsigned long elapsed = millis() - _lastUpdate;
+  return (elapsed < updateInterval) ? (updateInterval - elapsed) : 0;
 }
 
 void Ui::drawNavigation(const char* text1, const char* text2, const char* text3, const char* text4) {
@@ -301,6 +371,28 @@ void Ui::drawStatusbar(const char* title) {
   }
 }
 
+void Ui::drawHistory(const char* name, Quantity quantity) {
+  // Samples may be irregularly spaced, so show the time actually covered
+  const auto& data = _measurements->dataLast();
+  const auto numberOfStoredMeasurements = data.getNumberOfStoredMeasurements();
+  const time_t span = (numberOfStoredMeasurements > 1) ? (data.getMeasurement(0).time - data.getMeasurement(numberOfStoredMeasurements - 1).time) : 0;
+
+  // Names are at most 8 characters, so realistic spans fit the 19 characters of the status bar, e.g. "Humidity: 119 min"
+  char title[40];
+  if (span >= 2 * 24 * 60 * 60) {
+    snprintf(title, sizeof(title), "%s: %ld days", name, static_cast<long>(span / (24 * 60 * 60)));
+  } else if (span >= 2 * 60 * 60) {
+    snprintf(title, sizeof(title), "%s: %ld hours", name, static_cast<long>(span / (60 * 60)));
+  } else {
+    snprintf(title, sizeof(title), "%s: %ld min", name, static_cast<long>(span / 60));
+  }
+
+  drawStatusbar(title);
+  drawNavigation("\x1B", "", "", "\x1A");
+
+  drawDiagramm(data, 11, quantity);
+}
+
 void Ui::drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantity) {
   // Diagram
   const int16_t height = 41;
@@ -317,10 +409,12 @@ void Ui::drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantit
       maximum = 2000;
       break;
     case Quantity::Scd30Temperature:
+    case Quantity::FusedTemperature:
       minimum = 0;
       maximum = 40;
       break;
     case Quantity::Scd30Humidity:
+    case Quantity::FusedHumidity:
       minimum = 0;
       maximum = 100;
       break;
@@ -340,8 +434,8 @@ void Ui::drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantit
   // Show maximum label
   _display.drawLine(x - 1, y, x, y, SSD1306_WHITE);
   {
-    char* label;
-    asprintf(&label, "%i", maximum);
+    char label[12];
+    snprintf(label, sizeof(label), "%i", maximum);
 
     int16_t x1, y1;
     uint16_t w, h;
@@ -349,15 +443,13 @@ void Ui::drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantit
     _display.getTextBounds(label, 0, 0, &x1, &y1, &w, &h);
     _display.setCursor(x - 1 - w, y);
     _display.printf(label);
-
-    free(label);
   }
 
   // Show middle label
   _display.drawLine(x - 1, y + (height - 1) / 2, x, y + (height - 1) / 2, SSD1306_WHITE);
   {
-    char* label;
-    asprintf(&label, "%i", (maximum - minimum) / 2 + minimum);
+    char label[12];
+    snprintf(label, sizeof(label), "%i", (maximum - minimum) / 2 + minimum);
 
     int16_t x1, y1;
     uint16_t w, h;
@@ -365,15 +457,13 @@ void Ui::drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantit
     _display.getTextBounds(label, 0, 0, &x1, &y1, &w, &h);
     _display.setCursor(x - 1 - w, y + (height - 1) / 2 - h / 2);
     _display.printf(label);
-
-    free(label);
   }
 
   // Show minimum label
   _display.drawLine(x - 1, y + (height - 1), x, y + (height - 1), SSD1306_WHITE);
   {
-    char* label;
-    asprintf(&label, "%i", minimum);
+    char label[12];
+    snprintf(label, sizeof(label), "%i", minimum);
 
     int16_t x1, y1;
     uint16_t w, h;
@@ -381,19 +471,33 @@ void Ui::drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantit
     _display.getTextBounds(label, 0, 0, &x1, &y1, &w, &h);
     _display.setCursor(x - 1 - w, y + (height) - h);
     _display.printf(label);
+  }
 
-    free(label);
+  // Place samples by their time, the newest at the right border
+  const auto numberOfStoredMeasurements = data.getNumberOfStoredMeasurements();
+  if (numberOfStoredMeasurements == 0) {
+    return;
   }
 
-  for (size_t i = 0; i < width; ++i) {
-    const int16_t co2 = round(((data.getMeasurement(i).data[static_cast<std::underlying_type_t<Quantity>>(quantity)]) - minimum) * (height - 1) / (maximum - minimum));
-    if ((co2 >= 0) and (co2 <= (height - 1))) {
-      _display.drawPixel(x + width - i, y + (height - 1) - co2, SSD1306_WHITE);
+  const time_t newest = data.getMeasurement(0).time;
+  const time_t span = newest - data.getMeasurement(numberOfStoredMeasurements - 1).time;
+
+  for (size_t i = 0; i < numberOfStoredMeasurements; ++i) {
+    const auto& measurement = data.getMeasurement(i);
+    const int16_t offset = (span > 0) ? round(static_cast<float>(newest - measurement.time) * (width - 1) / span) : i;
+    const int16_t co2 = round(((measurement.data[static_cast<std::underlying_type_t<Quantity>>(quantity)]) - minimum) * (height - 1) / (maximum - minimum));
+    if ((co2 >= 0) and (co2 <= (height - 1)) and (offset >= 0) and (offset < width)) {
+      _display.drawPixel(x + width - offset, y + (height - 1) - co2, SSD1306_WHITE);
     }
   }
 }
 
 void Ui::showError(const std::string& text) {
+  _error = text;
+  drawError();
+}
+
+void Ui::drawError() {
   _display.clearDisplay();
   {
     const char* label = "Error";
@@ -402,6 +506,7 @@ void Ui::showError(const std::string& text) {
     uint16_t w, h;
 
     _display.setTextSize(2);
+    _display.setTextColor(SSD1306_WHITE);
     _display.getTextBounds(label, 0, 0, &x1, &y1, &w, &h);
     _display.setCursor(63 - w / 2, 0);
     _display.printf(label);
@@ -409,17 +514,9 @@ void Ui::showError(const std::string& text) {
 
   _display.setTextSize(1);
   _display.setCursor(0, 16);
-  _display.printf(text.c_str());
+  _display.printf(_error.c_str());
 
-  _display.setCursor(95, 56);
-  _display.printf("Reset");
+  drawNavigation(nullptr, nullptr, "Ok", "Reset");
 
   _display.display();
-
-  while (true) {
-    if (digitalRead(pins::Button4) == false) {
-      _restartCallback();
-    }
-    delay(10);
-  }
 }
@@ -3,6 +3,7 @@
 
 #include <ctime>
 #include <functional>
+#include <string>
 
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
@@ -20,8 +21,20 @@ public:
   void setup(const Measurements* measurements, Network *network);
   void loop();
 
+  /**
+   * @brief Shows an error until it is dismissed
+   *
+   * Does not block, measurements and network keep running in the background.
+   *
+   * @param[in] text error description
+   */
   void showError(const std::string& text);
 
+  bool isSleeping() const { return _sleeping; }
+
+  /// Time until the next UI update is due
+  uint32_t getMillisUntilNextUpdate() const;
+
 private:
   enum class Screen : uint8_t {
     Co2Current,
@@ -30,17 +43,27 @@ private:
     HumidityHistory,
     PressureHistory,
     CurrentMeasurements,
+    Co2Statistics,
     Time,
     Version,
+#ifdef INSTRUMENTATION
+    Diagnostics,
+#endif
     NumberOfScreens
   };
 
   static constexpr uint8_t displayWidth{128};
   static constexpr uint8_t displayHeight{64};
+  static constexpr unsigned long updateInterval{50}; // ms
 
   void drawStatusbar(const char* title);
   void drawNavigation(const char* text1 = nullptr, const char* text2 = nullptr, const char* text3 = nullptr, const char* text4 = nullptr);
+  void drawHistory(const char* name, Quantity quantity);
   void drawDiagramm(const TimeDataInterface& data, int16_t y, Quantity quantity);
+  void drawError();
+
+  /// Whether the screen shows values of the latest measurement
+  static bool showsLatestSample(Screen screen);
 
   Adafruit_SSD1306 _display;
   const Measurements* _measurements{};
@@ -49,6 +72,7 @@ private:
   Config& _config;
   RestartCallback _restartCallback;
   Screen _screen{};
+  std::string _error{};
 
   std::array<bool, 4u> _lastButtonStates{};
   unsigned long _lastUpdate{};
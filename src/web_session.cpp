@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <mbedtls/base64.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "web_session.hpp"
+
+namespace {
+
+constexpr std::size_t macSize = 32u;
+constexpr const char* basicPrefix = "Basic ";
+
+/// Compares the full expected length, independent of the position of the first difference
+bool constantTimeEquals(const char* value, std::size_t valueLength, const char* expected, std::size_t expectedLength) {
+  uint8_t difference = (valueLength != expectedLength) ? 1 : 0;
+  for (std::size_t i = 0; i < expectedLength; ++i) {
+    difference |= ((i < valueLength) ? value[i] : 0) ^ expected[i];
+  }
+  return difference == 0;
+}
+
+void toHex(const uint8_t* data, std::size_t size, char* hex) {
+  constexpr const char digits[] = "0123456789abcdef";
+  for (std::size_t i = 0; i < size; ++i) {
+    hex[2 * i] = digits[data[i] >> 4];
+    hex[2 * i + 1] = digits[data[i] & 0x0Fu];
+  }
+}
+
+bool fromHex(const char* hex, std::size_t size, uint32_t& value) {
+  value = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    const char c = hex[i];
+    uint8_t digit;
+    if ((c >= '0') and (c <= '9')) {
+      digit = c - '0';
+    } else if ((c >= 'a') and (c <= 'f')) {
+      digit = c - 'a' + 10;
+    } else {
+      return false;
+    }
+    value = (value << 4) | digit;
+  }
+  return true;
+}
+
+}
+
+WebSession::~WebSession() {
+  if (_hmacReady) {
+    mbedtls_md_free(&_hmac);
+  }
+}
+
+void WebSession::setup(const Config& config) {
+  _enabled = config.getValueAsBool("webAuthentification").value_or(false);
+  if (not _enabled) {
+    return;
+  }
+
+  // Expected header is built once, requests are compared against it without decoding
+  char credentials[maxAuthorizationLength];
+  const int credentialsLength = snprintf(credentials, sizeof(credentials), "%s:%s",
+    config.getValueAsString("webUserName").value_or("").c_str(), config.getValueAsString("webPassword").value_or("").c_str());
+
+  const std::size_t prefixLength = strlen(basicPrefix);
+  memcpy(_authorization, basicPrefix, prefixLength);
+  std::size_t encodedLength = 0;
+  if ((credentialsLength < 0) or (static_cast<std::size_t>(credentialsLength) >= sizeof(credentials)) or
+    (mbedtls_base64_encode(reinterpret_cast<unsigned char*>(&_authorization[prefixLength]), sizeof(_authorization) - prefixLength,
+      &encodedLength, reinterpret_cast<const unsigned char*>(credentials), credentialsLength) != 0)) {
+    Serial.printf("Web credentials too long.\r\n");
+    _authorizationLength = 0;
+  } else {
+    _authorizationLength = prefixLength + encodedLength;
+  }
+  memset(credentials, 0, sizeof(credentials));
+
+  uint8_t key[keySize];
+  for (std::size_t i = 0; i < keySize; i += sizeof(uint32_t)) {
+    const uint32_t random = esp_random();
+    memcpy(&key[i], &random, sizeof(random));
+  }
+
+  // Key is absorbed once, each signature only resets the inner state
+  mbedtls_md_init(&_hmac);
+  _hmacReady = (mbedtls_md_setup(&_hmac, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) == 0) and
+    (mbedtls_md_hmac_starts(&_hmac, key, sizeof(key)) == 0);
+  memset(key, 0, sizeof(key));
+
+  if (not _hmacReady) {
+    Serial.printf("Session key setup failed.\r\n");
+  }
+}
+
+uint32_t WebSession::uptime() {
+  return esp_timer_get_time() / 1000000;
+}
+
+void WebSession::sign(uint32_t expiry, uint8_t* mac) {
+  const uint8_t data[] = {
+    static_cast<uint8_t>(expiry >> 24), static_cast<uint8_t>(expiry >> 16), static_cast<uint8_t>(expiry >> 8), static_cast<uint8_t>(expiry)
+  };
+  mbedtls_md_hmac_reset(&_hmac);
+  mbedtls_md_hmac_update(&_hmac, data, sizeof(data));
+  mbedtls_md_hmac_finish(&_hmac, mac);
+}
+
+void WebSession::createToken(char* token) {
+  const uint32_t expiry = uptime() + sessionLifetime;
+  uint8_t mac[macSize];
+  sign(expiry, mac);
+
+  snprintf(token, 9, "%08x", expiry);
+  toHex(mac, sizeof(mac), &token[8]);
+  token[tokenLength] = '\0';
+}
+
+bool WebSession::verifyCookie(const char* cookie) {
+  if (not _hmacReady) {
+    return false;
+  }
+
+  // Find "session=" at the start or after "; "
+  const std::size_t nameLength = strlen(cookieName);
+  const char* value = nullptr;
+  for (const char* position = strstr(cookie, cookieName); position; position = strstr(position + 1, cookieName)) {
+    if (((position == cookie) or (position[-1] == ' ') or (position[-1] == ';')) and (position[nameLength] == '=')) {
+      value = position + nameLength + 1;
+      break;
+    }
+  }
+
+  if ((value == nullptr) or (strnlen(value, tokenLength) < tokenLength)) {
+    return false;
+  }
+
+  uint32_t expiry;
+  if ((not fromHex(value, 8, expiry)) or (static_cast<int32_t>(expiry - uptime()) <= 0) or ((expiry - uptime()) > sessionLifetime)) {
+    return false;
+  }
+
+  uint8_t mac[macSize];
+  char expected[2 * macSize];
+  sign(expiry, mac);
+  toHex(mac, sizeof(mac), expected);
+
+  return constantTimeEquals(&value[8], sizeof(expected), expected, sizeof(expected));
+}
+
+bool WebSession::verifyBasicAuthorization(const char* authorization) const {
+  if (_authorizationLength == 0) {
+    return false;
+  }
+
+  return constantTimeEquals(authorization, strnlen(authorization, maxAuthorizationLength), _authorization, _authorizationLength);
+}
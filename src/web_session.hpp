@@ -0,0 +1,81 @@
+#ifndef WEB_SESSION_HPP
+#define WEB_SESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mbedtls/md.h>
+
+#include "config.hpp"
+
+/**
+ * Authentication of web requests with HTTP Basic auth and session cookies.
+ *
+ * Credentials are read from the configuration once in setup() and kept as the expected Authorization header, so the
+ * checks neither copy nor decode the header values they get. Getting these values still allocates: WebServer::header()
+ * returns a heap allocated String copy, so callers should look up each header once per request. A successful Basic
+ * auth issues a session cookie "<expiry><HMAC-SHA256 of expiry>", the expiry as 8 hex digits directly followed by the
+ * HMAC as 64 hex digits, signed with a random key created at boot. Dashboards polling several endpoints then only need
+ * one Basic auth per sessionLifetime. Sessions end with a reboot, which also applies changed credentials.
+ *
+ * All comparisons take the same time regardless of where the first mismatch is.
+ */
+class WebSession {
+public:
+  static constexpr const char* cookieName = "session";
+
+  /// Sessions expire after this time, a new one is issued with the next Basic auth
+  static constexpr uint32_t sessionLifetime{900}; // s
+
+  /// Length of the cookie value, expiry and HMAC as hex
+  static constexpr std::size_t tokenLength{8 + 2 * 32};
+
+  ~WebSession();
+
+  void setup(const Config& config);
+
+  bool isEnabled() const { return _enabled; }
+
+  /**
+   * @brief Checks the session cookie of a request
+   *
+   * @param[in] cookie value of Cookie header, may contain other cookies
+   * @retval true session valid and not expired
+   * @retval false no or invalid session
+   */
+  bool verifyCookie(const char* cookie);
+
+  /**
+   * @brief Checks the credentials of a request
+   *
+   * @param[in] authorization value of Authorization header
+   * @retval true credentials valid
+   * @retval false credentials missing or invalid
+   */
+  bool verifyBasicAuthorization(const char* authorization) const;
+
+  /**
+   * @brief Creates a new session token
+   *
+   * @param[out] token buffer of tokenLength + 1 bytes, null terminated on return
+   */
+  void createToken(char* token);
+
+private:
+  static constexpr std::size_t keySize{32};
+  static constexpr std::size_t maxAuthorizationLength{128};
+
+  static uint32_t uptime();
+
+  void sign(uint32_t expiry, uint8_t* mac);
+
+  bool _enabled{false};
+  bool _hmacReady{false};
+  mbedtls_md_context_t _hmac{};
+
+  /// "Basic base64(user:password)"
+  char _authorization[maxAuthorizationLength]{};
+  std::size_t _authorizationLength{0};
+};
+
+#endif
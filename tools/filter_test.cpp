@@ -0,0 +1,307 @@
+/**
+ * @file filter_test.cpp
+ *
+ * Host side test of src/filter.hpp. Feeds spike, step and NaN sequences through the Hampel filter and checks the
+ * output, and checks the range guard of MeasurementFilter. Sensor traces in the format of /api/trace.bin are replayed
+ * through MeasurementFilter like Measurements does: an embedded one with known outliers, and any recorded on a device
+ * that are passed as arguments. Filtered values of a recorded trace have to be the raw value or lie within the filter
+ * window, and invalid values have to stay invalid.
+ *
+ * Build: g++ -std=c++17 -I../src -I<ArduinoJson/src> -o filter_test filter_test.cpp ../src/filter.cpp
+ * Usage: ./filter_test [trace.bin]..., exits with 1 if a check failed
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "filter.hpp"
+#include "trace_format.hpp"
+
+// MeasurementFilter::setup reads the configuration, the defaults are tested without it
+std::optional<std::string> Config::getValueAsString(const char*) const { return std::nullopt; }
+std::optional<int> Config::getValueAsInt(const char*) const { return std::nullopt; }
+
+namespace {
+
+unsigned failures = 0;
+
+void check(bool condition, const char* description) {
+  if (not condition) {
+    std::fprintf(stderr, "FAILED: %s\n", description);
+    failures++;
+  }
+}
+
+constexpr float threshold = 3.0f;
+constexpr float minimumDeviation = 30.0f;
+
+std::vector<float> run(HampelFilter& filter, const std::vector<float>& values, HampelFilter::Mode mode = HampelFilter::Mode::Hampel) {
+  std::vector<float> output;
+  for (const auto value : values) {
+    output.push_back(filter.filter(value, mode, threshold, minimumDeviation));
+  }
+  return output;
+}
+
+void testSpike() {
+  HampelFilter filter;
+  const std::vector<float> input{800, 805, 798, 802, 5000, 801, 799};
+  const auto output = run(filter, input);
+
+  check(output[4] == 802.0f, "spike is replaced by the median of the window");
+  check(filter.getNumberOfReplacedValues() == 1, "spike is counted as replaced");
+  bool unchanged = true;
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    unchanged = unchanged and ((i == 4) or (output[i] == input[i]));
+  }
+  check(unchanged, "values around the spike pass unchanged");
+}
+
+void testStep() {
+  HampelFilter filter;
+  const auto output = run(filter, {800, 800, 800, 800, 800, 1200, 1200, 1200, 1200, 1200});
+
+  check((output[5] == 800.0f) and (output[6] == 800.0f), "first values after a step are held at the old level");
+  check((output[7] == 1200.0f) and (output[8] == 1200.0f) and (output[9] == 1200.0f), "step passes once it is the median");
+  check(filter.getNumberOfReplacedValues() == 2, "held values are counted as replaced");
+}
+
+void testNoise() {
+  HampelFilter filter;
+  const std::vector<float> input{800, 820, 790, 815, 795, 825, 785};
+  const auto output = run(filter, input);
+
+  check(output == input, "noise within the minimum deviation passes unchanged");
+  check(filter.getNumberOfReplacedValues() == 0, "noise is not counted as replaced");
+}
+
+void testNan() {
+  HampelFilter filter;
+  const auto output = run(filter, {NAN, 800, 800, NAN, 800, 5000, NAN});
+
+  check(std::isnan(output[0]) and std::isnan(output[3]) and std::isnan(output[6]), "NaN passes unchanged");
+  check(output[1] == 800.0f, "first value passes while the window is filling");
+  check(output[5] == 800.0f, "spike after NaN is replaced, NaN is not part of the window");
+}
+
+void testMedian() {
+  HampelFilter filter;
+  const auto output = run(filter, {800, 900, 700, 1000, 810}, HampelFilter::Mode::Median);
+
+  check((output[0] == 800.0f) and (output[1] == 900.0f), "median mode passes values while the window is filling");
+  check(output[2] == 800.0f, "median of three values");
+  check(output[3] == 850.0f, "median of four values");
+  check(output[4] == 810.0f, "median of five values");
+}
+
+void testModeNone() {
+  HampelFilter filter;
+  const std::vector<float> input{800, 800, 800, 5000};
+  check(run(filter, input, HampelFilter::Mode::None) == input, "mode none passes all values");
+}
+
+void testRange() {
+  MeasurementFilter filter;
+  Measurement measurement{};
+  measurement.clear();
+  measurement.set(Quantity::Scd30Co2, 50000.0f);
+  measurement.set(Quantity::Scd30Humidity, 45.0f);
+
+  const auto rejected = filter.filter(measurement);
+
+  check(rejected == (1u << static_cast<std::underlying_type_t<Quantity>>(Quantity::Scd30Co2)), "only CO2 outside of the sensor range is rejected");
+  check(not measurement.isValid(Quantity::Scd30Co2), "rejected value is marked invalid");
+  check(measurement.isValid(Quantity::Scd30Humidity) and (measurement.data[2] == 45.0f), "value in range passes");
+  check(filter.getNumberOfRejectedValues(Quantity::Scd30Co2) == 1, "rejection is counted");
+  check(MeasurementFilter::getMaximum(Quantity::Scd30Co2) == 40000.0f, "range of CO2");
+}
+
+constexpr std::size_t numberOfSensorQuantities = static_cast<std::size_t>(Quantity::FusedTemperature);
+
+float value(const Measurement& measurement, Quantity quantity) {
+  return measurement.data[static_cast<std::underlying_type_t<Quantity>>(quantity)];
+}
+
+/**
+ * @brief Replays a trace through MeasurementFilter and checks the filtered values against the raw ones
+ *
+ * @param[in] data trace file
+ * @param[in] name name for messages
+ * @param[out] filter filter after the replay
+ * @return filtered measurements, empty if the trace is invalid
+ */
+std::vector<Measurement> replayTrace(const std::vector<uint8_t>& data, const char* name, MeasurementFilter& filter) {
+  uint8_t numberOfQuantities;
+  if ((data.size() < traceFormat::headerSize) or (not traceFormat::decodeHeader(data.data(), numberOfQuantities))) {
+    std::fprintf(stderr, "%s: invalid trace header.\n", name);
+    failures++;
+    return {};
+  }
+
+  // Last raw values within the sensor range, the window the filter saw
+  std::array<std::vector<float>, numberOfSensorQuantities> windows;
+  std::vector<Measurement> output;
+  unsigned outsideWindow = 0;
+  unsigned invalidPassed = 0;
+
+  const auto recordSize = traceFormat::recordSize(numberOfQuantities);
+  for (std::size_t position = traceFormat::headerSize; (position + recordSize) <= data.size(); position += recordSize) {
+    uint32_t time;
+    uint8_t valid;
+    float values[traceFormat::maxNumberOfQuantities];
+    traceFormat::decodeRecord(&data[position], time, valid, values, numberOfQuantities);
+
+    Measurement measurement{};
+    measurement.time = time;
+    measurement.clear();
+    for (uint8_t i = 0; i < std::min<std::size_t>(numberOfQuantities, numberOfSensorQuantities); ++i) {
+      if (valid & (1u << i)) {
+        measurement.set(static_cast<Quantity>(i), values[i]);
+      }
+    }
+    const Measurement raw = measurement;
+    filter.filter(measurement);
+
+    for (std::size_t i = 0; i < numberOfSensorQuantities; ++i) {
+      const auto quantity = static_cast<Quantity>(i);
+      if (not raw.isValid(quantity)) {
+        invalidPassed += measurement.isValid(quantity) ? 1 : 0;
+        continue;
+      }
+
+      const float rawValue = value(raw, quantity);
+      if ((rawValue < MeasurementFilter::getMinimum(quantity)) or (rawValue > MeasurementFilter::getMaximum(quantity))) {
+        invalidPassed += measurement.isValid(quantity) ? 1 : 0;
+        continue;
+      }
+
+      auto& window = windows[i];
+      window.push_back(rawValue);
+      if (window.size() > HampelFilter::windowSize) {
+        window.erase(window.begin());
+      }
+
+      const float filtered = value(measurement, quantity);
+      const auto [minimum, maximum] = std::minmax_element(window.begin(), window.end());
+      if ((filtered != rawValue) and ((filtered < *minimum) or (filtered > *maximum))) {
+        outsideWindow++;
+      }
+    }
+
+    output.push_back(measurement);
+  }
+
+  std::printf("%s: %zu records, replaced", name, output.size());
+  for (std::size_t i = 0; i < numberOfSensorQuantities; ++i) {
+    std::printf(" %u", filter.getNumberOfReplacedValues(static_cast<Quantity>(i)));
+  }
+  std::printf("\n");
+
+  check(outsideWindow == 0, "filtered values of the trace are raw or within the window");
+  check(invalidPassed == 0, "invalid values of the trace stay invalid");
+  return output;
+}
+
+/// Five quantities every 15 s, a single read glitch of the SCD30 at 105 s and a missed read at 150 s
+std::vector<uint8_t> embeddedTrace() {
+  struct Record {
+    uint32_t time;
+    float co2;
+    float temperature;
+    float humidity;
+    float pressure;
+    float bmp280Temperature;
+  };
+  const Record records[] = {
+    {1633046400, 612.4f, 22.41f, 41.3f, 1003.21f, 23.12f},
+    {1633046415, 615.1f, 22.43f, 41.2f, 1003.24f, 23.13f},
+    {1633046430, 611.8f, 22.42f, 41.4f, 1003.19f, 23.13f},
+    {1633046445, 618.3f, 22.44f, 41.3f, 1003.22f, 23.14f},
+    {1633046460, 614.0f, 22.46f, 41.1f, 1003.25f, 23.15f},
+    {1633046475, 620.2f, 22.45f, 41.2f, 1003.23f, 23.15f},
+    {1633046490, 617.5f, 22.47f, 41.0f, 1003.20f, 23.16f},
+    {1633046505, 2875.0f, 22.48f, 41.1f, 1003.22f, 23.17f},
+    {1633046520, 619.4f, 22.47f, 41.0f, 1003.26f, 23.17f},
+    {1633046535, 623.1f, 22.49f, 40.9f, 1003.24f, 23.18f},
+    {1633046550, NAN, NAN, NAN, 1003.21f, 23.18f},
+    {1633046565, 621.7f, 22.51f, 40.8f, 1003.23f, 23.19f},
+    {1633046580, 626.0f, 22.50f, 40.9f, 1003.27f, 23.20f},
+    {1633046595, 624.2f, 22.52f, 40.7f, 1003.25f, 23.20f},
+    {1633046610, 630.5f, 22.53f, 40.8f, 1003.22f, 23.21f},
+    {1633046625, 628.1f, 22.55f, 40.6f, 1003.24f, 23.22f},
+  };
+
+  constexpr uint8_t numberOfQuantities = 5;
+  std::vector<uint8_t> data(traceFormat::headerSize + std::size(records) * traceFormat::recordSize(numberOfQuantities));
+  traceFormat::encodeHeader(data.data(), numberOfQuantities);
+  std::size_t position = traceFormat::headerSize;
+  for (const auto& record : records) {
+    const float values[numberOfQuantities] = {record.co2, record.temperature, record.humidity, record.pressure, record.bmp280Temperature};
+    const uint8_t valid = std::isnan(record.co2) ? 0x18u : 0x1Fu;
+    traceFormat::encodeRecord(&data[position], record.time, valid, values, numberOfQuantities);
+    position += traceFormat::recordSize(numberOfQuantities);
+  }
+  return data;
+}
+
+void testEmbeddedTrace() {
+  MeasurementFilter filter;
+  const auto output = replayTrace(embeddedTrace(), "embedded trace", filter);
+  if (output.size() != 16) {
+    check(false, "embedded trace is replayed completely");
+    return;
+  }
+
+  check(value(output[7], Quantity::Scd30Co2) == 618.3f, "glitch of the trace is replaced by the median");
+  check(filter.getNumberOfReplacedValues(Quantity::Scd30Co2) == 1, "only the glitch of the trace is replaced");
+  check(value(output[8], Quantity::Scd30Co2) == 619.4f, "value after the glitch passes unchanged");
+  check(not output[10].isValid(Quantity::Scd30Co2) and output[10].isValid(Quantity::Bmp280Pressure), "missed read of the trace stays invalid");
+  check(value(output[11], Quantity::Scd30Co2) == 621.7f, "value after the missed read passes unchanged");
+
+  unsigned replaced = 0;
+  for (std::size_t i = 1; i < numberOfSensorQuantities; ++i) {
+    replaced += filter.getNumberOfReplacedValues(static_cast<Quantity>(i));
+  }
+  check(replaced == 0, "noise of the other quantities of the trace passes unchanged");
+}
+
+void testRecordedTrace(const char* fileName) {
+  std::ifstream file{fileName, std::ios::binary};
+  if (not file) {
+    std::fprintf(stderr, "Opening %s failed.\n", fileName);
+    failures++;
+    return;
+  }
+
+  const std::vector<uint8_t> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  MeasurementFilter filter;
+  replayTrace(data, fileName, filter);
+}
+
+}
+
+int main(int argc, char** argv) {
+  testSpike();
+  testStep();
+  testNoise();
+  testNan();
+  testMedian();
+  testModeNone();
+  testRange();
+  testEmbeddedTrace();
+  for (int i = 1; i < argc; ++i) {
+    testRecordedTrace(argv[i]);
+  }
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%u checks failed.\n", failures);
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}
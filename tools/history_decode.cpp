@@ -0,0 +1,50 @@
+/**
+ * @file history_decode.cpp
+ *
+ * Host side reference decoder for /api/history.bin. Reads a frame from stdin and prints it as CSV.
+ *
+ * Build: g++ -std=c++17 -I../src -o history_decode history_decode.cpp
+ * Usage: curl -s http://<hostname>/api/history.bin | ./history_decode
+ */
+
+#include <cstdio>
+#include <iterator>
+#include <iostream>
+#include <vector>
+
+#include "history_frame.hpp"
+
+int main() {
+  std::vector<uint8_t> data{std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>()};
+
+  historyFrame::Decoder decoder{data.data(), data.size()};
+  if (not decoder.readHeader()) {
+    std::fprintf(stderr, "Invalid frame header.\n");
+    return 1;
+  }
+
+  std::printf("time");
+  for (uint8_t i = 0; i < decoder.numberOfQuantities(); ++i) {
+    std::printf(",quantity%u", i);
+  }
+  std::printf("\n");
+
+  int64_t time;
+  float values[historyFrame::maxNumberOfQuantities];
+  uint16_t samples = 0;
+  while (decoder.readSample(time, values)) {
+    std::printf("%lld", static_cast<long long>(time));
+    for (uint8_t i = 0; i < decoder.numberOfQuantities(); ++i) {
+      std::printf(",%.*f", decoder.exponent(i) < 0 ? -decoder.exponent(i) : 0, values[i]);
+    }
+    std::printf("\n");
+    samples++;
+  }
+
+  if (samples != decoder.numberOfSamples()) {
+    std::fprintf(stderr, "Frame truncated after %u of %u samples.\n", samples, decoder.numberOfSamples());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file history_frame_test.cpp
+ *
+ * Host side round-trip test of src/history_frame.hpp. Encodes frames, decodes them again and checks values, invalid
+ * samples and the rejection of broken frames.
+ *
+ * Build: g++ -std=c++17 -I../src -o history_frame_test history_frame_test.cpp
+ * Usage: ./history_frame_test, exits with 1 if a check failed
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "history_frame.hpp"
+
+namespace {
+
+unsigned failures = 0;
+
+void check(bool condition, const char* description) {
+  if (not condition) {
+    std::fprintf(stderr, "FAILED: %s\n", description);
+    failures++;
+  }
+}
+
+struct Sample {
+  int64_t time;
+  std::vector<float> values;
+};
+
+std::vector<uint8_t> encode(const std::vector<int8_t>& exponents, const std::vector<Sample>& samples) {
+  std::vector<uint8_t> frame;
+  historyFrame::Encoder encoder{[&frame](const uint8_t* data, std::size_t size) {
+    frame.insert(frame.end(), data, data + size);
+  }};
+
+  encoder.begin(exponents.size(), exponents.data(), samples.size());
+  for (const auto& sample : samples) {
+    encoder.addSample(sample.time, sample.values.data());
+  }
+  encoder.finish();
+
+  return frame;
+}
+
+bool sameValue(float expected, float actual, int8_t exponent) {
+  if (std::isnan(expected) or std::isnan(actual)) {
+    return std::isnan(expected) and std::isnan(actual);
+  }
+  return std::fabs(expected - actual) <= (std::pow(10.0, exponent) * 1e-3);
+}
+
+void testRoundTrip() {
+  const std::vector<int8_t> exponents{0, -1, -1, -2, 1};
+  std::vector<Sample> samples;
+  int64_t time = 1633046400;
+  for (int i = 0; i < 500; ++i) {
+    // Irregular and one negative delta, as after a clock correction
+    time += (i == 250) ? -30 : (2 + (i % 7));
+    samples.push_back({time, {400.0f + i, 21.5f - i * 0.1f, 45.0f, 1013.25f, -1230.0f}});
+  }
+  samples[10].values[1] = NAN;
+  samples[20].values = {NAN, NAN, NAN, NAN, NAN};
+
+  // More than 256 bytes, so the encoder has to flush several times
+  const auto frame = encode(exponents, samples);
+  check(frame.size() > 1024, "frame spans several encoder buffers");
+
+  historyFrame::Decoder decoder{frame.data(), frame.size()};
+  check(decoder.readHeader(), "header of valid frame accepted");
+  check(decoder.numberOfQuantities() == exponents.size(), "number of quantities");
+  check(decoder.numberOfSamples() == samples.size(), "number of samples");
+  for (std::size_t i = 0; i < exponents.size(); ++i) {
+    check(decoder.exponent(i) == exponents[i], "exponents");
+  }
+
+  int64_t decodedTime;
+  float values[historyFrame::maxNumberOfQuantities];
+  std::size_t decoded = 0;
+  bool timesMatch = true;
+  bool valuesMatch = true;
+  while (decoder.readSample(decodedTime, values)) {
+    const auto& sample = samples[decoded];
+    timesMatch = timesMatch and (decodedTime == sample.time);
+    for (std::size_t i = 0; i < exponents.size(); ++i) {
+      valuesMatch = valuesMatch and sameValue(sample.values[i], values[i], exponents[i]);
+    }
+    decoded++;
+  }
+  check(decoded == samples.size(), "all samples decoded");
+  check(timesMatch, "times survive the round trip including a negative delta");
+  check(valuesMatch, "values and NaN survive the round trip");
+}
+
+void testFixedPoint() {
+  check(historyFrame::toFixedPoint(21.25f, -1) == 213, "half rounds away from zero");
+  check(historyFrame::toFixedPoint(-21.25f, -1) == -213, "negative half rounds away from zero");
+  check(historyFrame::toFixedPoint(1013.24f, -1) == 10132, "rounds to nearest");
+  check(historyFrame::toFixedPoint(1234.0f, 1) == 123, "positive exponent");
+  check(historyFrame::toFixedPoint(NAN, 0) == historyFrame::invalidValue, "NaN is invalid");
+  check(historyFrame::toFixedPoint(3e9f, 0) == historyFrame::invalidValue, "too large is invalid");
+  check(historyFrame::toFixedPoint(-3e9f, 0) == historyFrame::invalidValue, "too small is invalid");
+  check(historyFrame::toFixedPoint(static_cast<float>(INT32_MIN), 0) == historyFrame::invalidValue,
+    "the invalid marker itself can't be encoded as value");
+  check(std::isnan(historyFrame::fromFixedPoint(historyFrame::invalidValue, -2)), "invalid decodes to NaN");
+  check(std::fabs(historyFrame::fromFixedPoint(-213, -1) - (-21.3f)) < 1e-4f, "negative value decodes");
+
+  for (int64_t value : std::vector<int64_t>{0, 1, -1, 63, -64, 64, INT64_MAX, INT64_MIN}) {
+    check(historyFrame::zigzagDecode(historyFrame::zigzagEncode(value)) == value, "zigzag round trip");
+  }
+}
+
+void testTruncated() {
+  const std::vector<int8_t> exponents{0, -1};
+  const auto frame = encode(exponents, {{100, {1.0f, 2.0f}}, {110, {3.0f, 4.0f}}, {120, {5.0f, 6.0f}}});
+
+  std::vector<uint8_t> truncated{frame.begin(), frame.end() - 1};
+  historyFrame::Decoder decoder{truncated.data(), truncated.size()};
+  check(decoder.readHeader(), "header of truncated frame accepted");
+
+  int64_t time;
+  float values[historyFrame::maxNumberOfQuantities];
+  std::size_t decoded = 0;
+  while (decoder.readSample(time, values)) {
+    decoded++;
+  }
+  check(decoded == 2, "truncated sample is not returned");
+
+  for (std::size_t size = 0; size < (sizeof(historyFrame::magic) + 4 + exponents.size()); ++size) {
+    historyFrame::Decoder header{frame.data(), size};
+    check(not header.readHeader(), "truncated header rejected");
+  }
+}
+
+void testBrokenHeader() {
+  const std::vector<int8_t> exponents{0};
+  auto frame = encode(exponents, {{100, {1.0f}}});
+
+  auto wrongMagic = frame;
+  wrongMagic[0] = 'X';
+  historyFrame::Decoder magicDecoder{wrongMagic.data(), wrongMagic.size()};
+  check(not magicDecoder.readHeader(), "wrong magic rejected");
+
+  auto wrongVersion = frame;
+  wrongVersion[sizeof(historyFrame::magic)] = historyFrame::version + 1;
+  historyFrame::Decoder versionDecoder{wrongVersion.data(), wrongVersion.size()};
+  check(not versionDecoder.readHeader(), "wrong version rejected");
+}
+
+void testNumberOfQuantities() {
+  const std::vector<int8_t> exponents(historyFrame::maxNumberOfQuantities, -1);
+  const std::vector<float> values(historyFrame::maxNumberOfQuantities, 12.3f);
+  const auto frame = encode(exponents, {{100, values}});
+
+  historyFrame::Decoder decoder{frame.data(), frame.size()};
+  check(decoder.readHeader(), "maxNumberOfQuantities accepted");
+  int64_t time;
+  float decoded[historyFrame::maxNumberOfQuantities];
+  check(decoder.readSample(time, decoded), "sample with maxNumberOfQuantities decoded");
+  check(sameValue(12.3f, decoded[historyFrame::maxNumberOfQuantities - 1], -1), "last quantity decoded");
+
+  auto tooMany = frame;
+  tooMany[sizeof(historyFrame::magic) + 1] = historyFrame::maxNumberOfQuantities + 1;
+  historyFrame::Decoder tooManyDecoder{tooMany.data(), tooMany.size()};
+  check(not tooManyDecoder.readHeader(), "more than maxNumberOfQuantities rejected");
+}
+
+}
+
+int main() {
+  testRoundTrip();
+  testFixedPoint();
+  testTruncated();
+  testBrokenHeader();
+  testNumberOfQuantities();
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%u checks failed.\n", failures);
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}
@@ -0,0 +1,299 @@
+/**
+ * @file benchmark.cpp
+ *
+ * Runs the firmware on the host with simulated peripherals (see host.hpp) and prints the instrumentation statistics
+ * as JSON. Simulated time makes runs reproducible, so the JSON of two commits can be compared, for example with
+ * diff <(jq . before.json) <(jq . after.json). Sample latencies are in simulated µs, timers and routes in host µs.
+ *
+ * The firmware is built with INSTRUMENTATION and ALLOCATION_TRACKING. The run fails if the loop allocates after
+ * setup() or a request is answered with a server error.
+ *
+ * Build: make -C tools/host (see Makefile)
+ * Usage: ./benchmark [options]
+ *   --duration=<s>         simulated run time, default 3600
+ *   --tick=<µs>            simulated time of a loop() iteration that doesn't idle, default 1000
+ *   --http-interval=<ms>   mean time between requests, default 5000, 0 disables requests. Each gap is drawn from
+ *                          0.5 to 1.5 times it with a fixed seed, so requests drift against the sample grid.
+ *   --button-interval=<ms> time between presses of button 4 (next screen), default 20000, 0 disables buttons
+ *   --set <key>=<value>    configuration entry, for example --set powerSave=true
+ *   --mqtt                 simulated MQTT broker, sets mqttBroker
+ *   --record=<file>        records a trace (traceMode=record) and writes it to file at the end
+ *   --replay=<file>        replays a trace (traceMode=replay), ends when the replay finished and writes the replay
+ *                          CSV to <file>.csv, compare two of them with tools/replay_compare.cpp
+ *   --verbose              serial output to stderr
+ */
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+
+#include "host.hpp"
+#include "allocation_tracker.hpp"
+#include "instrumentation.hpp"
+#include "measurements.hpp"
+#include "pins.hpp"
+
+void setup();
+void loop();
+
+extern Measurements measurements;
+
+namespace {
+
+struct Options {
+  uint32_t duration = 3600; // s
+  uint32_t tick = 1000; // µs
+  uint32_t httpInterval = 5000; // ms
+  uint32_t buttonInterval = 20000; // ms
+  bool mqtt = false;
+  bool verbose = false;
+  const char* record = nullptr;
+  const char* replay = nullptr;
+  char config[2048] = "";
+};
+
+/// Requests cycle through these
+constexpr const char* requestPaths[] = {
+  "/metrics",
+  "/api/history",
+  "/api/history.bin",
+  "/",
+  "/api/config",
+  "/api/history?limit=10",
+  "/api/diagnostics",
+  "/api/allocations",
+  "/config",
+};
+
+constexpr uint32_t buttonPressDuration = 200; // ms
+
+/// Fixed, so runs stay reproducible
+constexpr uint32_t requestSeed = 1u;
+
+/// Time until the next request in µs, uniform from 0.5 to 1.5 times the interval. With fixed gaps requests would keep
+/// their phase to the samples, and the served latency of every sample would be the same.
+uint64_t requestGap(uint32_t interval, std::minstd_rand& random) {
+  std::uniform_int_distribution<uint64_t> distribution{interval * 500ull, interval * 1500ull};
+  return distribution(random);
+}
+
+void usage() {
+  std::fprintf(stderr, "Usage: benchmark [--duration=<s>] [--tick=<us>] [--http-interval=<ms>] [--button-interval=<ms>] "
+    "[--set <key>=<value>]... [--mqtt] [--record=<file>] [--replay=<file>] [--verbose]\n");
+}
+
+/// Appends a configuration entry, values other than numbers and booleans are strings
+bool addConfig(Options& options, const char* entry) {
+  const char* equals = std::strchr(entry, '=');
+  if (equals == nullptr) {
+    return false;
+  }
+
+  const char* value = equals + 1;
+  char* end;
+  std::strtol(value, &end, 10);
+  const bool raw = ((*value != '\0') and (*end == '\0')) or (std::strcmp(value, "true") == 0) or (std::strcmp(value, "false") == 0);
+
+  const auto length = std::strlen(options.config);
+  const int written = std::snprintf(options.config + length, sizeof(options.config) - length, ",\"%.*s\":%s%s%s",
+    static_cast<int>(equals - entry), entry, raw ? "" : "\"", value, raw ? "" : "\"");
+  return (written > 0) and (static_cast<std::size_t>(written) < (sizeof(options.config) - length));
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (std::strncmp(arg, "--duration=", 11) == 0) {
+      options.duration = std::strtoul(arg + 11, nullptr, 10);
+    } else if (std::strncmp(arg, "--tick=", 7) == 0) {
+      options.tick = std::max(1ul, std::strtoul(arg + 7, nullptr, 10));
+    } else if (std::strncmp(arg, "--http-interval=", 16) == 0) {
+      options.httpInterval = std::strtoul(arg + 16, nullptr, 10);
+    } else if (std::strncmp(arg, "--button-interval=", 18) == 0) {
+      options.buttonInterval = std::strtoul(arg + 18, nullptr, 10);
+    } else if ((std::strcmp(arg, "--set") == 0) and ((i + 1) < argc)) {
+      if (not addConfig(options, argv[++i])) {
+        return false;
+      }
+    } else if (std::strcmp(arg, "--mqtt") == 0) {
+      options.mqtt = true;
+    } else if (std::strncmp(arg, "--record=", 9) == 0) {
+      options.record = arg + 9;
+      if (not addConfig(options, "traceMode=record")) {
+        return false;
+      }
+    } else if (std::strncmp(arg, "--replay=", 9) == 0) {
+      options.replay = arg + 9;
+      if (not addConfig(options, "traceMode=replay")) {
+        return false;
+      }
+    } else if (std::strcmp(arg, "--verbose") == 0) {
+      options.verbose = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Slow oscillation between 420 and 1400 ppm with a single sample spike every 101 samples
+host::Scd30Sample scd30Source(uint64_t time) {
+  const double t = time / 1e6;
+  const bool spike = (static_cast<uint64_t>(t / 2.0) % 101u) == 100u;
+  const float co2 = 910.0f + 490.0f * std::sin(2.0 * M_PI * t / 3600.0) + (spike ? 2000.0f : 0.0f);
+  const float temperature = 21.5f + 0.5f * std::sin(2.0 * M_PI * t / 7200.0);
+  const float humidity = 45.0f + 5.0f * std::cos(2.0 * M_PI * t / 5400.0);
+  return {co2, temperature, humidity};
+}
+
+void writeConfig(const Options& options) {
+  char json[sizeof(Options::config) + 128];
+  const int length = std::snprintf(json, sizeof(json), "{\"wifiSsid\":\"benchmark\",\"wifiPassword\":\"benchmark\"%s%s}",
+    options.mqtt ? ",\"mqttBroker\":\"broker.local\"" : "", options.config);
+
+  SPIFFS.begin();
+  File file = SPIFFS.open("/config.json", "w");
+  file.write(reinterpret_cast<const uint8_t*>(json), length);
+  file.close();
+}
+
+/// Copies a file between the host and the simulated SPIFFS
+bool copyFile(const char* from, const char* to, bool toSpiffs) {
+  std::FILE* host = std::fopen(toSpiffs ? from : to, toSpiffs ? "rb" : "wb");
+  if (host == nullptr) {
+    std::fprintf(stderr, "Opening %s failed.\n", toSpiffs ? from : to);
+    return false;
+  }
+
+  File file = SPIFFS.open(toSpiffs ? to : from, toSpiffs ? "w" : "r");
+  uint8_t buffer[4096];
+  std::size_t size;
+  if (toSpiffs) {
+    while ((size = std::fread(buffer, 1, sizeof(buffer), host)) > 0) {
+      file.write(buffer, size);
+    }
+  } else {
+    while ((size = file.read(buffer, sizeof(buffer))) > 0) {
+      std::fwrite(buffer, 1, size, host);
+    }
+  }
+
+  file.close();
+  std::fclose(host);
+  return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (not parseOptions(argc, argv, options)) {
+    usage();
+    return 2;
+  }
+
+  host::setVerbose(options.verbose);
+  host::setScd30Source(scd30Source);
+  host::setMqttBrokerAvailable(options.mqtt);
+  writeConfig(options);
+  if ((options.replay != nullptr) and (not copyFile(options.replay, Trace::traceFileName, true))) {
+    return 2;
+  }
+
+  setup();
+
+  const uint64_t end = host::now() + options.duration * 1000000ull;
+  std::minstd_rand random{requestSeed};
+  uint64_t nextRequest = host::now() + requestGap(options.httpInterval, random);
+  uint64_t nextButton = host::now() + options.buttonInterval * 1000ull;
+  bool buttonPressed = false;
+  std::size_t requestIndex = 0;
+  uint32_t requestsHandled = 0;
+  uint32_t serverErrors = 0;
+  uint64_t loops = 0;
+  std::chrono::nanoseconds loopTime{0};
+
+  while ((host::now() < end) and ((options.replay == nullptr) or measurements.trace().isReplaying())) {
+    if ((options.httpInterval > 0) and (host::now() >= nextRequest)) {
+      host::queueRequest(HTTP_GET, requestPaths[requestIndex++ % std::size(requestPaths)]);
+      nextRequest += requestGap(options.httpInterval, random);
+    }
+
+    if ((options.buttonInterval > 0) and (host::now() >= nextButton)) {
+      buttonPressed = not buttonPressed;
+      host::setPin(pins::Button4, buttonPressed ? LOW : HIGH);
+      nextButton += (buttonPressed ? buttonPressDuration : (options.buttonInterval - buttonPressDuration)) * 1000ull;
+    }
+
+    // Light sleep ends with the next external event
+    host::setNextEvent(std::min(options.httpInterval > 0 ? nextRequest : UINT64_MAX, options.buttonInterval > 0 ? nextButton : UINT64_MAX));
+
+    const uint64_t before = host::now();
+    const auto start = std::chrono::steady_clock::now();
+    loop();
+    loopTime += std::chrono::steady_clock::now() - start;
+    loops++;
+
+    if (host::counters().requests != requestsHandled) {
+      requestsHandled = host::counters().requests;
+      if (host::lastResponse().code >= 500) {
+        serverErrors++;
+      }
+    }
+
+    if (host::now() == before) {
+      host::advance(options.tick);
+    }
+  }
+
+  const uint32_t steadyStateAllocations = allocationTracker::getSteadyStateAllocations();
+
+  if (options.record != nullptr) {
+    copyFile(Trace::traceFileName, options.record, false);
+  }
+  if (options.replay != nullptr) {
+    static char output[4096];
+    std::snprintf(output, sizeof(output), "%s.csv", options.replay);
+    copyFile(Trace::replayFileName, output, false);
+  }
+  const auto& counters = host::counters();
+
+  static char instrumentation[instrumentation::maxJsonLength + 1];
+  const auto instrumentationLength = instrumentation::renderJson(instrumentation, sizeof(instrumentation));
+
+  std::printf("{\"version\":\"%s\",\"scenario\":{\"duration\":%u,\"tick\":%u,\"httpInterval\":%u,\"buttonInterval\":%u,\"mqtt\":%s,\"config\":{%s}},",
+    GIT_DESCRIBE, options.duration, options.tick, options.httpInterval, options.buttonInterval, options.mqtt ? "true" : "false",
+    options.config[0] ? (options.config + 1) : "");
+  std::printf("\"simulated\":{\"loops\":%llu,\"samples\":%u,\"displayFrames\":%u,\"requests\":%u,\"serverErrors\":%u,"
+    "\"mqttPublishes\":%u,\"mqttBytes\":%zu,\"udpPackets\":%u,\"lightSleeps\":%u,\"lightSleepTime\":%llu,\"delayTime\":%llu},",
+    static_cast<unsigned long long>(loops), measurements.getMeasurementCounter(), counters.displayFrames, requestsHandled,
+    serverErrors, counters.mqttPublishes, counters.mqttBytes, counters.udpPackets, counters.lightSleeps,
+    static_cast<unsigned long long>(counters.lightSleepTime), static_cast<unsigned long long>(counters.delayTime));
+  std::printf("\"host\":{\"loopTime\":%llu,\"meanLoopTime\":%.3f},",
+    static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(loopTime).count()),
+    loops ? (std::chrono::duration<double, std::micro>(loopTime).count() / loops) : 0.0);
+  std::printf("\"steadyStateAllocations\":%u,\"instrumentation\":%.*s}\n", steadyStateAllocations,
+    static_cast<int>(instrumentationLength), instrumentationLength ? instrumentation : "null");
+
+  bool failed = false;
+  if (steadyStateAllocations > 0) {
+    static char allocations[allocationTracker::maxJsonLength + 1];
+    const auto length = allocationTracker::renderJson(allocations, sizeof(allocations));
+    std::fprintf(stderr, "FAILED: %u allocations after setup(), see sites with steadyStateAllocations "
+      "(addr2line -f -C -e benchmark <address>):\n%.*s\n", steadyStateAllocations, static_cast<int>(length), allocations);
+    failed = true;
+  }
+  if (serverErrors > 0) {
+    std::fprintf(stderr, "FAILED: %u requests answered with a server error.\n", serverErrors);
+    failed = true;
+  }
+
+  return failed ? 1 : 0;
+}
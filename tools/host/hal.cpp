@@ -0,0 +1,1007 @@
+/**
+ * @file hal.cpp
+ *
+ * Simulated peripherals behind the fake headers in tools/host/include, controlled through host.hpp.
+ */
+
+#include <Arduino.h>
+#include <Adafruit_BMP280.h>
+#include <Adafruit_SSD1306.h>
+#include <ESPmDNS.h>
+#include <MQTT.h>
+#include <Preferences.h>
+#include <SPIFFS.h>
+#include <Update.h>
+#include <WebServer.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Wire.h>
+#include <driver/spi_master.h>
+#include <esp_ota_ops.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+
+#include <chrono>
+#include <cstdarg>
+#include <iterator>
+
+#include "host.hpp"
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+TwoWire Wire;
+MDNSResponder MDNS;
+UpdateClass Update;
+fs::FS SPIFFS;
+
+namespace fs {
+
+/// Preallocated, so writing files never allocates
+struct FileData {
+  static constexpr size_t capacity = 1536u * 1024u;
+
+  bool used = false;
+  char path[32] = "";
+  size_t size = 0;
+  uint8_t data[capacity];
+};
+
+}
+
+namespace {
+
+uint64_t simulatedTime = 0;
+uint64_t nextEvent = UINT64_MAX;
+uint64_t sleepDuration = 0;
+
+time_t ntpTime = 1633046400; // 2021-10-01 00:00:00 UTC
+bool ntpSynchronized = false;
+uint64_t ntpSynchronizedAt = 0;
+
+int pinLevels[40];
+bool pinLevelsInitialized = false;
+
+bool verbose = false;
+host::Counters counters{};
+
+uint32_t wifiFastConnectDelay = 800;
+uint32_t wifiScanConnectDelay = 3000;
+bool mqttBrokerAvailable = false;
+
+int& pinLevel(uint8_t pin) {
+  if (not pinLevelsInitialized) {
+    // Pull-ups of the buttons
+    std::fill(std::begin(pinLevels), std::end(pinLevels), HIGH);
+    pinLevelsInitialized = true;
+  }
+  return pinLevels[pin % std::size(pinLevels)];
+}
+
+// SCD30 at 0x61, see interface description of the Sensirion SCD30
+
+constexpr uint8_t scd30Address = 0x61u;
+
+uint8_t scd30Crc(uint8_t msb, uint8_t lsb) {
+  uint8_t crc = 0xFFu;
+  for (const uint8_t byte : {msb, lsb}) {
+    crc ^= byte;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80u) ? static_cast<uint8_t>((crc << 1) ^ 0x31u) : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+host::Scd30Sample defaultScd30Source(uint64_t) {
+  return {600.0f, 21.5f, 45.0f};
+}
+
+struct Scd30 {
+  bool present = true;
+  host::Scd30Source source = defaultScd30Source;
+  bool running = false;
+  uint16_t interval = 2;
+  uint64_t nextSample = 0;
+  uint16_t command = 0;
+  uint16_t automaticSelfCalibration = 1;
+  uint16_t forcedRecalibrationValue = 400;
+  uint16_t temperatureOffset = 0;
+  uint16_t altitudeCompensation = 0;
+
+  uint16_t* setting(uint16_t reg) {
+    switch (reg) {
+      case 0x5306u: return &automaticSelfCalibration;
+      case 0x5204u: return &forcedRecalibrationValue;
+      case 0x5403u: return &temperatureOffset;
+      case 0x5102u: return &altitudeCompensation;
+      default: return nullptr;
+    }
+  }
+
+  bool ready() const {
+    return running and (simulatedTime >= nextSample);
+  }
+
+  void write(const uint8_t* data, size_t size) {
+    if (size < 2) {
+      return;
+    }
+    command = (data[0] << 8) | data[1];
+    if ((size != 5) or (scd30Crc(data[2], data[3]) != data[4])) {
+      if (command == 0x0104u) {
+        running = false;
+      } else if (command == 0xD304u) {
+        running = false;
+        interval = 2;
+      }
+      return;
+    }
+
+    const uint16_t value = (data[2] << 8) | data[3];
+    if (command == 0x0010u) {
+      if (not running) {
+        running = true;
+        nextSample = simulatedTime + interval * 1000000ull;
+      }
+    } else if (command == 0x4600u) {
+      interval = value;
+      nextSample = simulatedTime + interval * 1000000ull;
+    } else if (auto* reg = setting(command)) {
+      *reg = value;
+    }
+  }
+
+  size_t read(uint8_t* data, size_t size) {
+    if ((command == 0x0300u) and (size == 18)) {
+      if (not ready()) {
+        return 0;
+      }
+      const auto sample = source(nextSample);
+      // Samples not read in time are overwritten by the next one
+      while (nextSample <= simulatedTime) {
+        nextSample += interval * 1000000ull;
+      }
+
+      const float values[] = {sample.co2, sample.temperature, sample.humidity};
+      size_t length = 0;
+      for (const float value : values) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (const uint16_t word : {static_cast<uint16_t>(bits >> 16), static_cast<uint16_t>(bits)}) {
+          data[length++] = word >> 8;
+          data[length++] = word;
+          data[length++] = scd30Crc(word >> 8, word);
+        }
+      }
+      return length;
+    }
+
+    if (size != 3) {
+      return 0;
+    }
+
+    uint16_t value = 0;
+    if (command == 0x0202u) {
+      value = ready() ? 1 : 0;
+    } else if (command == 0x4600u) {
+      value = interval;
+    } else if (command == 0xD100u) {
+      value = 0x0342u;
+    } else if (const auto* reg = setting(command)) {
+      value = *reg;
+    }
+    data[0] = value >> 8;
+    data[1] = value;
+    data[2] = scd30Crc(data[0], data[1]);
+    return 3;
+  }
+} scd30;
+
+// BMP280 at 0x76, only its chip id register is simulated, the Adafruit driver is replaced as a whole
+
+constexpr uint8_t bmp280Address = 0x76u;
+bool bmp280Present = true;
+float bmp280Pressure = 101325.0f;
+float bmp280Temperature = 22.0f;
+uint8_t bmp280Register = 0;
+
+// Web server
+
+struct Request {
+  HTTPMethod method;
+  char uri[256];
+  char body[String::capacity];
+};
+
+Request requests[16];
+size_t firstRequest = 0;
+size_t numberOfRequests = 0;
+char currentBody[String::capacity];
+host::Response currentResponse{};
+host::Response lastResponse{};
+char responseBody[host::maxBodySize];
+
+void appendResponse(const void* data, size_t size) {
+  currentResponse.bytes += size;
+  const auto copied = std::min(size, host::maxBodySize - currentResponse.bodySize);
+  std::memcpy(responseBody + currentResponse.bodySize, data, copied);
+  currentResponse.bodySize += copied;
+}
+
+void urlDecode(const char* begin, const char* end, char* destination, size_t size) {
+  size_t length = 0;
+  for (const char* c = begin; (c < end) and (length + 1 < size); ++c) {
+    if ((*c == '%') and ((end - c) > 2)) {
+      const char hex[] = {c[1], c[2], '\0'};
+      destination[length++] = static_cast<char>(std::strtol(hex, nullptr, 16));
+      c += 2;
+    } else {
+      destination[length++] = (*c == '+') ? ' ' : *c;
+    }
+  }
+  destination[length] = '\0';
+}
+
+// File system
+
+fs::FileData files[8];
+
+fs::FileData* findFile(const char* path) {
+  for (auto& file : files) {
+    if (file.used and (std::strcmp(file.path, path) == 0)) {
+      return &file;
+    }
+  }
+  return nullptr;
+}
+
+// Non-volatile storage
+
+struct Preference {
+  char key[48];
+  uint32_t value;
+};
+
+Preference preferences[16];
+size_t numberOfPreferences = 0;
+
+Preference* findPreference(const char* name, const char* key) {
+  char fullKey[sizeof(Preference::key)];
+  std::snprintf(fullKey, sizeof(fullKey), "%s/%s", name, key);
+  for (size_t i = 0; i < numberOfPreferences; ++i) {
+    if (std::strcmp(preferences[i].key, fullKey) == 0) {
+      return &preferences[i];
+    }
+  }
+  return nullptr;
+}
+
+const esp_partition_t partitions[] = {
+  {0x10000u, 0x1E0000u, "app0"},
+  {0x1F0000u, 0x1E0000u, "app1"},
+};
+
+}
+
+// host.hpp
+
+namespace host {
+
+uint64_t now() {
+  return simulatedTime;
+}
+
+void advance(uint64_t us) {
+  simulatedTime += us;
+}
+
+void setNextEvent(uint64_t us) {
+  nextEvent = us;
+}
+
+void setNtpTime(time_t time) {
+  ntpTime = time;
+}
+
+void setPin(uint8_t pin, int level) {
+  pinLevel(pin) = level;
+}
+
+void setScd30Source(Scd30Source source) {
+  scd30.source = source;
+}
+
+void setScd30Present(bool present) {
+  scd30.present = present;
+}
+
+void setBmp280(bool present, float pressure, float temperature) {
+  bmp280Present = present;
+  bmp280Pressure = pressure;
+  bmp280Temperature = temperature;
+}
+
+void setWifiConnectDelay(uint32_t fast, uint32_t scan) {
+  wifiFastConnectDelay = fast;
+  wifiScanConnectDelay = scan;
+}
+
+void setMqttBrokerAvailable(bool available) {
+  mqttBrokerAvailable = available;
+}
+
+bool queueRequest(HTTPMethod method, const char* uri, const char* body) {
+  if (numberOfRequests == std::size(requests)) {
+    return false;
+  }
+  auto& request = requests[(firstRequest + numberOfRequests++) % std::size(requests)];
+  request.method = method;
+  std::snprintf(request.uri, sizeof(request.uri), "%s", uri);
+  std::snprintf(request.body, sizeof(request.body), "%s", body);
+  return true;
+}
+
+std::size_t pendingRequests() {
+  return numberOfRequests;
+}
+
+const Response& lastResponse() {
+  return ::lastResponse;
+}
+
+const Counters& counters() {
+  return ::counters;
+}
+
+void setVerbose(bool enabled) {
+  verbose = enabled;
+}
+
+}
+
+// Arduino core
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[512];
+  va_list arguments;
+  va_start(arguments, format);
+  const int length = std::vsnprintf(buffer, sizeof(buffer), format, arguments);
+  va_end(arguments);
+  if (length < 0) {
+    return 0;
+  }
+  return write(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+}
+
+size_t Print::print(int value) {
+  char buffer[12];
+  return write(buffer, std::snprintf(buffer, sizeof(buffer), "%d", value));
+}
+
+size_t Print::println(const struct tm* timeinfo, const char* format) {
+  char buffer[64];
+  const auto length = std::strftime(buffer, sizeof(buffer), format, timeinfo);
+  return write(buffer, length) + print("\r\n");
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+  return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (verbose) {
+    std::fwrite(buffer, 1, size, stderr);
+  }
+  return size;
+}
+
+unsigned long millis() {
+  return simulatedTime / 1000u;
+}
+
+unsigned long micros() {
+  return simulatedTime;
+}
+
+void delay(uint32_t ms) {
+  counters.delayTime += ms * 1000ull;
+  simulatedTime += ms * 1000ull;
+}
+
+void delayMicroseconds(uint32_t us) {
+  simulatedTime += us;
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+int digitalRead(uint8_t pin) {
+  return pinLevel(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  pinLevel(pin) = value;
+}
+
+/// Replaces the C library, before the first NTP synchronization the clock starts at 1970 as on the ESP32
+extern "C" time_t time(time_t* result) noexcept {
+  const time_t now = ntpSynchronized ? (ntpTime + static_cast<time_t>((simulatedTime - ntpSynchronizedAt) / 1000000u)) : static_cast<time_t>(simulatedTime / 1000000u);
+  if (result) {
+    *result = now;
+  }
+  return now;
+}
+
+void configTzTime(const char* tz, const char*, const char*, const char*) {
+  setenv("TZ", tz, 1);
+  tzset();
+  if (not ntpSynchronized) {
+    ntpSynchronized = true;
+    ntpSynchronizedAt = simulatedTime;
+  }
+}
+
+bool getLocalTime(struct tm* info, uint32_t) {
+  const time_t now = time(nullptr);
+  if (now < 1451606400) { // 2016
+    return false;
+  }
+  localtime_r(&now, info);
+  return true;
+}
+
+uint32_t esp_random() {
+  static uint32_t state = 0x12345678u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void EspClass::restart() {
+  std::fprintf(stderr, "ESP.restart() at %.3f s\n", simulatedTime / 1e6);
+  std::exit(2);
+}
+
+uint32_t EspClass::getHeapSize() {
+  return 327680u;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return 180000u;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  return 170000u;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+  return 110580u;
+}
+
+uint32_t EspClass::getFreeSketchSpace() {
+  return 0x1E0000u;
+}
+
+uint32_t EspClass::getCycleCount() {
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  return static_cast<uint32_t>(ns * getCpuFreqMHz() / 1000);
+}
+
+// ESP-IDF
+
+int64_t esp_timer_get_time() {
+  return static_cast<int64_t>(simulatedTime);
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) {
+  sleepDuration = us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+  return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start() {
+  const uint64_t wakeup = std::max(simulatedTime, std::min(simulatedTime + sleepDuration, nextEvent));
+  counters.lightSleeps++;
+  counters.lightSleepTime += wakeup - simulatedTime;
+  simulatedTime = wakeup;
+  return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+  return &partitions[0];
+}
+
+const esp_partition_t* esp_ota_get_boot_partition() {
+  return &partitions[0];
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) {
+  return &partitions[1];
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t*) {
+  return ESP_OK;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t, const spi_bus_config_t*, int) {
+  return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t, const spi_device_interface_config_t*, spi_device_handle_t* handle) {
+  *handle = nullptr;
+  return ESP_OK;
+}
+
+namespace {
+
+spi_transaction_t* queuedTransaction = nullptr;
+
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t, spi_transaction_t* transaction, uint32_t) {
+  queuedTransaction = transaction;
+  return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t, spi_transaction_t** transaction, uint32_t) {
+  if (queuedTransaction == nullptr) {
+    return ESP_ERR_TIMEOUT;
+  }
+  *transaction = queuedTransaction;
+  queuedTransaction = nullptr;
+  return ESP_OK;
+}
+
+// I2C
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _address = address;
+  _txSize = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (_txSize >= sizeof(_tx)) {
+    return 0;
+  }
+  _tx[_txSize++] = value;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  if ((_address == scd30Address) and scd30.present) {
+    scd30.write(_tx, _txSize);
+    return 0;
+  }
+  if ((_address == bmp280Address) and bmp280Present) {
+    if (_txSize > 0) {
+      bmp280Register = _tx[0];
+    }
+    return 0;
+  }
+  // Address not acknowledged
+  return 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t size, bool) {
+  _rxSize = 0;
+  _rxPosition = 0;
+  size = std::min(size, sizeof(_rx));
+  if ((address == scd30Address) and scd30.present) {
+    _rxSize = scd30.read(_rx, size);
+  } else if ((address == bmp280Address) and bmp280Present and (size == 1)) {
+    _rx[0] = (bmp280Register == 0xD0u) ? 0x58u : 0x00u;
+    _rxSize = 1;
+  }
+  return _rxSize;
+}
+
+bool Adafruit_BMP280::begin(uint8_t address, uint8_t) {
+  return bmp280Present and (address == bmp280Address);
+}
+
+float Adafruit_BMP280::readPressure() {
+  return bmp280Pressure;
+}
+
+float Adafruit_BMP280::readTemperature() {
+  return bmp280Temperature;
+}
+
+void Adafruit_SSD1306::display() {
+  counters.displayFrames++;
+}
+
+// WiFi
+
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress) {
+  _staticConfig = (static_cast<uint32_t>(localIp) != 0);
+  if (_staticConfig) {
+    _localIp = localIp;
+    _gateway = gateway;
+    _subnet = subnet;
+    _dns = dns1;
+  }
+  return true;
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*, int32_t channel, const uint8_t* bssid, bool) {
+  const uint32_t connectDelay = ((channel != 0) and (bssid != nullptr)) ? wifiFastConnectDelay : wifiScanConnectDelay;
+  _connectedAt = simulatedTime + connectDelay * 1000ull;
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool, bool) {
+  _connectedAt = 0;
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  if ((_mode != WIFI_STA) or (_connectedAt == 0) or (simulatedTime < _connectedAt)) {
+    return WL_DISCONNECTED;
+  }
+  if (not _staticConfig) {
+    // Lease of the simulated DHCP server
+    _localIp = IPAddress(192, 168, 1, 50);
+    _gateway = IPAddress(192, 168, 1, 1);
+    _subnet = IPAddress(255, 255, 255, 0);
+    _dns = IPAddress(192, 168, 1, 1);
+  }
+  return WL_CONNECTED;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  appendResponse(buffer, size);
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  counters.udpPackets++;
+  return 1;
+}
+
+bool MQTTClient::connect(const char*, const char*, const char*, bool) {
+  _connected = mqttBrokerAvailable;
+  return _connected;
+}
+
+bool MQTTClient::connected() {
+  _connected = _connected and mqttBrokerAvailable;
+  return _connected;
+}
+
+bool MQTTClient::publish(const char* topic, const char*, int length, bool, int) {
+  if (not _connected) {
+    return false;
+  }
+  if ((std::strlen(topic) + length + 8) > _bufferSize) {
+    return false;
+  }
+  counters.mqttPublishes++;
+  counters.mqttBytes += length;
+  return true;
+}
+
+// Web server
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction) {
+  if (_numberOfRoutes == maxRoutes) {
+    std::fprintf(stderr, "Too many routes, %s dropped.\n", uri.c_str());
+    return;
+  }
+  auto& route = _routes[_numberOfRoutes++];
+  const auto length = std::min(uri.length(), sizeof(route.uri) - 1);
+  std::memcpy(route.uri, uri.c_str(), length);
+  route.uri[length] = '\0';
+  route.method = method;
+  route.handler = handler;
+}
+
+void WebServer::parseArgs(const char* query) {
+  _numberOfArgs = 0;
+  while ((query != nullptr) and (*query != '\0') and (_numberOfArgs < maxArgs)) {
+    const char* end = std::strchr(query, '&');
+    if (end == nullptr) {
+      end = query + std::strlen(query);
+    }
+    const char* equals = std::find(query, end, '=');
+    auto& arg = _args[_numberOfArgs++];
+    urlDecode(query, equals, arg.name, sizeof(arg.name));
+    urlDecode((equals < end) ? (equals + 1) : end, end, arg.value, sizeof(arg.value));
+    query = (*end == '&') ? (end + 1) : end;
+  }
+}
+
+void WebServer::handleClient() {
+  if ((not _running) or (numberOfRequests == 0)) {
+    return;
+  }
+
+  const auto& request = requests[firstRequest];
+  firstRequest = (firstRequest + 1) % std::size(requests);
+  numberOfRequests--;
+
+  _method = request.method;
+  const char* query = std::strchr(request.uri, '?');
+  const auto length = query ? static_cast<size_t>(query - request.uri) : std::strlen(request.uri);
+  std::snprintf(_uri, sizeof(_uri), "%.*s", static_cast<int>(length), request.uri);
+  parseArgs(query ? (query + 1) : nullptr);
+  std::snprintf(currentBody, sizeof(currentBody), "%s", request.body);
+  _body = currentBody;
+
+  counters.requests++;
+  currentResponse = host::Response{};
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+
+  const Route* match = nullptr;
+  for (size_t i = 0; (i < _numberOfRoutes) and (match == nullptr); ++i) {
+    if ((std::strcmp(_routes[i].uri, _uri) == 0) and ((_routes[i].method == HTTP_ANY) or (_routes[i].method == _method))) {
+      match = &_routes[i];
+    }
+  }
+
+  if (match) {
+    match->handler();
+  } else if (_notFound) {
+    _notFound();
+  } else {
+    send(404, "text/plain", "Not found");
+  }
+
+  currentResponse.body = responseBody;
+  lastResponse = currentResponse;
+}
+
+String WebServer::arg(const char* name) {
+  if (std::strcmp(name, "plain") == 0) {
+    return String(_body);
+  }
+  for (size_t i = 0; i < _numberOfArgs; ++i) {
+    if (std::strcmp(_args[i].name, name) == 0) {
+      return String(_args[i].value);
+    }
+  }
+  return String();
+}
+
+String WebServer::arg(int index) {
+  return (static_cast<size_t>(index) < _numberOfArgs) ? String(_args[index].value) : String();
+}
+
+bool WebServer::hasArg(const char* name) {
+  if (std::strcmp(name, "plain") == 0) {
+    return _body[0] != '\0';
+  }
+  for (size_t i = 0; i < _numberOfArgs; ++i) {
+    if (std::strcmp(_args[i].name, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+String WebServer::header(const char*) {
+  return String();
+}
+
+bool WebServer::hasHeader(const char*) {
+  return false;
+}
+
+bool WebServer::authenticate(const char*, const char*) {
+  return false;
+}
+
+void WebServer::requestAuthentication(HTTPAuthMethod, const char*, const String&) {
+  send(401, "text/plain", "");
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool) {
+  // Name, ": ", value and CRLF
+  currentResponse.bytes += name.length() + value.length() + 4;
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+  send(code, contentType, content.c_str());
+}
+
+void WebServer::send(int code, const char* contentType, const char* content) {
+  send_P(code, contentType, content, std::strlen(content));
+}
+
+void WebServer::send_P(int code, const char* contentType, const char* content, size_t length) {
+  currentResponse.code = code;
+  // Status line and the headers sent by the WebServer library
+  currentResponse.bytes += 64 + (contentType ? std::strlen(contentType) : 0);
+  appendResponse(content, length);
+}
+
+void WebServer::sendContent(const char* content, size_t length) {
+  appendResponse(content, length);
+}
+
+// File system
+
+namespace fs {
+
+size_t File::size() const {
+  return _data ? _data->size : 0;
+}
+
+bool File::seek(uint32_t position) {
+  if ((_data == nullptr) or (position > _data->size)) {
+    return false;
+  }
+  _position = position;
+  return true;
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  if ((_data == nullptr) or (not _write)) {
+    return 0;
+  }
+  // Flash is full
+  size = std::min(size, FileData::capacity - _position);
+  std::memcpy(_data->data + _position, buffer, size);
+  _position += size;
+  _data->size = std::max(_data->size, _position);
+  return size;
+}
+
+int File::read() {
+  uint8_t value;
+  return (read(&value, 1) == 1) ? value : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  if (_data == nullptr) {
+    return 0;
+  }
+  const auto count = std::min(size, _data->size - std::min(_position, _data->size));
+  std::memcpy(buffer, _data->data + _position, count);
+  _position += count;
+  return count;
+}
+
+bool FS::begin(bool) {
+  return true;
+}
+
+File FS::open(const char* path, const char* mode) {
+  auto* file = findFile(path);
+  if (mode[0] == 'r') {
+    return file ? File(file, false) : File();
+  }
+
+  if (file == nullptr) {
+    for (auto& candidate : files) {
+      if (not candidate.used) {
+        file = &candidate;
+        file->used = true;
+        std::snprintf(file->path, sizeof(file->path), "%s", path);
+        file->size = 0;
+        break;
+      }
+    }
+    if (file == nullptr) {
+      return File();
+    }
+  }
+
+  File opened{file, true};
+  if (mode[0] == 'w') {
+    file->size = 0;
+  } else {
+    opened.seek(file->size);
+  }
+  return opened;
+}
+
+bool FS::exists(const char* path) {
+  return findFile(path) != nullptr;
+}
+
+bool FS::remove(const char* path) {
+  auto* file = findFile(path);
+  if (file == nullptr) {
+    return false;
+  }
+  file->used = false;
+  return true;
+}
+
+bool FS::rename(const char* from, const char* to) {
+  auto* file = findFile(from);
+  if ((file == nullptr) or (findFile(to) != nullptr)) {
+    return false;
+  }
+  std::snprintf(file->path, sizeof(file->path), "%s", to);
+  return true;
+}
+
+size_t FS::usedBytes() {
+  size_t used = 0;
+  for (const auto& file : files) {
+    used += file.used ? file.size : 0;
+  }
+  return used;
+}
+
+}
+
+// Non-volatile storage
+
+bool Preferences::begin(const char* name, bool, const char*) {
+  std::snprintf(_namespace, sizeof(_namespace), "%s", name);
+  return true;
+}
+
+bool Preferences::clear() {
+  const auto length = std::strlen(_namespace);
+  size_t kept = 0;
+  for (size_t i = 0; i < numberOfPreferences; ++i) {
+    if ((std::strncmp(preferences[i].key, _namespace, length) != 0) or (preferences[i].key[length] != '/')) {
+      preferences[kept++] = preferences[i];
+    }
+  }
+  numberOfPreferences = kept;
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  auto* preference = findPreference(_namespace, key);
+  if (preference == nullptr) {
+    return false;
+  }
+  *preference = preferences[--numberOfPreferences];
+  return true;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  auto* preference = findPreference(_namespace, key);
+  if (preference == nullptr) {
+    if (numberOfPreferences == std::size(preferences)) {
+      return 0;
+    }
+    preference = &preferences[numberOfPreferences++];
+    std::snprintf(preference->key, sizeof(preference->key), "%s/%s", _namespace, key);
+  }
+  preference->value = value;
+  return sizeof(value);
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  const auto* preference = findPreference(_namespace, key);
+  return preference ? preference->value : defaultValue;
+}
+
+// newlib, referenced by the allocation tracker
+
+struct _reent;
+
+extern "C" {
+
+void* _malloc_r(struct _reent*, size_t size) {
+  return malloc(size);
+}
+
+void* _calloc_r(struct _reent*, size_t count, size_t size) {
+  return calloc(count, size);
+}
+
+void* _realloc_r(struct _reent*, void* pointer, size_t size) {
+  return realloc(pointer, size);
+}
+
+void _free_r(struct _reent*, void* pointer) {
+  free(pointer);
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef HOST_HPP
+#define HOST_HPP
+
+/**
+ * @file host.hpp
+ *
+ * Control of the simulated peripherals of the host build. The firmware only sees the fake Arduino, ESP-IDF and
+ * library headers in tools/host/include, a driver like benchmark.cpp uses this interface to move time forward and to
+ * inject events.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include <WebServer.h>
+
+namespace host {
+
+/// Simulated time since start in µs
+uint64_t now();
+
+/// Moves simulated time forward
+void advance(uint64_t us);
+
+/**
+ * @brief Limits how long a light sleep lasts
+ *
+ * @param[in] us simulated time of the next external event, a button press or request wakes up the ESP32
+ */
+void setNextEvent(uint64_t us);
+
+/**
+ * @brief Sets the wall clock at which NTP synchronizes
+ *
+ * Before the first configTzTime, time() counts from 1970 as on the ESP32 after power-on.
+ */
+void setNtpTime(time_t time);
+
+/// Level of a GPIO input, buttons are active low
+void setPin(uint8_t pin, int level);
+
+/// Values returned by the simulated SCD30 for the sample due at the given simulated time in µs
+struct Scd30Sample {
+  float co2;
+  float temperature;
+  float humidity;
+};
+using Scd30Source = Scd30Sample (*)(uint64_t time);
+void setScd30Source(Scd30Source source);
+void setScd30Present(bool present);
+
+/// Values returned by the simulated BMP280 in Pa and °C
+void setBmp280(bool present, float pressure, float temperature);
+
+/// Time until WiFi.begin connects in ms, with and without a known access point
+void setWifiConnectDelay(uint32_t fast, uint32_t scan);
+
+/// Whether the simulated MQTT broker accepts connections
+void setMqttBrokerAvailable(bool available);
+
+struct Response {
+  int code = 0;
+  /// Header and content bytes as sent by the firmware
+  std::size_t bytes = 0;
+  /// Content, cut at maxBodySize
+  const char* body = nullptr;
+  std::size_t bodySize = 0;
+};
+
+static constexpr std::size_t maxBodySize = 64 * 1024;
+
+/**
+ * @brief Queues a request, the web server handles one request per handleClient() as the ESP32 WebServer does
+ *
+ * @param[in] method HTTP method
+ * @param[in] uri path including the query string
+ * @param[in] body request body, available as argument "plain"
+ * @return false if the queue is full
+ */
+bool queueRequest(HTTPMethod method, const char* uri, const char* body = "");
+
+/// Number of requests not handled yet
+std::size_t pendingRequests();
+
+/// Response to the request handled last
+const Response& lastResponse();
+
+struct Counters {
+  uint32_t displayFrames;
+  uint32_t mqttPublishes;
+  std::size_t mqttBytes;
+  uint32_t udpPackets;
+  uint32_t requests;
+  uint32_t lightSleeps;
+  uint64_t lightSleepTime;
+  uint64_t delayTime;
+};
+const Counters& counters();
+
+/// Serial output to stderr
+void setVerbose(bool verbose);
+
+}
+
+#endif
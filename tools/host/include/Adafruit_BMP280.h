@@ -0,0 +1,16 @@
+#ifndef HOST_ADAFRUIT_BMP280_H
+#define HOST_ADAFRUIT_BMP280_H
+
+#include <Adafruit_Sensor.h>
+#include <Wire.h>
+
+/// Returns the values set with host::setBmp280
+class Adafruit_BMP280 {
+public:
+  explicit Adafruit_BMP280(TwoWire* wire = &Wire) { (void)wire; }
+  bool begin(uint8_t address = 0x77, uint8_t chipId = 0x58);
+  float readPressure();
+  float readTemperature();
+};
+
+#endif
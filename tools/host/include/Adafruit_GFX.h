@@ -0,0 +1,42 @@
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+/// Drawing is not simulated, text bounds assume the built-in 6x8 font
+class Adafruit_GFX : public Print {
+public:
+  Adafruit_GFX(int16_t width, int16_t height) : _width{width}, _height{height} {}
+
+  size_t write(uint8_t) override { return 1; }
+  using Print::write;
+
+  void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+  void setTextSize(uint8_t size) { _textSize = size; }
+  void setTextColor(uint16_t) {}
+  void setTextColor(uint16_t, uint16_t) {}
+  void setRotation(uint8_t) {}
+  void getTextBounds(const char* text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+    *x1 = x;
+    *y1 = y;
+    *w = static_cast<uint16_t>(std::strlen(text) * 6 * _textSize);
+    *h = static_cast<uint16_t>(8 * _textSize);
+  }
+  void drawPixel(int16_t, int16_t, uint16_t) {}
+  void drawFastHLine(int16_t, int16_t, int16_t, uint16_t) {}
+  void drawFastVLine(int16_t, int16_t, int16_t, uint16_t) {}
+  void drawLine(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+  void drawRect(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+  void fillRect(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+
+protected:
+  int16_t _width;
+  int16_t _height;
+  int16_t _cursorX = 0;
+  int16_t _cursorY = 0;
+  uint8_t _textSize = 1;
+};
+
+#endif
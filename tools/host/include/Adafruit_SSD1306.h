@@ -0,0 +1,22 @@
+#ifndef HOST_ADAFRUIT_SSD1306_H
+#define HOST_ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+
+/// Counts transferred frames, see host::counters
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+  Adafruit_SSD1306(uint8_t width, uint8_t height, int8_t mosi, int8_t clk, int8_t dc, int8_t reset, int8_t cs)
+    : Adafruit_GFX(width, height) { (void)mosi; (void)clk; (void)dc; (void)reset; (void)cs; }
+
+  bool begin(uint8_t vccState = SSD1306_SWITCHCAPVCC) { (void)vccState; return true; }
+  void dim(bool) {}
+  void clearDisplay() {}
+  void display();
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_ADAFRUIT_SENSOR_H
+#define HOST_ADAFRUIT_SENSOR_H
+
+#include <Arduino.h>
+
+#endif
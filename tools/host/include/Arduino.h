@@ -0,0 +1,171 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/**
+ * @file Arduino.h
+ *
+ * Host replacement of the Arduino core for the firmware build in tools/host. Time is simulated, see host.hpp, and
+ * nothing in here allocates from the heap, so the allocation check only sees allocations of the firmware itself.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define INPUT_PULLUP 0x05
+#define OUTPUT_OPEN_DRAIN 0x12
+
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+/// Fixed capacity string, request bodies and headers of the simulated web server fit into it
+class String {
+public:
+  static constexpr std::size_t capacity = 2048;
+
+  String(const char* value = "") { assign(value, value ? std::strlen(value) : 0); }
+  String(const char* value, std::size_t length) { assign(value, length); }
+  String(const std::string& value) { assign(value.data(), value.size()); }
+  String(int value) { _length = std::snprintf(_buffer, sizeof(_buffer), "%d", value); }
+  String(unsigned int value) { _length = std::snprintf(_buffer, sizeof(_buffer), "%u", value); }
+  String(long value) { _length = std::snprintf(_buffer, sizeof(_buffer), "%ld", value); }
+  String(unsigned long value) { _length = std::snprintf(_buffer, sizeof(_buffer), "%lu", value); }
+
+  const char* c_str() const { return _buffer; }
+  std::size_t length() const { return _length; }
+  bool isEmpty() const { return _length == 0; }
+  long toInt() const { return std::strtol(_buffer, nullptr, 10); }
+  float toFloat() const { return std::strtof(_buffer, nullptr); }
+  bool startsWith(const char* prefix) const { return std::strncmp(_buffer, prefix, std::strlen(prefix)) == 0; }
+  bool reserve(std::size_t size) { return size < capacity; }
+
+  bool concat(const char* value) { return concat(value, std::strlen(value)); }
+  bool concat(const char* value, std::size_t length) {
+    const auto copied = std::min(length, capacity - 1 - _length);
+    std::memcpy(_buffer + _length, value, copied);
+    _length += copied;
+    _buffer[_length] = '\0';
+    return copied == length;
+  }
+  String& operator+=(const char* value) { concat(value); return *this; }
+  String& operator+=(const String& value) { concat(value.c_str(), value.length()); return *this; }
+
+  bool operator==(const char* other) const { return std::strcmp(_buffer, other) == 0; }
+  bool operator==(const String& other) const { return std::strcmp(_buffer, other._buffer) == 0; }
+  bool operator!=(const char* other) const { return not (*this == other); }
+
+private:
+  void assign(const char* value, std::size_t length) {
+    _length = 0;
+    _buffer[0] = '\0';
+    if (value) {
+      concat(value, length);
+    }
+  }
+
+  char _buffer[capacity] = "";
+  std::size_t _length = 0;
+};
+
+class StringSumHelper : public String {
+public:
+  using String::String;
+};
+
+class Print {
+public:
+  virtual ~Print() = default;
+
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      write(buffer[i]);
+    }
+    return size;
+  }
+  size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* value) { return write(value, std::strlen(value)); }
+  size_t print(const String& value) { return write(value.c_str(), value.length()); }
+  size_t print(char value) { return write(static_cast<uint8_t>(value)); }
+  size_t print(int value);
+  size_t println(const char* value = "") { return print(value) + print("\r\n"); }
+  size_t println(const String& value) { return print(value) + print("\r\n"); }
+  size_t println(const struct tm* timeinfo, const char* format);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual void flush() {}
+
+  size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    for (int value; (count < length) and ((value = read()) >= 0); ++count) {
+      buffer[count] = static_cast<char>(value);
+    }
+    return count;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes(reinterpret_cast<char*>(buffer), length); }
+};
+
+/// Writes to stderr if enabled with host::setVerbose
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t value) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+void configTzTime(const char* tz, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+uint32_t esp_random();
+
+class EspClass {
+public:
+  [[noreturn]] void restart();
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getFreeSketchSpace();
+  uint8_t getCpuFreqMHz() { return 240; }
+  /// Derived from the host clock, so timers measure the host CPU time of the firmware code
+  uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  IPAddress() = default;
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{static_cast<uint32_t>(a | (b << 8) | (c << 16) | (d << 24))} {}
+  IPAddress(uint32_t address) : _address{address} {}
+
+  bool fromString(const char* address) {
+    unsigned int a, b, c, d;
+    char end;
+    if ((std::sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4) or (a > 255) or (b > 255) or (c > 255) or (d > 255)) {
+      return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+
+  operator uint32_t() const { return _address; }
+  uint8_t operator[](int index) const { return _address >> (8 * index); }
+  bool operator==(const IPAddress& other) const { return _address == other._address; }
+
+  String toString() const {
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+  }
+
+private:
+  uint32_t _address = 0;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HOST_MQTT_H
+#define HOST_MQTT_H
+
+#include <Arduino.h>
+
+/// Client of the simulated broker, publishes are counted, see host::setMqttBrokerAvailable
+class MQTTClient {
+public:
+  explicit MQTTClient(int bufferSize = 128) : _bufferSize{static_cast<size_t>(bufferSize)} {}
+
+  template <typename Client>
+  void begin(const char* hostname, int port, Client& client) { (void)hostname; (void)port; (void)client; }
+  void setTimeout(int timeout) { (void)timeout; }
+  void setOptions(int keepAlive, bool cleanSession, int timeout) { (void)keepAlive; (void)cleanSession; (void)timeout; }
+
+  bool connect(const char* clientId, const char* username = nullptr, const char* password = nullptr, bool skip = false);
+  bool publish(const char* topic, const char* payload, int length, bool retained, int qos);
+  /// The connection drops once the simulated broker becomes unavailable
+  bool loop() { return connected(); }
+  bool connected();
+  bool disconnect() { _connected = false; return true; }
+  int lastError() { return _connected ? 0 : -3; }
+  int returnCode() { return 0; }
+
+private:
+  size_t _bufferSize;
+  bool _connected = false;
+};
+
+#endif
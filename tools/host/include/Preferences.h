@@ -0,0 +1,24 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+/// Non-volatile storage, kept in memory
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false, const char* partition = nullptr);
+  void end() { _namespace[0] = '\0'; }
+  bool clear();
+  bool remove(const char* key);
+  size_t putBool(const char* key, bool value) { return putUInt(key, value); }
+  size_t putUChar(const char* key, uint8_t value) { return putUInt(key, value); }
+  size_t putUInt(const char* key, uint32_t value);
+  bool getBool(const char* key, bool defaultValue = false) { return getUInt(key, defaultValue) != 0; }
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return getUInt(key, defaultValue); }
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+
+private:
+  char _namespace[16] = "";
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+#include <Arduino.h>
+
+namespace fs {
+
+struct FileData;
+
+/// File in the simulated flash file system, kept in memory for the lifetime of the process
+class File : public Stream {
+public:
+  File() = default;
+  File(FileData* data, bool write) : _data{data}, _write{write} {}
+
+  explicit operator bool() const { return _data != nullptr; }
+  void close() { _data = nullptr; }
+  size_t size() const;
+  size_t position() const { return _position; }
+  bool seek(uint32_t position);
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int read() override;
+  size_t read(uint8_t* buffer, size_t size);
+  int available() override { return static_cast<int>(size() - _position); }
+  void flush() override {}
+
+private:
+  FileData* _data = nullptr;
+  bool _write = false;
+  size_t _position = 0;
+};
+
+class FS {
+public:
+  bool begin(bool formatOnFail = false);
+  void end() {}
+  File open(const char* path, const char* mode = "r");
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  size_t totalBytes() { return 1378241; }
+  size_t usedBytes();
+};
+
+}
+
+using fs::File;
+
+extern fs::FS SPIFFS;
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef HOST_UPDATE_H
+#define HOST_UPDATE_H
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+
+/// Accepts and discards an image, checks the size like the ESP32 core
+class UpdateClass {
+public:
+  /// Size of the app partitions of the default partition table, used for UPDATE_SIZE_UNKNOWN
+  static constexpr size_t partitionSize = 0x140000;
+
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = LOW, const char* label = nullptr) {
+    (void)command; (void)ledPin; (void)ledOn; (void)label;
+    _size = (size == UPDATE_SIZE_UNKNOWN) ? partitionSize : size;
+    _progress = 0;
+    _error = nullptr;
+    return true;
+  }
+  size_t write(uint8_t* data, size_t length) {
+    (void)data;
+    if ((_progress + length) > _size) {
+      _error = "Not Enough Space";
+      return 0;
+    }
+    _progress += length;
+    return length;
+  }
+  bool end(bool evenIfRemaining = false) {
+    if (not evenIfRemaining and (_progress < _size)) {
+      _error = "Premature End";
+      return false;
+    }
+    return not hasError();
+  }
+  void abort() { _error = "Aborted"; }
+  bool hasError() { return _error != nullptr; }
+  uint8_t getError() { return hasError() ? 1 : 0; }
+  const char* errorString() { return hasError() ? _error : "No Error"; }
+  size_t progress() { return _progress; }
+
+private:
+  size_t _size = 0;
+  size_t _progress = 0;
+  const char* _error = nullptr;
+};
+
+extern UpdateClass Update;
+
+#endif
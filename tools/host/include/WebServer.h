@@ -0,0 +1,113 @@
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <functional>
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPAuthMethod { BASIC_AUTH, DIGEST_AUTH };
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 1436
+
+struct HTTPUpload {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+/**
+ * Routes requests queued with host::queueRequest to the registered handlers, one request per handleClient() call.
+ * Uploads are not simulated.
+ */
+class WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit WebServer(int port = 80) { (void)port; }
+
+  void begin() { _running = true; }
+  void stop() { _running = false; }
+  void handleClient();
+
+  void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, nullptr); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction upload);
+  void onNotFound(THandlerFunction handler) { _notFound = handler; }
+
+  bool authenticate(const char* user, const char* password);
+  void requestAuthentication(HTTPAuthMethod mode = BASIC_AUTH, const char* realm = nullptr, const String& failure = String(""));
+
+  String uri() { return String(_uri); }
+  HTTPMethod method() { return _method; }
+  WiFiClient client() { return WiFiClient(); }
+  HTTPUpload& upload() { return _upload; }
+
+  String arg(const char* name);
+  String arg(int index);
+  bool hasArg(const char* name);
+  String header(const char* name);
+  bool hasHeader(const char* name);
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) { (void)headerKeys; (void)headerKeysCount; }
+
+  void sendHeader(const String& name, const String& value, bool first = false);
+  void setContentLength(const size_t length) { _contentLength = length; }
+  void send(int code, const char* contentType = nullptr, const String& content = String(""));
+  void send(int code, const char* contentType, const char* content);
+  void send_P(int code, const char* contentType, const char* content, size_t length);
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char* content, size_t length);
+  void sendContent(const char* content) { sendContent(content, std::strlen(content)); }
+  void sendContent_P(const char* content, size_t length) { sendContent(content, length); }
+
+  template <typename File>
+  size_t streamFile(File& file, const String& contentType) {
+    setContentLength(file.size());
+    send(200, contentType.c_str(), "");
+    uint8_t buffer[512];
+    size_t sent = 0;
+    for (size_t read; (read = file.read(buffer, sizeof(buffer))) > 0; sent += read) {
+      sendContent(reinterpret_cast<const char*>(buffer), read);
+    }
+    return sent;
+  }
+
+private:
+  struct Route {
+    char uri[64];
+    HTTPMethod method;
+    THandlerFunction handler;
+  };
+
+  static constexpr size_t maxRoutes = 32;
+  static constexpr size_t maxArgs = 8;
+
+  void parseArgs(const char* query);
+
+  bool _running = false;
+  Route _routes[maxRoutes];
+  size_t _numberOfRoutes = 0;
+  THandlerFunction _notFound;
+
+  HTTPMethod _method = HTTP_GET;
+  char _uri[256] = "";
+  struct {
+    char name[32];
+    char value[256];
+  } _args[maxArgs];
+  size_t _numberOfArgs = 0;
+  const char* _body = "";
+  size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+  HTTPUpload _upload{};
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+#include <WiFiUdp.h>
+
+typedef enum { WIFI_OFF = 0, WIFI_MODE_NULL = 0, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+typedef enum { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6 } wl_status_t;
+
+/// Connects after the delay set with host::setWifiConnectDelay, with a lease from the simulated DHCP server
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t mode) { _mode = mode; return true; }
+  void persistent(bool) {}
+  bool getAutoConnect() { return false; }
+  bool setAutoConnect(bool) { return true; }
+  bool getAutoReconnect() { return true; }
+  bool setAutoReconnect(bool) { return true; }
+  bool setHostname(const char*) { return true; }
+  bool setSleep(bool) { return true; }
+
+  bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+  bool softAP(const char*, const char* = nullptr, int = 1, int = 0, int = 4) { return true; }
+  bool softAPdisconnect(bool = false) { return true; }
+
+  bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  wl_status_t begin(const char* ssid, const char* password = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  wl_status_t status();
+
+  int8_t RSSI() { return -61; }
+  uint8_t* BSSID() { return _bssid; }
+  int32_t channel() { return 6; }
+  IPAddress localIP() { return _localIp; }
+  IPAddress gatewayIP() { return _gateway; }
+  IPAddress subnetMask() { return _subnet; }
+  IPAddress dnsIP(uint8_t = 0) { return _dns; }
+  String macAddress() { return String("24:0A:C4:00:00:01"); }
+  uint8_t* macAddress(uint8_t* mac) { static const uint8_t address[] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01}; std::memcpy(mac, address, sizeof(address)); return mac; }
+
+private:
+  wifi_mode_t _mode = WIFI_OFF;
+  uint8_t _bssid[6] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+  bool _staticConfig = false;
+  IPAddress _localIp, _gateway, _subnet, _dns;
+  /// Simulated time in µs at which the connection is established, 0 if not connecting
+  uint64_t _connectedAt = 0;
+};
+
+extern WiFiClass WiFi;
+
+#endif
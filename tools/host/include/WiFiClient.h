@@ -0,0 +1,18 @@
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+/// Connection of the web server or the MQTT client, written bytes go to the response of the simulated request
+class WiFiClient : public Stream {
+public:
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  uint8_t connected() { return 1; }
+  void stop() {}
+  IPAddress remoteIP() { return IPAddress(192, 168, 1, 2); }
+};
+
+#endif
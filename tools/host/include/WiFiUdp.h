@@ -0,0 +1,26 @@
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+/// Sent packets are counted, nothing is ever received
+class WiFiUDP : public Stream {
+public:
+  uint8_t begin(uint16_t) { return 1; }
+  uint8_t beginMulticast(IPAddress, uint16_t) { return 1; }
+  void stop() {}
+  int beginPacket(IPAddress, uint16_t) { return 1; }
+  int beginMulticastPacket() { return 1; }
+  int endPacket();
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t size) override { return size; }
+  using Print::write;
+  int parsePacket() { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t*, size_t) { return 0; }
+  IPAddress remoteIP() { return IPAddress(); }
+  uint16_t remotePort() { return 0; }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+/// I2C bus with the simulated SCD30 at 0x61 and the chip id register of a BMP280 at 0x76, see host.hpp
+class TwoWire : public Stream {
+public:
+  explicit TwoWire(uint8_t bus = 0) { (void)bus; }
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) { (void)sda; (void)scl; (void)frequency; return true; }
+  bool setClock(uint32_t) { return true; }
+  void end() {}
+
+  void beginTransmission(uint8_t address);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, size_t size, bool sendStop = true);
+
+  size_t write(uint8_t value) override;
+  using Print::write;
+  int available() override { return static_cast<int>(_rxSize - _rxPosition); }
+  int read() override { return (_rxPosition < _rxSize) ? _rx[_rxPosition++] : -1; }
+
+private:
+  uint8_t _address = 0;
+  uint8_t _tx[32];
+  size_t _txSize = 0;
+  uint8_t _rx[32];
+  size_t _rxSize = 0;
+  size_t _rxPosition = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef HOST_DRIVER_SPI_MASTER_H
+#define HOST_DRIVER_SPI_MASTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_TIMEOUT 0x107
+
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
+
+typedef enum { SPI_HOST = 0, HSPI_HOST = 1, VSPI_HOST = 2 } spi_host_device_t;
+
+typedef struct {
+  int mosi_io_num;
+  int miso_io_num;
+  int sclk_io_num;
+  int quadwp_io_num;
+  int quadhd_io_num;
+  int max_transfer_sz;
+  uint32_t flags;
+  int intr_flags;
+} spi_bus_config_t;
+
+typedef struct {
+  uint8_t command_bits;
+  uint8_t address_bits;
+  uint8_t dummy_bits;
+  uint8_t mode;
+  uint16_t duty_cycle_pos;
+  uint16_t cs_ena_pretrans;
+  uint8_t cs_ena_posttrans;
+  int clock_speed_hz;
+  int input_delay_ns;
+  int spics_io_num;
+  uint32_t flags;
+  int queue_size;
+  void* pre_cb;
+  void* post_cb;
+} spi_device_interface_config_t;
+
+typedef struct {
+  uint32_t flags;
+  uint16_t cmd;
+  uint64_t addr;
+  size_t length;
+  size_t rxlength;
+  void* user;
+  const void* tx_buffer;
+  void* rx_buffer;
+} spi_transaction_t;
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+/// Transfers complete immediately
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* config, int dmaChannel);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* config, spi_device_handle_t* handle);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* transaction, uint32_t ticksToWait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** transaction, uint32_t ticksToWait);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+/// Advances simulated time to the timer wake-up or to the next event set with host::setNextEvent
+esp_err_t esp_light_sleep_start();
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { static int task; return &task; }
+
+#endif
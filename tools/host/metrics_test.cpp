@@ -0,0 +1,144 @@
+/**
+ * @file metrics_test.cpp
+ *
+ * Checks that /metrics fits into the buffers of Metrics in the worst case. Runs the firmware with MQTT and telemetry
+ * enabled, so every optional series is rendered, and takes the response to /metrics. Each sample value is then
+ * assumed to have its longest possible length: Metrics::maxValueLength for floats, 11 characters for integers. Labels
+ * are taken as rendered, they only contain names and configuration values.
+ *
+ * Build: make -C tools/host metrics_test (see Makefile)
+ * Usage: ./metrics_test, exits with 1 if a check failed
+ */
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "host.hpp"
+#include "metrics.hpp"
+
+void setup();
+void loop();
+
+namespace {
+
+unsigned failures = 0;
+
+void check(bool condition, const char* description) {
+  if (not condition) {
+    std::fprintf(stderr, "FAILED: %s\n", description);
+    failures++;
+  }
+}
+
+/// "-2147483648" or "4294967295"
+constexpr std::size_t maxIntegerLength = 11u;
+
+/// First series rendered by Metrics::renderRuntimeMetrics
+constexpr const char* runtimeMetricsStart = "# TYPE co2sensor_uptime_seconds";
+
+host::Scd30Sample scd30Source(uint64_t) {
+  return {850.0f, 21.5f, 45.0f};
+}
+
+void writeConfig() {
+  const char json[] = "{\"wifiSsid\":\"test\",\"wifiPassword\":\"test\",\"mqttBroker\":\"broker.local\","
+    "\"telemetryGroup\":\"239.255.43.21\"}";
+
+  SPIFFS.begin();
+  File file = SPIFFS.open("/config.json", "w");
+  file.write(reinterpret_cast<const uint8_t*>(json), sizeof(json) - 1);
+  file.close();
+}
+
+void run(uint64_t duration) {
+  const uint64_t end = host::now() + duration;
+  while (host::now() < end) {
+    const uint64_t before = host::now();
+    loop();
+    if (host::now() == before) {
+      host::advance(1000);
+    }
+  }
+}
+
+/// Length of the text with every sample value at its longest
+std::size_t worstCaseLength(const char* text, std::size_t length) {
+  std::size_t worstCase = 0;
+  const char* end = text + length;
+  for (const char* line = text; line < end;) {
+    const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+    lineEnd = lineEnd ? lineEnd : end;
+    const std::size_t lineLength = lineEnd - line;
+
+    if ((line[0] == '#') or (lineLength == 0)) {
+      worstCase += lineLength + 1;
+    } else {
+      const char* value = lineEnd;
+      while ((value > line) and (value[-1] != ' ')) {
+        value--;
+      }
+      const std::size_t valueLength = lineEnd - value;
+      const bool integer = std::strpbrk(std::string(value, valueLength).c_str(), ".eN") == nullptr;
+      worstCase += (lineLength - valueLength) + (integer ? maxIntegerLength : Metrics::maxValueLength) + 1;
+    }
+
+    line = lineEnd + 1;
+  }
+  return worstCase;
+}
+
+}
+
+int main() {
+  host::setScd30Source(scd30Source);
+  host::setMqttBrokerAvailable(true);
+  writeConfig();
+
+  setup();
+  run(60000000ull);
+
+  const auto requests = host::counters().requests;
+  host::queueRequest(HTTP_GET, "/metrics");
+  while (host::counters().requests == requests) {
+    run(1000);
+  }
+
+  const auto& response = host::lastResponse();
+  check(response.code == 200, "/metrics is answered");
+  check(response.bodySize < host::maxBodySize, "/metrics is not cut");
+
+  const char* body = response.body;
+  const char* runtime = std::strstr(body, runtimeMetricsStart);
+  check(runtime != nullptr, "runtime metrics follow the measurement metrics");
+  check(std::strstr(body, "co2sensor_co2_ppm{sensor=\"scd30\"}") != nullptr, "measurement metrics are rendered");
+  check(std::strstr(body, "co2sensor_telemetry_datagrams_total") != nullptr, "optional runtime metrics are rendered");
+  check(std::strstr(body, "# EOF\n") != nullptr, "runtime metrics are complete");
+  if (runtime == nullptr) {
+    std::fprintf(stderr, "%u checks failed.\n", failures);
+    return 1;
+  }
+
+  const std::size_t measurementLength = runtime - body;
+  const std::size_t runtimeLength = response.bodySize - measurementLength;
+  const auto measurementWorstCase = worstCaseLength(body, measurementLength);
+  const auto runtimeWorstCase = worstCaseLength(runtime, runtimeLength);
+
+  std::printf("Measurement metrics: %zu bytes, at most %zu of %zu.\n", measurementLength, measurementWorstCase, Metrics::measurementMetricsSize);
+  std::printf("Runtime metrics: %zu bytes, at most %zu of %zu.\n", runtimeLength, runtimeWorstCase, Metrics::runtimeMetricsSize);
+
+  // TextWriter keeps room for the terminating null
+  check(measurementWorstCase < Metrics::measurementMetricsSize, "measurement metrics fit in the worst case");
+  check(runtimeWorstCase < Metrics::runtimeMetricsSize, "runtime metrics fit in the worst case");
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%u checks failed.\n", failures);
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file ota_test.cpp
+ *
+ * Checks Ota against the simulated Update, which fails like the ESP32 core when an image ends before the size passed
+ * to Update.begin(). Writes an image much smaller than the partition in chunks and checks that it is activated and
+ * confirmed once healthy, and that an image with the wrong hash is rejected.
+ *
+ * Build: make -C tools/host ota_test (see Makefile)
+ * Usage: ./ota_test, exits with 1 if a check failed
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include <cstdio>
+
+#include <mbedtls/sha256.h>
+
+#include "ota.hpp"
+
+namespace {
+
+unsigned failures = 0;
+
+void check(bool condition, const char* description) {
+  if (not condition) {
+    std::fprintf(stderr, "FAILED: %s\n", description);
+    failures++;
+  }
+}
+
+constexpr std::size_t imageSize = 100000u;
+constexpr std::size_t chunkSize = 1436u; // One TCP segment, as the web server hands out uploads
+
+uint8_t image[imageSize];
+char imageHash[2 * Ota::hashSize + 1];
+
+void createImage() {
+  for (std::size_t i = 0; i < imageSize; ++i) {
+    image[i] = static_cast<uint8_t>(i * 31u);
+  }
+
+  uint8_t hash[Ota::hashSize];
+  mbedtls_sha256_context sha256;
+  mbedtls_sha256_init(&sha256);
+  mbedtls_sha256_starts_ret(&sha256, 0);
+  mbedtls_sha256_update_ret(&sha256, image, imageSize);
+  mbedtls_sha256_finish_ret(&sha256, hash);
+  mbedtls_sha256_free(&sha256);
+  for (std::size_t i = 0; i < Ota::hashSize; ++i) {
+    std::snprintf(&imageHash[2 * i], 3, "%02x", hash[i]);
+  }
+}
+
+bool writeImage(Ota& ota) {
+  for (std::size_t offset = 0; offset < imageSize; offset += chunkSize) {
+    if (not ota.write(&image[offset], std::min(chunkSize, imageSize - offset))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool isPending() {
+  Preferences preferences;
+  preferences.begin("ota");
+  const bool pending = preferences.getBool("pending", false);
+  preferences.end();
+  return pending;
+}
+
+void testValidImage() {
+  Ota ota;
+  check(ota.begin(imageHash), "update starts");
+  check(writeImage(ota), "image is written");
+  const bool ended = ota.end();
+  if (not ended) {
+    std::fprintf(stderr, "Update failed: %s\n", ota.getError());
+  }
+  check(ended, "image smaller than the partition is activated");
+  check(ota.getSize() == imageSize, "all bytes are counted");
+  check(isPending(), "new firmware is pending until confirmed");
+
+  // Next boot, the firmware is confirmed once it is healthy
+  Ota booted;
+  booted.setup();
+  booted.loop(false);
+  check(booted.isPending() and isPending(), "firmware stays pending until it is healthy");
+  booted.loop(true);
+  check(not booted.isPending() and not isPending(), "healthy firmware is confirmed");
+}
+
+void testHashMismatch() {
+  char wrongHash[sizeof(imageHash)];
+  std::snprintf(wrongHash, sizeof(wrongHash), "%s", imageHash);
+  wrongHash[0] = (wrongHash[0] == '0') ? '1' : '0';
+
+  Ota ota;
+  check(ota.begin(wrongHash), "update with other hash starts");
+  check(writeImage(ota), "image with other hash is written");
+  check(not ota.end(), "image with other hash is rejected");
+  check(not isPending(), "rejected image is not pending");
+}
+
+void testInvalidHash() {
+  Ota ota;
+  check(not ota.begin("1234"), "short hash is rejected");
+  check(not ota.isActive(), "update with short hash is not started");
+}
+
+}
+
+int main() {
+  createImage();
+
+  testValidImage();
+  testHashMismatch();
+  testInvalidHash();
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%u checks failed.\n", failures);
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}
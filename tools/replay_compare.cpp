@@ -0,0 +1,135 @@
+/**
+ * @file replay_compare.cpp
+ *
+ * Compares two /api/replay.csv files of the same trace, e.g. replayed by two firmware revisions on the device or with
+ * tools/host/benchmark --replay. Prints per column the number of differing values and the largest difference, the raw
+ * columns have to match exactly.
+ *
+ * Build: g++ -std=c++17 -o replay_compare replay_compare.cpp
+ * Usage: ./replay_compare [--tolerance=<value>] before.csv after.csv, exits with 1 if the filtered values differ by
+ *        more than the tolerance (default 0) or the files don't belong to the same trace
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> split(const std::string& line) {
+  std::vector<std::string> fields;
+  std::stringstream stream{line};
+  std::string field;
+  while (std::getline(stream, field, ',')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+bool sameValue(double before, double after, double tolerance) {
+  if (std::isnan(before) or std::isnan(after)) {
+    return std::isnan(before) and std::isnan(after);
+  }
+  return std::fabs(after - before) <= tolerance;
+}
+
+struct Column {
+  std::string name;
+  unsigned differences = 0;
+  double maximumDifference = 0.0;
+};
+
+}
+
+int main(int argc, char** argv) {
+  double tolerance = 0.0;
+  int first = 1;
+  if ((argc > 1) and (std::strncmp(argv[1], "--tolerance=", 12) == 0)) {
+    tolerance = std::strtod(argv[1] + 12, nullptr);
+    first++;
+  }
+  if ((argc - first) != 2) {
+    std::fprintf(stderr, "Usage: replay_compare [--tolerance=<value>] before.csv after.csv\n");
+    return 2;
+  }
+
+  std::ifstream before{argv[first]};
+  std::ifstream after{argv[first + 1]};
+  if (not before or not after) {
+    std::fprintf(stderr, "Opening input failed.\n");
+    return 2;
+  }
+
+  std::string beforeLine;
+  std::string afterLine;
+  if (not std::getline(before, beforeLine) or not std::getline(after, afterLine) or (beforeLine != afterLine)) {
+    std::fprintf(stderr, "Headers differ, the files were written by incompatible versions.\n");
+    return 1;
+  }
+
+  std::vector<Column> columns;
+  for (const auto& name : split(beforeLine)) {
+    columns.push_back({name});
+  }
+
+  unsigned rows = 0;
+  unsigned rawMismatches = 0;
+  while (true) {
+    const bool beforeRead = static_cast<bool>(std::getline(before, beforeLine));
+    const bool afterRead = static_cast<bool>(std::getline(after, afterLine));
+    if (not beforeRead or not afterRead) {
+      if (beforeRead != afterRead) {
+        std::fprintf(stderr, "Number of rows differs after %u rows.\n", rows);
+        return 1;
+      }
+      break;
+    }
+    rows++;
+
+    const auto beforeFields = split(beforeLine);
+    const auto afterFields = split(afterLine);
+    if ((beforeFields.size() != columns.size()) or (afterFields.size() != columns.size())) {
+      std::fprintf(stderr, "Row %u has the wrong number of columns.\n", rows);
+      return 1;
+    }
+
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+      const double beforeValue = std::strtod(beforeFields[i].c_str(), nullptr);
+      const double afterValue = std::strtod(afterFields[i].c_str(), nullptr);
+      // Time and raw values come from the trace and have to match exactly
+      const bool raw = (columns[i].name == "time") or (columns[i].name.rfind("raw_", 0) == 0);
+      if (not sameValue(beforeValue, afterValue, raw ? 0.0 : tolerance)) {
+        columns[i].differences++;
+        if (raw) {
+          rawMismatches++;
+        } else if (not std::isnan(beforeValue) and not std::isnan(afterValue)) {
+          columns[i].maximumDifference = std::max(columns[i].maximumDifference, std::fabs(afterValue - beforeValue));
+        }
+      }
+    }
+  }
+
+  if (rawMismatches > 0) {
+    std::fprintf(stderr, "Raw values differ in %u places, the files belong to different traces.\n", rawMismatches);
+    return 1;
+  }
+
+  std::printf("%u rows\n", rows);
+  std::printf("%-20s %10s %14s\n", "column", "differing", "max difference");
+  unsigned differences = 0;
+  for (const auto& column : columns) {
+    if ((column.name == "time") or (column.name.rfind("raw_", 0) == 0)) {
+      continue;
+    }
+    std::printf("%-20s %10u %14.6g\n", column.name.c_str(), column.differences, column.maximumDifference);
+    differences += column.differences;
+  }
+
+  return (differences > 0) ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file telemetry_listen.cpp
+ *
+ * Host side listener for telemetry datagrams. Joins the multicast group, prints every datagram as CSV and reports
+ * datagrams lost per sensor, detected by gaps in the sequence number. A lower sequence number than expected is taken
+ * as reboot of the sensor.
+ *
+ * Build: g++ -std=c++17 -I../src -o telemetry_listen telemetry_listen.cpp
+ * Usage: ./telemetry_listen <group> [port] [count]
+ *
+ * With count the listener exits after count datagrams, with exit code 2 if datagrams were lost.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#include "telemetry_datagram.hpp"
+
+namespace {
+
+struct Sender {
+  uint32_t nextSequence;
+  uint64_t received;
+  uint64_t lost;
+};
+
+uint64_t deviceKey(const uint8_t* device) {
+  return telemetryDatagram::readLittleEndian(device, 6);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::fprintf(stderr, "Usage: %s <group> [port] [count]\n", argv[0]);
+    return 1;
+  }
+
+  const char* group = argv[1];
+  const uint16_t port = (argc > 2) ? std::atoi(argv[2]) : 4321;
+  const unsigned long count = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 0;
+
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    std::perror("socket");
+    return 1;
+  }
+
+  const int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    std::perror("bind");
+    return 1;
+  }
+
+  ip_mreq membership{};
+  if (inet_pton(AF_INET, group, &membership.imr_multiaddr) != 1) {
+    std::fprintf(stderr, "Invalid group %s.\n", group);
+    return 1;
+  }
+  membership.imr_interface.s_addr = htonl(INADDR_ANY);
+  if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+    std::perror("IP_ADD_MEMBERSHIP");
+    return 1;
+  }
+
+  std::map<uint64_t, Sender> senders;
+  unsigned long received = 0;
+  while ((count == 0) or (received < count)) {
+    uint8_t buffer[telemetryDatagram::maxSize];
+    const auto size = recv(fd, buffer, sizeof(buffer), 0);
+    if (size < 0) {
+      std::perror("recv");
+      return 1;
+    }
+
+    telemetryDatagram::Datagram datagram;
+    if (not telemetryDatagram::decode(buffer, size, datagram)) {
+      std::fprintf(stderr, "Ignoring invalid datagram of %zd bytes.\n", size);
+      continue;
+    }
+    if (received++ == 0) {
+      std::printf("device,sequence,time");
+      for (uint8_t i = 0; i < datagram.numberOfQuantities; ++i) {
+        std::printf(",quantity%u", i);
+      }
+      std::printf("\n");
+    }
+
+    const auto key = deviceKey(datagram.device);
+    auto found = senders.find(key);
+    if (found == senders.end()) {
+      found = senders.emplace(key, Sender{datagram.sequence, 0, 0}).first;
+    }
+    auto& sender = found->second;
+    if (datagram.sequence < sender.nextSequence) {
+      std::fprintf(stderr, "%012llx rebooted.\n", static_cast<unsigned long long>(key));
+    } else if (datagram.sequence > sender.nextSequence) {
+      sender.lost += datagram.sequence - sender.nextSequence;
+      std::fprintf(stderr, "%012llx lost %u datagrams.\n", static_cast<unsigned long long>(key), datagram.sequence - sender.nextSequence);
+    }
+    sender.nextSequence = datagram.sequence + 1;
+    sender.received++;
+
+    std::printf("%02x:%02x:%02x:%02x:%02x:%02x,%u,%lld", datagram.device[0], datagram.device[1], datagram.device[2],
+      datagram.device[3], datagram.device[4], datagram.device[5], datagram.sequence, static_cast<long long>(datagram.time));
+    for (uint8_t i = 0; i < datagram.numberOfQuantities; ++i) {
+      std::printf(",%g", datagram.values[i]);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  close(fd);
+
+  uint64_t lost = 0;
+  for (const auto& sender : senders) {
+    std::fprintf(stderr, "%012llx received %llu, lost %llu.\n", static_cast<unsigned long long>(sender.first),
+      static_cast<unsigned long long>(sender.second.received), static_cast<unsigned long long>(sender.second.lost));
+    lost += sender.second.lost;
+  }
+
+  return (lost > 0) ? 2 : 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file temperature_fusion_test.cpp
+ *
+ * Host side test of src/temperature_fusion.hpp. Feeds a constant room climate with a biased SCD30 and checks that the
+ * bias is learned and removed from the fused temperature and humidity.
+ *
+ * Build: g++ -std=c++17 -I../src -o temperature_fusion_test temperature_fusion_test.cpp ../src/temperature_fusion.cpp
+ * Usage: ./temperature_fusion_test, exits with 1 if a check failed
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include "temperature_fusion.hpp"
+
+namespace {
+
+unsigned failures = 0;
+
+void check(bool condition, const char* description) {
+  if (not condition) {
+    std::fprintf(stderr, "FAILED: %s\n", description);
+    failures++;
+  }
+}
+
+constexpr float roomTemperature = 21.0f; // °C
+constexpr float roomHumidity = 45.0f; // %
+constexpr float scd30Bias = 1.5f; // °C
+constexpr time_t interval = 15; // s
+
+float value(const Measurement& measurement, Quantity quantity) {
+  return measurement.data[static_cast<std::underlying_type_t<Quantity>>(quantity)];
+}
+
+/// Relative humidity of the room air at another temperature, same formula as TemperatureFusion
+float humidityAt(float temperature) {
+  const auto saturationVapourPressure = [](float t) { return 6.112f * std::exp((17.62f * t) / (243.12f + t)); };
+  return roomHumidity * saturationVapourPressure(roomTemperature) / saturationVapourPressure(temperature);
+}
+
+Measurement sample(time_t time, bool scd30Valid, bool bmp280Valid) {
+  Measurement measurement{};
+  measurement.time = time;
+  measurement.clear();
+  if (scd30Valid) {
+    // The SCD30 reads its own, warmer air, so its humidity is lower
+    measurement.set(Quantity::Scd30Temperature, roomTemperature + scd30Bias);
+    measurement.set(Quantity::Scd30Humidity, humidityAt(roomTemperature + scd30Bias));
+  }
+  if (bmp280Valid) {
+    measurement.set(Quantity::Bmp280Temperature, roomTemperature);
+  }
+  return measurement;
+}
+
+void testBiasRemoved() {
+  TemperatureFusion fusion;
+  Measurement measurement{};
+  for (time_t time = 0; time < 3600; time += interval) {
+    measurement = sample(time, true, true);
+    fusion.update(measurement);
+  }
+
+  check(std::fabs(fusion.getOffset() - scd30Bias) < 0.01f, "SCD30 bias is learned");
+  check(fusion.getOffsetUncertainty() < 0.1f, "learned bias is certain");
+  check(std::fabs(value(measurement, Quantity::FusedTemperature) - roomTemperature) < 0.01f, "bias is removed from temperature");
+  check(std::fabs(value(measurement, Quantity::FusedHumidity) - roomHumidity) < 0.1f, "bias is removed from humidity");
+  check(std::fabs(value(measurement, Quantity::Scd30Humidity) - roomHumidity) > 3.0f, "humidity correction is not trivial");
+}
+
+void testSingleSensor() {
+  TemperatureFusion fusion;
+  for (time_t time = 0; time < 3600; time += interval) {
+    auto measurement = sample(time, true, true);
+    fusion.update(measurement);
+  }
+
+  auto scd30Only = sample(3600, true, false);
+  fusion.update(scd30Only);
+  check(std::fabs(value(scd30Only, Quantity::FusedTemperature) - roomTemperature) < 0.01f, "learned bias is removed without BMP280");
+  check(std::fabs(value(scd30Only, Quantity::FusedHumidity) - roomHumidity) < 0.1f, "humidity is corrected without BMP280");
+
+  auto bmp280Only = sample(3615, false, true);
+  fusion.update(bmp280Only);
+  check(value(bmp280Only, Quantity::FusedTemperature) == roomTemperature, "BMP280 is used alone");
+  check(not bmp280Only.isValid(Quantity::FusedHumidity), "no humidity without SCD30");
+}
+
+void testNoSensor() {
+  TemperatureFusion fusion;
+  auto measurement = sample(0, false, false);
+  fusion.update(measurement);
+  check(not measurement.isValid(Quantity::FusedTemperature) and not measurement.isValid(Quantity::FusedHumidity), "nothing is fused without sensors");
+  check(std::isnan(fusion.getOffset()), "no bias is learned without sensors");
+}
+
+}
+
+int main() {
+  testBiasRemoved();
+  testSingleSensor();
+  testNoSensor();
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%u checks failed.\n", failures);
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file trace_decode.cpp
+ *
+ * Host side decoder for /api/trace.bin. Reads a sensor trace from stdin and prints it as CSV, in the same columns as
+ * the raw values of /api/replay.csv.
+ *
+ * Build: g++ -std=c++17 -I../src -o trace_decode trace_decode.cpp
+ * Usage: curl -s http://<hostname>/api/trace.bin | ./trace_decode
+ */
+
+#include <cstdio>
+#include <iterator>
+#include <iostream>
+#include <vector>
+
+#include "trace_format.hpp"
+
+int main() {
+  std::vector<uint8_t> data{std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>()};
+
+  uint8_t numberOfQuantities;
+  if ((data.size() < traceFormat::headerSize) or (not traceFormat::decodeHeader(data.data(), numberOfQuantities))) {
+    std::fprintf(stderr, "Invalid trace header.\n");
+    return 1;
+  }
+
+  std::printf("time,valid");
+  for (uint8_t i = 0; i < numberOfQuantities; ++i) {
+    std::printf(",quantity%u", i);
+  }
+  std::printf("\n");
+
+  const auto recordSize = traceFormat::recordSize(numberOfQuantities);
+  std::size_t position = traceFormat::headerSize;
+  for (; (position + recordSize) <= data.size(); position += recordSize) {
+    uint32_t time;
+    uint8_t valid;
+    float values[traceFormat::maxNumberOfQuantities];
+    traceFormat::decodeRecord(&data[position], time, valid, values, numberOfQuantities);
+
+    std::printf("%u,%u", time, valid);
+    for (uint8_t i = 0; i < numberOfQuantities; ++i) {
+      std::printf(",%.9g", values[i]);
+    }
+    std::printf("\n");
+  }
+
+  if (position != data.size()) {
+    std::fprintf(stderr, "Trace truncated, ignored %zu trailing bytes.\n", data.size() - position);
+    return 1;
+  }
+
+  return 0;
+}